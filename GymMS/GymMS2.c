@@ -1,11 +1,76 @@
+#define _GNU_SOURCE // accept4 and writer-preferring rwlocks for --server
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
 #include <ctype.h>
 #include <time.h>
+#include <stdint.h>
+#include <limits.h>
+#include <stddef.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <pthread.h>
+#include <errno.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <stdatomic.h>
+#include <sched.h>
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
 
 #define MEMBER_FILENAME "members.dat"
 #define EQUIPMENT_FILENAME "equipment.dat"
+#define REPORT_FILENAME "reports.log" // Append-only history of the generated reports
+#define WAL_SUFFIX ".wal" // Operation log kept next to each data file, e.g. "members.dat.wal"
+#define STATUS_LOG_SUFFIX ".status" // Equipment status time series kept next to equipment.dat
+#define WAL_BUFFER_SIZE 65536 // Records are staged here and written together on commit
+#define WAL_CHECKPOINT_RECORDS 1024 // Fold the log into the .dat snapshot once it holds this many records
+#define TEMP_SUFFIX ".tmp" // Snapshots are written here first and then renamed over the data file
+#define DATA_FILE_MAGIC 0x534D5947u // "GYMS" in little-endian byte order
+#define MEMBER_FORMAT_VERSION 2 // Bump when PACKED_MEMBER_SCHEMA changes
+#define EQUIPMENT_FORMAT_VERSION 2 // Bump when EQUIPMENT_SCHEMA changes
+#define CHECKSUM_BLOCK_RECORDS 256 // Records covered by each CRC32C in a data file's trailer
+#define MAX_RECORD_SIZE 512 // Upper bound on an encoded record, for stack buffers
+#define REDO_SUFFIX ".redo" // Holds the bytes of an incremental save until they are in the data file
+#define REDO_FILE_MAGIC 0x52594D47u // "GMYR" in little-endian byte order
+#define SNAPSHOT_INTERVAL_SECONDS 300 // Default for --snapshot-interval
+#define SNAPSHOT_DIRTY_RECORDS 1000 // Default for --snapshot-dirty
+#define IMPORT_BATCH_BYTES (16 * 1024 * 1024) // CSV import reads and parses the file this much at a time
+#define IMPORT_MAX_THREADS 64
+#define BATCH_BUFFER_BYTES (4 * 1024 * 1024) // --batch reads its script this much at a time
+#define BATCH_COMMIT_OPS 16384 // --batch commits the logs after this many changes to a list
+#define SERVER_INPUT_BYTES 65536 // A --server request line must fit in this
+#define SERVER_REPLY_LIMIT (1024 * 1024) // --server stops reading from a client with this much unsent
+#define SERVER_MIN_THREADS 4 // Default floor for --server threads; a thread waiting for fdatasync does not serve
+#define SERVER_MAX_THREADS 64
+#define SERVER_EPOLL_EVENTS 64
+#define CHECKIN_QUEUE_SLOTS 65536 // Scans the check-in queue holds before turning more away, a power of two
+#define CHECKIN_BATCH 4096 // Most visits the check-in consumer appends per sync of the visit log
+#define VISIT_LOG_PREFIX "visits-" // Visit logs are named VISIT_LOG_PREFIX + YYYY-MM-DD + VISIT_LOG_SUFFIX
+#define VISIT_LOG_SUFFIX ".log"
+#define SCAN_FIELD_MAX 64 // Largest text field the vectorized matchers handle
+#define SCAN_PATTERN_BYTES 64 // Search text buffer, zero-padded so whole vectors can be read from it
+#define EXPORT_BUFFER_SIZE (1024 * 1024) // Exports are written out in pieces of this size
+#define NAME_LENGTH 50 // Size of the name fields in Member
+#define MAX_NAME_TRIGRAMS 160 // Enough for every trigram of a member's first and last name
+#define FUZZY_MAX_WORDS 8 // Words of a fuzzy search query that are used
+#define FUZZY_RESULTS 10 // Members shown by a fuzzy search
+#define EXPORT_RECORD_MAX 2048 // Upper bound on one formatted export record, with every character escaped
+#define COMPACT_MIN_DELETED 64 // Deleted slots are reclaimed once there are at least this many...
+#define COMPACT_DELETED_RATIO 4 // ...and they make up at least 1/COMPACT_DELETED_RATIO of the slots
+#define DOB_DAYS 73414 // Days from 1/1/1900 to 31/12/2100, the dates isValidDate accepts
+#define AGE_BANDS 6 // Age bands of the member demographics report
+#define NAME_ARENA_EMPTY UINT32_MAX // Free bucket in a NameArena's table
+#define SEGMENT_SHIFT 12
+#define SEGMENT_RECORDS (1 << SEGMENT_SHIFT) // Records per storage segment, a multiple of CHECKSUM_BLOCK_RECORDS
+#define SEGMENT_SPARE 2 // Empty segments a list keeps after shrinking, so it does not free and reallocate at a boundary
 
 typedef struct{
     int day;
@@ -25,12 +90,223 @@ typedef struct{
     Date dob;
 } Member;
 
+typedef enum{
+    GENDER_MALE,
+    GENDER_FEMALE,
+    GENDER_UNKNOWN // Only in records from before gender was validated
+} Gender;
+
+// A member as MemberList and members.dat store it: names are offsets of interned strings in the
+// list's NameArena, phone numbers are packed by phoneKey and the closed sets are codes. Member is
+// unpacked from it for the prompts, the log and the exports.
+typedef struct{
+    uint64_t phoneNum; // phoneKey(phoneNum), 0 if empty
+    uint64_t emergencyPhone;
+    int memberID;
+    uint32_t firstName;
+    uint32_t lastName;
+    uint32_t emergencyName;
+    int birthDay; // dayNumber(dob), -1 if the date is not valid
+    uint8_t gender; // Gender
+    uint8_t emergencyRelation; // Index into relationNames
+} PackedMember;
+
+// Record types stored in the write-ahead log
+typedef enum{
+    WAL_MEMBER_PUT = 1, // Payload is a full Member, inserted or replaced by memberID
+    WAL_MEMBER_DELETE, // Payload is the deleted memberID
+    WAL_EQUIPMENT_PUT, // Payload is a full Equipment, inserted or replaced by id
+    WAL_EQUIPMENT_DELETE, // Payload is the deleted equipment id
+    WAL_VISIT, // Payload is a Visit, in a visit log
+    WAL_REPORT, // Payload is a StoredReport, in the report history
+    WAL_STATUS_CHANGE // Payload is a StatusChange, in the equipment status time series
+} WalRecordType;
+
+// Every log record starts with this header, followed by 'length' bytes of payload
+typedef struct{
+    uint32_t length; // Payload size in bytes
+    uint32_t crc; // CRC32C of the type and payload, used to detect torn or corrupt records
+    uint32_t type; // One of WalRecordType
+} WalRecordHeader;
+
+// Append-only operation log. Mutations are staged in 'buffer' and made durable together by walCommit (group commit)
+typedef struct{
+    int fd; // -1 when logging is disabled (e.g. while replaying)
+    char path[256];
+    const char *snapshotPath; // The .dat file this log is checkpointed into
+    unsigned char *buffer;
+    size_t used; // Bytes staged in buffer and not yet written
+    int loggedRecords; // Records in the log since the last checkpoint
+} WriteAheadLog;
+
+// Bitmap of list slots changed since the last save
+typedef struct{
+    unsigned char *bits;
+    int capacity; // Slots covered by bits, a multiple of 8
+    int count; // Number of bits set
+} DirtySet;
+
+typedef struct{
+    int key;
+    int slot; // -1 marks an empty entry
+} IdIndexEntry;
+
+// Open-addressing hash table (linear probing) from a record ID to its position in the list
+typedef struct{
+    IdIndexEntry *entries;
+    int capacity; // A power of two, kept at least twice the count
+    int shift; // 32 - log2(capacity)
+    int count;
+} IdIndex;
+
+// A reference to a record that stays valid while the record moves between slots (growth, shrink,
+// compaction) and fails to resolve once the record is deleted. Generation 0 is a null handle.
+typedef struct{
+    uint32_t entry; // Position in the list's HandleTable
+    uint32_t generation; // Must equal the entry's generation
+} RecordHandle;
+
+typedef struct{
+    int slot; // Slot of the record, or the next free entry while the entry is unused
+    uint32_t generation; // Bumped when the record is deleted, invalidating its handles
+} HandleEntry;
+
+// Slot map from handles to the slots of a list, with the reverse map to follow records as they move
+typedef struct{
+    HandleEntry *entries;
+    int count; // Entries in use or on the free list
+    int capacity;
+    int freeEntry; // First unused entry, -1 if there is none
+    int *slotEntries; // Slot -> entry, -1 for a deleted slot
+    int slotCapacity;
+} HandleTable;
+
+typedef struct{
+    uint64_t key;
+    int count; // IDs stored under the key, 0 for an empty entry
+    int capacity; // Size of 'ids' once count has exceeded 1
+    int first; // The only ID while count is 1
+    int *ids; // All IDs in the order they were added, once count has exceeded 1
+} KeyMultimapEntry;
+
+// Open-addressing hash table (linear probing) from a 64-bit key to the IDs of the records that
+// have it. Each key has one entry however many records share it, so lookups cost one probe run
+// plus the number of matches.
+typedef struct{
+    KeyMultimapEntry *entries;
+    int capacity; // A power of two, kept at least twice the count
+    int shift; // 64 - log2(capacity)
+    int count; // Distinct keys
+} KeyMultimap;
+
+// Members by date of birth. isValidDate limits dates to 1900-2100, so every day in that range has
+// a bucket, and a Fenwick tree over the bucket sizes counts the members born in any range of days
+// and finds the next non-empty day in logarithmic time.
 typedef struct{
-    int count; // Amount of current members
+    KeyMultimap days; // dayNumber(dob) -> memberIDs
+    KeyMultimap birthdays; // month * 32 + day -> memberIDs
+    int *counts; // Fenwick tree of the day bucket sizes, 1-based
+} DobIndex;
+
+// The fields that searches and reports scan, stored one array per field next to the packed records
+// (which keep every field, since the data files, --mmap and snapshots use that layout). A scan of
+// these reads about 17 bytes per member instead of a whole record. Indexed by slot, like the records.
+typedef struct{
+    int *ids; // memberID, 0 for a deleted slot
+    int *birthDays; // dayNumber(dob)
+    char *genders; // 'M', 'F' or '?'
+    uint32_t *firstNames; // Offsets into the list's NameArena
+    uint32_t *lastNames;
     int capacity;
-    Member *members;
+} MemberColumns;
+
+typedef enum{
+    SNAPSHOT_IDLE,
+    SNAPSHOT_QUEUED, // Handed to the worker, which owns the data file until it is done
+    SNAPSHOT_DONE // Written (or failed), waiting to be picked up by the main thread
+} SnapshotState;
+
+// Interned strings: each distinct name is stored once, NUL-terminated, and records refer to it by
+// offset (offset 0 is the empty string). Strings are never removed one at a time; the arena is
+// rebuilt from the live records once it has doubled since it was last built.
+typedef struct{
+    char *bytes; // Followed by NAME_LENGTH bytes of zeroed slack, so the matchers can read whole fields
+    size_t used;
+    size_t capacity;
+    uint32_t *table; // Open addressing: offsets of the strings, NAME_ARENA_EMPTY for a free bucket
+    size_t tableSize; // A power of two
+    size_t strings;
+    size_t packedUsed; // 'used' when the arena was last built or loaded
+} NameArena;
+
+typedef struct SnapshotWorker SnapshotWorker;
+
+// Records kept in fixed-size segments found through a directory, so a growing list adds a segment
+// instead of moving the records it already holds. The first 'loadedSegments' segments point into
+// 'loaded', the block a data file was read or mapped into; the others are separate heap segments.
+typedef struct{
+    unsigned char **segments; // Segment directory
+    int segmentCount;
+    int directoryCapacity;
+    size_t recordSize;
+    void *loaded; // Heap block or file mapping the loaded segments point into, NULL if none
+    size_t loadedLength; // Length of 'loaded' when it is a mapping, 0 when it is heap memory
+    int loadedSegments;
+} SegmentStore;
+
+// One background save of a list: a private copy of its records taken between menu actions
+typedef struct{
+    SnapshotWorker *worker; // NULL when saves happen in the foreground
+    SnapshotState state;
+    int result; // 1 if the snapshot was written
+    const char *filename;
+    struct RecordSchema *schema;
+    SegmentStore records;
+    int count;
+    char *strings; // Copy of the string section, NULL if the file has none
+    size_t stringBytes;
+    off_t logBoundary; // Log size when the copy was taken, the log before it is in the snapshot
+    int loggedRecords; // Log records before logBoundary
+    time_t startedAt;
+} SnapshotJob;
+
+struct SnapshotWorker{
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t wake; // Signalled when a job is queued or the worker should stop
+    pthread_cond_t finished; // Signalled when a job is done
+    SnapshotJob *queue[2];
+    int queued;
+    int stopping;
+};
+
+typedef struct{
+    int count; // Slots in use, including deleted members (memberID 0) not yet compacted away
+    int deletedCount; // Deleted members among the first 'count' slots
+    SegmentStore store; // PackedMember records, reached through packedMemberAt and readMember
+    NameArena names; // The names the packed records and the name columns refer to
+    WriteAheadLog log;
+    DirtySet dirty; // Slots that differ from members.dat
+    IdIndex idIndex; // memberID -> slot
+    HandleTable handles;
+    KeyMultimap firstNameIndex; // Case-folded first name -> memberIDs
+    KeyMultimap lastNameIndex; // Case-folded last name -> memberIDs
+    KeyMultimap fullNameIndex; // Case-folded first and last name -> memberIDs
+    KeyMultimap trigramIndex; // Trigram of a lower-cased name word -> memberIDs, for fuzzy search
+    KeyMultimap phoneIndex; // phoneKey(phoneNum) -> memberIDs
+    KeyMultimap emergencyPhoneIndex; // phoneKey(emergencyPhone) -> memberIDs
+    DobIndex dobIndex;
+    MemberColumns columns;
+    int persistedCount; // Records in members.dat after the last save or load, -1 if it must be rewritten in full
+    SnapshotJob snapshot;
 } MemberList;
 
+// printUpcomingBirthdays state: the list, and the last day a heading was printed for
+typedef struct{
+    MemberList *list;
+    Date heading;
+} BirthdayPrinter;
+
 typedef struct{
     int memberID;
     char membershipType[15]; // Essential, Premium, or Student
@@ -40,20 +316,105 @@ typedef struct{
     Date startDate;
 } Membership;
 
+typedef enum{
+    EQUIPMENT_OPERATIONAL,
+    EQUIPMENT_UNDER_MAINTENANCE
+} EquipmentStatus;
+
 typedef struct{
     char name[50];
     int totalQuantity;
     int functional; // number of functional equipment from totalQuantity
     int broken; // number of equipment that needs repair/broken
-    char status[20]; // "Operational" or "Under Maintenance"
+    EquipmentStatus status; // Printed with equipmentStatusNames
     Date repairETA; // Date when the equipment should be operational again
     int id;
 } Equipment;
 
+// Equipment as format version 1 stored it, with the status as text
+typedef struct{
+    char name[50];
+    int totalQuantity;
+    int functional;
+    int broken;
+    char status[20];
+    Date repairETA;
+    int id;
+} EquipmentV1;
+
+// One status change of an equipment, as the status time series stores it
+typedef struct{
+    int equipmentID;
+    uint32_t changedAt; // Seconds since the epoch
+    int status; // EquipmentStatus after the change
+    int repairETADay; // dayNumber(repairETA) while under maintenance, -1 otherwise
+} StatusChange;
+
+// Aggregates over the status changes of one equipment, updated as each change is added so the
+// statistics never go back over the history
+typedef struct{
+    int equipmentID;
+    uint32_t firstSeen; // Time of the first change
+    uint32_t downSince; // Start of the repair in progress, 0 while operational
+    int promisedDay; // ETA given when that repair started, -1 if none
+    int failures; // Changes to under maintenance
+    int repairs; // Changes back to operational
+    int64_t downSeconds; // Total length of the finished repairs
+    int estimatedRepairs; // Finished repairs that had an ETA...
+    int onTimeRepairs; // ...those done on or before it...
+    int64_t daysLate; // ...and their total days past the ETA, negative when early
+} StatusStats;
+
+// Every equipment status change in the order they happened, with per-equipment aggregates.
+// equipment.dat.status holds the changes; the rest is rebuilt from them on load.
+typedef struct{
+    int count;
+    SegmentStore store; // StatusChange records
+    KeyMultimap byEquipment; // equipmentID -> positions of its changes, oldest first
+    IdIndex statsIndex; // equipmentID -> position in 'stats'
+    StatusStats *stats;
+    int statsCount;
+    int statsCapacity;
+    int recording; // 0 while equipment.dat and its log are loaded, their changes are already here
+    int unsynced; // Changes recorded since the log was last synced
+    WriteAheadLog log;
+} StatusHistory;
+
+// A repair in progress, due on its ETA
+typedef struct{
+    int etaDay; // dayNumber(repairETA)
+    int equipmentID;
+} RepairTimer;
+
+// Min-heap of the repairs in progress ordered by ETA, with each equipment's place in it, so a
+// status change adds, moves or removes its timer in O(log n) and the next ETA is always on top
+typedef struct{
+    RepairTimer *timers;
+    int count;
+    int capacity;
+    IdIndex positions; // equipmentID -> index in 'timers'
+} RepairSchedule;
+
+// Sums over the live equipment, kept up to date by every change so a report does not scan the list
+typedef struct{
+    int totalQuantity;
+    int functional;
+    int broken;
+} EquipmentTotals;
+
 typedef struct {
-    int count; // Number of equipment currently in the list
-    int capacity; // Maximum capacity before the need to reallocate
-    Equipment *equipments; // Ptr to an array of Equipment structs
+    int count; // Slots in use, including deleted equipment (id 0) not yet compacted away
+    int deletedCount; // Deleted equipment among the first 'count' slots
+    SegmentStore store; // The equipment, reached through equipmentAt
+    WriteAheadLog log;
+    DirtySet dirty; // Slots that differ from equipment.dat
+    IdIndex idIndex; // Equipment id -> slot
+    HandleTable handles;
+    EquipmentTotals totals;
+    StatusHistory statusHistory;
+    RepairSchedule schedule; // The equipment under maintenance with an ETA
+    int persistedCount; // Records in equipment.dat after the last save or load, -1 if it must be rewritten in full
+    SnapshotJob snapshot;
 } EquipmentList;
 
 // Members can notify employees and/or employees can use the system to fill out the report function when made aware of broken equipment
@@ -66,6 +427,27 @@ typedef struct{
     char summary[200]; // Summary of the report
 } Report;
 
+// A report as the report history keeps it; the summary is rebuilt from the totals
+typedef struct{
+    int reportID;
+    int reportDay; // dayNumber(report_date)
+    int totalEquipment;
+    int functional;
+    int broken;
+} StoredReport;
+
+// Every report generated, in the order they were made. reports.log holds the records; the
+// indexes are rebuilt when it is loaded.
+typedef struct{
+    int count;
+    SegmentStore store; // StoredReport records, in the order they were generated
+    IdIndex idIndex; // reportID -> position
+    int *byDate; // Positions ordered by reportDay, reports of the same day in the order they were made
+    int byDateCapacity;
+    int nextReportID;
+    WriteAheadLog log;
+} ReportHistory;
+
 // Used if a member would like to terminate their membership or done by employee due to violation
 typedef struct{
     int memberID;
@@ -74,14 +456,333 @@ typedef struct{
     char notes [200]; // Notes to explain termination to have on file if necessary
 } TerminateMembership;
 
+// A CSV row that could not be imported
+typedef struct{
+    long line; // Line number within the chunk
+    const char *reason;
+} ImportRejection;
+
+// The part of an import batch parsed by one thread
+typedef struct{
+    const char *start;
+    const char *end;
+    Date today;
+    Member *members; // Valid rows, in file order
+    long *memberLines; // Line number within the chunk of each valid row
+    int count;
+    int capacity;
+    ImportRejection *rejections;
+    int rejectionCount;
+    int rejectionCapacity;
+    long lines; // Lines in the chunk
+} ImportChunk;
+
+// State of a --batch run
+typedef struct{
+    MemberList *members;
+    EquipmentList *equipment;
+    int *nextMemberID;
+    int *nextEquipmentID;
+    Date today;
+    int memberChanges; // Changes since the member log was last committed
+    int equipmentChanges;
+    ReportHistory *reports; // REPORT adds its report here, NULL to not keep them
+} BatchSession;
+
+// A search text prepared for fieldMatches: lower-cased and zero-padded
+typedef struct{
+    char folded[SCAN_PATTERN_BYTES];
+    int length;
+    int substring; // 1 to find the text anywhere in the field, 0 to match the whole field
+} ScanPattern;
+
+typedef enum{
+    EXPORT_CSV,
+    EXPORT_JSON_LINES
+} ExportFormat;
+
+// Output buffer for exports. Records are formatted straight into 'data' and written out in
+// EXPORT_BUFFER_SIZE pieces; the memory is kept for the next export.
+typedef struct{
+    int fd;
+    char *data;
+    size_t used;
+    int failed; // Set when a write fails, later output is dropped
+} OutputBuffer;
+
+// One turnstile scan, as the visit logs store it
+typedef struct{
+    int64_t scannedAt; // Microseconds since the epoch
+    int memberID;
+} Visit;
+
+// A slot of the check-in queue. Its sequence number tells whose turn it is: it equals the position
+// a producer claims while the slot is free, and is one more once the visit in it is ready.
+typedef struct{
+    _Atomic uint64_t sequence;
+    Visit visit;
+} CheckInSlot;
+
+// Lock-free queue of turnstile scans. Any number of threads add to it with checkInPush; one
+// consumer thread takes the scans off in batches and appends them to the visit log of the day.
+typedef struct{
+    CheckInSlot *slots;
+    uint64_t mask; // CHECKIN_QUEUE_SLOTS - 1
+    _Alignas(64) _Atomic uint64_t tail; // Next position a producer claims
+    _Alignas(64) uint64_t head; // Next position the consumer takes, only the consumer uses it
+    _Atomic int consumerSleeping; // Set while the consumer waits on wakeFd
+    _Atomic int stopping;
+    int wakeFd; // eventfd that wakes the consumer
+    pthread_t consumer;
+    const char *prefix; // Start of the visit log names
+    WriteAheadLog log; // Visit log of the day being written, fd -1 before the first visit
+    int logDay; // dayNumber of that day
+    long logged; // Visits appended and synced, only the consumer uses these
+    long lost; // Visits dropped because the visit log could not be opened
+    long batches;
+} CheckInQueue;
+
+// A --checkin-bench producer thread, standing in for a turnstile
+typedef struct{
+    CheckInQueue *queue;
+    MemberList *members;
+    int scans;
+    int maxMemberID; // Scans are for IDs 1 to maxMemberID, deleted ones are turned away
+    unsigned int seed;
+    long *latencies; // Nanoseconds to validate and queue each scan
+    long rejected; // Scans of IDs that are not members
+    long fullWaits; // Times the queue was full and the scan had to be retried
+} CheckInProducer;
+
+// A connection to --server, served by one worker thread
+typedef struct ServerClient{
+    int fd;
+    uint32_t events; // What the worker's epoll waits for
+    char input[SERVER_INPUT_BYTES]; // Received bytes of incomplete request lines
+    size_t inputUsed;
+    OutputBuffer reply; // Answers not sent yet. It grows instead of being flushed, 'fd' is unused.
+    size_t replyCapacity;
+    size_t replySent;
+    int finished; // The client closed its side; the connection closes once the reply is sent
+    struct ServerClient *previous, *next; // The worker's connections
+} ServerClient;
+
+struct Server;
+
+// A --server thread with its own epoll instance; the accepting thread hands it connections
+typedef struct{
+    struct Server *server;
+    int epollFd;
+    pthread_t thread;
+    pthread_mutex_t clientsLock; // Guards 'clients', which the accepting thread adds to
+    ServerClient *clients;
+} ServerWorker;
+
+// State shared by the --server threads. Queries run in parallel under the read lock; write
+// commands and log maintenance hold it exclusively.
+typedef struct Server{
+    MemberList *members;
+    EquipmentList *equipment;
+    BatchSession session; // Write commands run as batch commands
+    pthread_rwlock_t lock;
+    int listenFd;
+    int stopFd; // Read end of the pipe that stopServer writes to
+    CheckInQueue *checkIns; // Takes the CHECKIN scans, NULL if the queue could not be started
+    ServerWorker workers[SERVER_MAX_THREADS];
+    int workerCount;
+} Server;
+
+// One connection of --loadgen
+typedef struct{
+    const char *path;
+    int requests;
+    int writePercent;
+    int maxMemberID; // GET_MEMBER asks for IDs 1 to maxMemberID
+    unsigned int seed;
+    long *latencies; // Nanoseconds from sending each request to reading its answer
+    long errors; // Requests answered with ERR
+    int failed; // Set if the connection failed
+} LoadClient;
+
+// Options set from the command line
+int useMappedFiles = 0; // --mmap: map members.dat and equipment.dat instead of reading them into memory
+int snapshotIntervalSeconds = SNAPSHOT_INTERVAL_SECONDS; // --snapshot-interval: save unsaved changes at least this often, 0 to disable
+int snapshotDirtyRecords = SNAPSHOT_DIRTY_RECORDS; // --snapshot-dirty: save as soon as this many records changed
+int autoRestoreEquipment = 0; // --auto-restore: make equipment Operational once its repair ETA has passed, instead of listing it as overdue
+int checkEquipmentTotals = 0; // --check-totals: recount the equipment for every report and warn if the running totals differ
+int serverThreadCount = 0; // --server-threads: threads serving clients, 0 for one per core (at least SERVER_MIN_THREADS)
+int serverStopFd = -1; // Write end of the pipe that stops --server
+
+char *exportBuffer = NULL; // Shared by all exports, allocated by the first one
+
+// Field types that can appear in an on-disk schema
+typedef enum{
+    FIELD_INT32, // 32-bit integer, stored little-endian
+    FIELD_INT64, // 64-bit integer, stored little-endian
+    FIELD_CHARS // Fixed-size character array (or 8-bit code), stored as is
+} FieldKind;
+
+typedef struct{
+    const char *name;
+    FieldKind kind;
+    size_t structOffset; // Position of the field in the in-memory struct
+    size_t length; // Size in bytes
+    size_t diskOffset; // Position of the field in the encoded record, set by initRecordSchema
+} FieldDescriptor;
+
+// Description of how one struct type is stored in a data file, built from its *_SCHEMA list
+typedef struct RecordSchema{
+    FieldDescriptor *fields;
+    int fieldCount;
+    size_t structSize;
+    uint16_t version; // Written to the file header
+    size_t recordSize; // Encoded record size, set by initRecordSchema
+    int identity; // 1 if the encoded record is the in-memory struct byte for byte
+    struct RecordSchema *previous; // Layout of the previous format version, which is loaded and upgraded
+} RecordSchema;
+
+// On-disk schemas: one FIELD(struct, field, kind, bytes) entry per stored field, in file order.
+// The codec, the record size and the layout checks below are all generated from these lists.
+// members.dat holds PackedMember records; Member records are what the log holds, and what
+// members.dat held up to format version 1.
+#define PACKED_MEMBER_SCHEMA(FIELD) \
+    FIELD(PackedMember, phoneNum, FIELD_INT64, 8) \
+    FIELD(PackedMember, emergencyPhone, FIELD_INT64, 8) \
+    FIELD(PackedMember, memberID, FIELD_INT32, 4) \
+    FIELD(PackedMember, firstName, FIELD_INT32, 4) \
+    FIELD(PackedMember, lastName, FIELD_INT32, 4) \
+    FIELD(PackedMember, emergencyName, FIELD_INT32, 4) \
+    FIELD(PackedMember, birthDay, FIELD_INT32, 4) \
+    FIELD(PackedMember, gender, FIELD_CHARS, 1) \
+    FIELD(PackedMember, emergencyRelation, FIELD_CHARS, 1)
+
+#define MEMBER_SCHEMA(FIELD) \
+    FIELD(Member, memberID, FIELD_INT32, 4) \
+    FIELD(Member, firstName, FIELD_CHARS, 50) \
+    FIELD(Member, lastName, FIELD_CHARS, 50) \
+    FIELD(Member, phoneNum, FIELD_CHARS, 15) \
+    FIELD(Member, gender, FIELD_CHARS, 1) \
+    FIELD(Member, emergencyName, FIELD_CHARS, 50) \
+    FIELD(Member, emergencyPhone, FIELD_CHARS, 15) \
+    FIELD(Member, emergencyRelation, FIELD_CHARS, 10) \
+    FIELD(Member, dob.day, FIELD_INT32, 4) \
+    FIELD(Member, dob.month, FIELD_INT32, 4) \
+    FIELD(Member, dob.year, FIELD_INT32, 4)
+
+#define EQUIPMENT_SCHEMA(FIELD) \
+    FIELD(Equipment, name, FIELD_CHARS, 50) \
+    FIELD(Equipment, totalQuantity, FIELD_INT32, 4) \
+    FIELD(Equipment, functional, FIELD_INT32, 4) \
+    FIELD(Equipment, broken, FIELD_INT32, 4) \
+    FIELD(Equipment, status, FIELD_INT32, 4) \
+    FIELD(Equipment, repairETA.day, FIELD_INT32, 4) \
+    FIELD(Equipment, repairETA.month, FIELD_INT32, 4) \
+    FIELD(Equipment, repairETA.year, FIELD_INT32, 4) \
+    FIELD(Equipment, id, FIELD_INT32, 4)
+
+#define EQUIPMENT_V1_SCHEMA(FIELD) \
+    FIELD(EquipmentV1, name, FIELD_CHARS, 50) \
+    FIELD(EquipmentV1, totalQuantity, FIELD_INT32, 4) \
+    FIELD(EquipmentV1, functional, FIELD_INT32, 4) \
+    FIELD(EquipmentV1, broken, FIELD_INT32, 4) \
+    FIELD(EquipmentV1, status, FIELD_CHARS, 20) \
+    FIELD(EquipmentV1, repairETA.day, FIELD_INT32, 4) \
+    FIELD(EquipmentV1, repairETA.month, FIELD_INT32, 4) \
+    FIELD(EquipmentV1, repairETA.year, FIELD_INT32, 4) \
+    FIELD(EquipmentV1, id, FIELD_INT32, 4)
+
+#define VISIT_SCHEMA(FIELD) \
+    FIELD(Visit, scannedAt, FIELD_INT64, 8) \
+    FIELD(Visit, memberID, FIELD_INT32, 4)
+
+#define REPORT_SCHEMA(FIELD) \
+    FIELD(StoredReport, reportID, FIELD_INT32, 4) \
+    FIELD(StoredReport, reportDay, FIELD_INT32, 4) \
+    FIELD(StoredReport, totalEquipment, FIELD_INT32, 4) \
+    FIELD(StoredReport, functional, FIELD_INT32, 4) \
+    FIELD(StoredReport, broken, FIELD_INT32, 4)
+
+#define STATUS_CHANGE_SCHEMA(FIELD) \
+    FIELD(StatusChange, equipmentID, FIELD_INT32, 4) \
+    FIELD(StatusChange, changedAt, FIELD_INT32, 4) \
+    FIELD(StatusChange, status, FIELD_INT32, 4) \
+    FIELD(StatusChange, repairETADay, FIELD_INT32, 4)
+
+#define SCHEMA_CHECK(type, field, kind, bytes) \
+    _Static_assert(sizeof(((type *)0)->field) == (bytes), #type "." #field " does not match its schema entry");
+#define SCHEMA_FIELD(type, field, kind, bytes) { #field, kind, offsetof(type, field), bytes, 0 },
+
+PACKED_MEMBER_SCHEMA(SCHEMA_CHECK)
+MEMBER_SCHEMA(SCHEMA_CHECK)
+EQUIPMENT_SCHEMA(SCHEMA_CHECK)
+EQUIPMENT_V1_SCHEMA(SCHEMA_CHECK)
+VISIT_SCHEMA(SCHEMA_CHECK)
+REPORT_SCHEMA(SCHEMA_CHECK)
+STATUS_CHANGE_SCHEMA(SCHEMA_CHECK)
+
+FieldDescriptor packedMemberFields[] = { PACKED_MEMBER_SCHEMA(SCHEMA_FIELD) };
+FieldDescriptor memberFields[] = { MEMBER_SCHEMA(SCHEMA_FIELD) };
+FieldDescriptor equipmentFields[] = { EQUIPMENT_SCHEMA(SCHEMA_FIELD) };
+FieldDescriptor equipmentV1Fields[] = { EQUIPMENT_V1_SCHEMA(SCHEMA_FIELD) };
+FieldDescriptor visitFields[] = { VISIT_SCHEMA(SCHEMA_FIELD) };
+FieldDescriptor reportFields[] = { REPORT_SCHEMA(SCHEMA_FIELD) };
+FieldDescriptor statusChangeFields[] = { STATUS_CHANGE_SCHEMA(SCHEMA_FIELD) };
+
+RecordSchema memberSchema = { memberFields, sizeof(memberFields) / sizeof(memberFields[0]), sizeof(Member), 1, 0, 0, NULL };
+RecordSchema packedMemberSchema = { packedMemberFields, sizeof(packedMemberFields) / sizeof(packedMemberFields[0]), sizeof(PackedMember),
+                                    MEMBER_FORMAT_VERSION, 0, 0, &memberSchema };
+RecordSchema equipmentV1Schema = { equipmentV1Fields, sizeof(equipmentV1Fields) / sizeof(equipmentV1Fields[0]), sizeof(EquipmentV1), 1, 0, 0, NULL };
+RecordSchema equipmentSchema = { equipmentFields, sizeof(equipmentFields) / sizeof(equipmentFields[0]), sizeof(Equipment),
+                                 EQUIPMENT_FORMAT_VERSION, 0, 0, &equipmentV1Schema };
+RecordSchema visitSchema = { visitFields, sizeof(visitFields) / sizeof(visitFields[0]), sizeof(Visit), 1, 0, 0, NULL };
+RecordSchema reportSchema = { reportFields, sizeof(reportFields) / sizeof(reportFields[0]), sizeof(StoredReport), 1, 0, 0, NULL };
+RecordSchema statusChangeSchema = { statusChangeFields, sizeof(statusChangeFields) / sizeof(statusChangeFields[0]),
+                                    sizeof(StatusChange), 1, 0, 0, NULL };
+
+// Data file layout: this header, recordCount encoded records, then one little-endian CRC32C
+// per block of blockRecords records
+typedef struct{
+    uint32_t magic; // DATA_FILE_MAGIC
+    uint16_t version; // Format version of the record schema
+    uint16_t headerSize; // Records start right after the header
+    uint32_t recordSize; // Bytes per encoded record
+    uint32_t recordCount;
+    uint32_t blockRecords; // Records covered by each checksum in the trailer
+    uint32_t stringBytes; // Size of the string section after the trailer, 0 if there is none
+    uint32_t reserved;
+    uint32_t headerCrc; // CRC32C of the header fields above
+} DataFileHeader;
+
+// Start of a redo file. It is followed by entryCount (uint32 slot, encoded record) pairs, the new
+// checksum trailer, stringBytes of string section and its CRC32C (if stringBytes is not 0), the new
+// DataFileHeader and a CRC32C of everything before it.
+typedef struct{
+    uint32_t magic; // REDO_FILE_MAGIC
+    uint32_t recordSize;
+    uint32_t entryCount;
+    uint32_t trailerBlocks;
+    uint32_t stringBytes; // 0 when the string section is unchanged
+} RedoHeader;
+
+typedef enum{
+    DATA_FILE_MISSING,
+    DATA_FILE_LOADED,
+    DATA_FILE_LEGACY // An unversioned file that should be rewritten in the current format
+} DataFileStatus;
+
+int saveMembersToFile(MemberList *list, const char *filename);
+int saveEquipmentToFile(EquipmentList *list, const char *filename);
+void syncEquipmentLog(EquipmentList *list);
+
 Date getCurrentDate() {
     Date currentDate;
     time_t now = time(NULL);
-    struct tm *t = localtime(&now);
+    struct tm t;
+    localtime_r(&now, &t); // Server threads call this concurrently
 
-    currentDate.day = t->tm_mday;
-    currentDate.month = t->tm_mon + 1;
-    currentDate.year = t->tm_year + 1900;
+    currentDate.day = t.tm_mday;
+    currentDate.month = t.tm_mon + 1;
+    currentDate.year = t.tm_year + 1900;
 
     return currentDate;
 }
@@ -147,1240 +848,7638 @@ int calculateAge(Date dob, Date currentDate) {
     return age;
 }
 
-void printMember(const Member *member){
-    printf("Member ID: %d\n", member->memberID);
-    printf("First Name: %s\n", member->firstName);
-    printf("Last Name: %s\n", member->lastName);
-    printf("Phone Number: %s\n", member->phoneNum);
-    printf("Gender: %c\n", member->gender);
-    printf("Emergency Contact Name: %s\n", member->emergencyName);
-    printf("Emergency Contact Phone: %s\n", member->emergencyPhone);
-    printf("Emergency Contact Relation: %s\n", member->emergencyRelation);
-    printf("Date of Birth: %02d/%02d/%04d\n", member->dob.day, member->dob.month, member->dob.year);
-    printf("-------------------------------\n");
-}
+// Emergency contact relations offered by the menus, in menu order
+const char *relationNames[] = {"Spouse", "Partner", "Friend", "Relative", "Parent", "Other"}; // "Other" stays last
+const char genderLetters[] = "MF?"; // Letter of each Gender
+const int ageBandStarts[AGE_BANDS] = {0, 18, 26, 36, 51, 66}; // Youngest age in each demographics band
+const char *equipmentStatusNames[] = {"Operational", "Under Maintenance"}; // By EquipmentStatus
 
-void addMember(MemberList *list, Member *member){
-    // Check if list is full
-    if(list->count == list->capacity){
-        list->capacity *= 2;
-
-        // Reallocate memory for new capacity
-        list->members = realloc(list->members, list->capacity * sizeof(Member));
-        if(list->members == NULL){
-            // Handle memory allocation failure
-            printf("Memory allocation failed!\n");
-            exit(1);
-        }
+// Function to check a person's name: at least 2 characters, letters and spaces only
+int isValidPersonName(const char *name) {
+    size_t length = strlen(name);
+    if (length < 2)
+        return 0;
+    for (size_t i = 0; i < length; i++) {
+        if (!isalpha((unsigned char)name[i]) && !isspace((unsigned char)name[i]))
+            return 0;
     }
-
-    // Add new member
-    list->members[list->count] = *member;
-    list->count++;
+    return 1;
 }
 
-void deleteMember(MemberList *list, int memberID){
+// Function to check a phone number: digits only, at least 7 of them
+int isValidPhoneNumber(const char *phone) {
+    size_t length = strlen(phone);
+    if (length < 7)
+        return 0;
+    for (size_t i = 0; i < length; i++) {
+        if (!isdigit((unsigned char)phone[i]))
+            return 0;
+    }
+    return 1;
+}
 
-    int foundIndex = -1;
+// CRC32C (Castagnoli) used to checksum persisted data, table-driven fallback
+uint32_t crc32cSoftware(uint32_t crc, const void *data, size_t length) {
+    static uint32_t table[256];
+    static int tableReady = 0;
 
-    for (int i = 0; i < list->count; i++){
-        if(list->members[i].memberID == memberID){
-            foundIndex = i;
-            break;
+    if (!tableReady) {
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t value = i;
+            for (int bit = 0; bit < 8; bit++) {
+                value = (value & 1) ? (value >> 1) ^ 0x82F63B78u : value >> 1;
+            }
+            table[i] = value;
         }
+        tableReady = 1;
     }
 
-    // Member not found if foundIndex = -1
-    if (foundIndex == -1){
-        printf("Member with ID %d not found.\n", memberID);
-        return;
+    const unsigned char *bytes = data;
+    crc = ~crc;
+    for (size_t i = 0; i < length; i++) {
+        crc = table[(crc ^ bytes[i]) & 0xFF] ^ (crc >> 8);
     }
+    return ~crc;
+}
 
-    // Shift all subsequent members to the left by 1
-    for(int i = foundIndex; i < list->count - 1; i++){
-        list->members[i] = list->members[i+1];
+#if defined(__x86_64__)
+// CRC32C using the SSE4.2 crc32 instruction, 8 bytes per step
+__attribute__((target("sse4.2")))
+uint32_t crc32cHardware(uint32_t crc, const void *data, size_t length) {
+    const unsigned char *bytes = data;
+    uint64_t value = ~crc;
+    while (length >= 8) {
+        uint64_t word;
+        memcpy(&word, bytes, 8);
+        value = _mm_crc32_u64(value, word);
+        bytes += 8;
+        length -= 8;
     }
-
-    // Decrement the member count since a member was deleted
-    list->count--;
-
-    // Check if capacity should be reduced for efficiency when member count falls below half the capacity
-    if (list->count > 0 && list->count <= list->capacity / 2){
-        // Halve capacity
-        list->capacity /= 2;
-
-        list->members = realloc(list->members, list->capacity * sizeof(Member));
-
-        if(list->members == NULL){
-            printf("Memory reallocation failed!\n");
-            exit(1); // Handle reallocation failure
-        }
+    uint32_t value32 = (uint32_t)value;
+    while (length > 0) {
+        value32 = _mm_crc32_u8(value32, *bytes++);
+        length--;
     }
+    return ~value32;
 }
 
-void listMembers(MemberList *list){
-    // Check for an empty list
-    if (list->count == 0){
-        printf("There are no current members in the database\n");
-        return;
+// Checksums three equally sized blocks at once. The crc32 instruction has a latency of three
+// cycles but can start every cycle, so three independent streams keep it busy.
+__attribute__((target("sse4.2")))
+void crc32cHardware3(const unsigned char *block, size_t blockBytes, uint32_t *crcs) {
+    const unsigned char *a = block, *b = block + blockBytes, *c = block + 2 * blockBytes;
+    uint64_t crcA = 0xFFFFFFFFu, crcB = 0xFFFFFFFFu, crcC = 0xFFFFFFFFu;
+    size_t i = 0;
+    for (; i + 8 <= blockBytes; i += 8) {
+        uint64_t wordA, wordB, wordC;
+        memcpy(&wordA, a + i, 8);
+        memcpy(&wordB, b + i, 8);
+        memcpy(&wordC, c + i, 8);
+        crcA = _mm_crc32_u64(crcA, wordA);
+        crcB = _mm_crc32_u64(crcB, wordB);
+        crcC = _mm_crc32_u64(crcC, wordC);
+    }
+    uint32_t tailA = (uint32_t)crcA, tailB = (uint32_t)crcB, tailC = (uint32_t)crcC;
+    for (; i < blockBytes; i++) {
+        tailA = _mm_crc32_u8(tailA, a[i]);
+        tailB = _mm_crc32_u8(tailB, b[i]);
+        tailC = _mm_crc32_u8(tailC, c[i]);
+    }
+    crcs[0] = ~tailA;
+    crcs[1] = ~tailB;
+    crcs[2] = ~tailC;
+}
+#endif
+
+// Returns 1 if the CPU has a CRC32C instruction
+int hasHardwareCrc32c(void) {
+#if defined(__x86_64__)
+    static int supported = -1;
+    if (supported == -1) {
+        supported = __builtin_cpu_supports("sse4.2") ? 1 : 0;
     }
+    return supported;
+#else
+    return 0;
+#endif
+}
 
-    for(int i = 0; i < list->count; i++){
-        printMember(&list->members[i]);
+uint32_t crc32c(uint32_t crc, const void *data, size_t length) {
+#if defined(__x86_64__)
+    if (hasHardwareCrc32c()) {
+        return crc32cHardware(crc, data, length);
     }
+#endif
+    return crc32cSoftware(crc, data, length);
 }
 
-Member* findMemberByID(MemberList *list, int memberID){
-    for(int i = 0; i <list->count; i++){
-        if(list->members[i].memberID == memberID){
-            return &list->members[i];
+// Computes the CRC32C of every 'blockBytes'-sized block of data (the last block may be shorter)
+void crc32cBlocks(const void *data, size_t totalBytes, size_t blockBytes, uint32_t *crcs) {
+    const unsigned char *bytes = data;
+    size_t fullBlocks = totalBytes / blockBytes;
+    size_t block = 0;
+
+#if defined(__x86_64__)
+    if (hasHardwareCrc32c()) {
+        for (; block + 3 <= fullBlocks; block += 3) {
+            crc32cHardware3(bytes + block * blockBytes, blockBytes, crcs + block);
         }
     }
-
-    // If member not found
-    return NULL;
+#endif
+    for (; block < fullBlocks; block++) {
+        crcs[block] = crc32c(0, bytes + block * blockBytes, blockBytes);
+    }
+    if (totalBytes % blockBytes != 0) {
+        crcs[block] = crc32c(0, bytes + block * blockBytes, totalBytes % blockBytes);
+    }
 }
 
-void searchMembers(MemberList *list) {
-    if (list->count == 0) {
-        printf("No members found in the database.\n");
-        return;
+// Case-insensitive matching of a search text against a fixed-size, NUL-terminated text field
+// (such as Member.firstName), used by the full-table searches. Only ASCII letters are folded,
+// like strcasecmp in the C locale.
+int fieldMatchesScalar(const char *field, size_t fieldSize, const ScanPattern *pattern) {
+    size_t length = strnlen(field, fieldSize);
+    size_t patternLength = (size_t)pattern->length;
+    if (!pattern->substring) {
+        if (length != patternLength) {
+            return 0;
+        }
+        for (size_t i = 0; i < length; i++) {
+            if (tolower((unsigned char)field[i]) != (unsigned char)pattern->folded[i]) {
+                return 0;
+            }
+        }
+        return 1;
     }
-
-    int searchChoice;
-    printf("Search by:\n");
-    printf("1. Member ID\n");
-    printf("2. First Name\n");
-    printf("3. Last Name\n");
-    printf("4. Both First and Last Name\n");
-    printf("Enter your choice (1-4): ");
-    if (scanf("%d", &searchChoice) != 1 || searchChoice < 1 || searchChoice > 4) {
-        printf("Invalid choice.\n");
-        while (getchar() != '\n');
-        return;
+    for (size_t start = 0; start + patternLength <= length; start++) {
+        size_t i = 0;
+        while (i < patternLength && tolower((unsigned char)field[start + i]) == (unsigned char)pattern->folded[i]) {
+            i++;
+        }
+        if (i == patternLength) {
+            return 1;
+        }
     }
-    getchar(); // consume newline
+    return 0;
+}
 
-    switch (searchChoice) {
-        case 1: {
-            // Search by Member ID
-            printf("Enter member ID to search: ");
-            int searchID;
-            if (scanf("%d", &searchID) != 1) {
-                printf("Invalid input. Please enter a valid member ID.\n");
-                while (getchar() != '\n');
-                return;
-            }
-            getchar();
+#if defined(__x86_64__)
+// Lower-cases the ASCII letters of 16 bytes
+__m128i foldLower16(__m128i bytes) {
+    __m128i upper = _mm_and_si128(_mm_cmpgt_epi8(bytes, _mm_set1_epi8('A' - 1)),
+                                  _mm_cmplt_epi8(bytes, _mm_set1_epi8('Z' + 1)));
+    return _mm_or_si128(bytes, _mm_and_si128(upper, _mm_set1_epi8(0x20)));
+}
 
-            Member *foundMember = findMemberByID(list, searchID);
-            if (foundMember != NULL) {
-                printMember(foundMember);
-            } else {
-                printf("Member with ID %d not found.\n", searchID);
-            }
-            break;
-        }
-        case 2: {
-            // Search by First Name
-            char firstName[50];
-            printf("Enter first name to search: ");
-            fgets(firstName, sizeof(firstName), stdin);
-            firstName[strcspn(firstName, "\n")] = '\0';
+// SSE2 version of fieldMatchesScalar for fields of 16 to SCAN_FIELD_MAX bytes. Whole-field matches
+// fold and compare 16 bytes at a time, so most fields are rejected after one compare. For
+// substrings the field is folded into a copy, and 16 start positions at a time are compared
+// against the first and last letter of the pattern; only those hits are checked in full.
+int fieldMatchesSse2(const char *field, size_t fieldSize, const ScanPattern *pattern) {
+    size_t patternLength = (size_t)pattern->length;
 
-            int found = 0;
-            for (int i = 0; i < list->count; i++) {
-                if (strcasecmp(list->members[i].firstName, firstName) == 0) {
-                    printMember(&list->members[i]);
-                    found = 1;
-                }
-            }
-            if (!found) {
-                printf("No members found with the first name '%s'.\n", firstName);
-            }
-            break;
+    if (!pattern->substring) {
+        // Compare through the terminator, which pattern->folded has as well
+        if (patternLength > fieldSize) {
+            return 0;
         }
-        case 3: {
-            // Search by Last Name
-            char lastName[50];
-            printf("Enter last name to search: ");
-            fgets(lastName, sizeof(lastName), stdin);
-            lastName[strcspn(lastName, "\n")] = '\0';
-
-            int found = 0;
-            for (int i = 0; i < list->count; i++) {
-                if (strcasecmp(list->members[i].lastName, lastName) == 0) {
-                    printMember(&list->members[i]);
-                    found = 1;
-                }
+        size_t compare = patternLength < fieldSize ? patternLength + 1 : fieldSize;
+        size_t offset = 0;
+        for (; offset < compare && offset + 16 <= fieldSize; offset += 16) {
+            __m128i text = foldLower16(_mm_loadu_si128((const __m128i *)(field + offset)));
+            __m128i wanted = _mm_loadu_si128((const __m128i *)(pattern->folded + offset));
+            unsigned int differ = ~(unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(text, wanted)) & 0xFFFF;
+            if (compare - offset < 16) {
+                differ &= (1u << (compare - offset)) - 1;
             }
-            if (!found) {
-                printf("No members found with the last name '%s'.\n", lastName);
+            if (differ != 0) {
+                return 0;
             }
-            break;
         }
-        case 4: {
-            // Search by Both First and Last Name
-            char firstName[50], lastName[50];
-            printf("Enter first name to search: ");
-            fgets(firstName, sizeof(firstName), stdin);
-            firstName[strcspn(firstName, "\n")] = '\0';
-
-            printf("Enter last name to search: ");
-            fgets(lastName, sizeof(lastName), stdin);
-            lastName[strcspn(lastName, "\n")] = '\0';
-
-            int found = 0;
-            for (int i = 0; i < list->count; i++) {
-                if (strcasecmp(list->members[i].firstName, firstName) == 0 &&
-                    strcasecmp(list->members[i].lastName, lastName) == 0) {
-                    printMember(&list->members[i]);
-                    found = 1;
-                }
-            }
-            if (!found) {
-                printf("No members found with the name '%s %s'.\n", firstName, lastName);
+        for (; offset < compare; offset++) {
+            if (tolower((unsigned char)field[offset]) != (unsigned char)pattern->folded[offset]) {
+                return 0;
             }
-            break;
         }
-        default:
-            printf("Invalid choice.\n");
+        return 1;
     }
-}
-
-void addEquipment(EquipmentList *list, Equipment *equipment){
-    // Check if list is full
-    if(list->count == list->capacity){
-        list->capacity *= 2;
 
-        // Reallocate memory for new capacity
-        list->equipments = realloc(list->equipments, list->capacity * sizeof(Equipment));
+    // Fold into a copy and find the terminator; the last load overlaps the one before instead of
+    // reading past the field. The shifted loads below read up to 16 bytes past the field's text.
+    unsigned char folded[SCAN_FIELD_MAX + 16];
+    uint64_t terminators = 0;
+    for (size_t offset = 0; offset < fieldSize; offset += 16) {
+        size_t at = offset + 16 <= fieldSize ? offset : fieldSize - 16;
+        __m128i bytes = _mm_loadu_si128((const __m128i *)(field + at));
+        _mm_storeu_si128((__m128i *)(folded + at), foldLower16(bytes));
+        terminators |= (uint64_t)(unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_setzero_si128())) << at;
+    }
+    _mm_storeu_si128((__m128i *)(folded + fieldSize), _mm_setzero_si128());
+    size_t length = terminators != 0 ? (size_t)__builtin_ctzll(terminators) : fieldSize;
 
-        if(list->equipments == NULL){
-            printf("Memory Allocation Failed!\n");
-            exit(1);
+    if (patternLength == 0) {
+        return 1;
+    }
+    if (patternLength > length) {
+        return 0;
+    }
+    __m128i first = _mm_set1_epi8(pattern->folded[0]);
+    __m128i last = _mm_set1_epi8(pattern->folded[patternLength - 1]);
+    size_t positions = length - patternLength + 1;
+    for (size_t start = 0; start < positions; start += 16) {
+        __m128i atFirst = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(folded + start)), first);
+        __m128i atLast = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(folded + start + patternLength - 1)), last);
+        unsigned int hits = (unsigned int)_mm_movemask_epi8(_mm_and_si128(atFirst, atLast));
+        if (positions - start < 16) {
+            hits &= (1u << (positions - start)) - 1;
+        }
+        while (hits != 0) {
+            size_t at = start + (size_t)__builtin_ctz(hits);
+            if (patternLength <= 2 || memcmp(folded + at + 1, pattern->folded + 1, patternLength - 2) == 0) {
+                return 1;
+            }
+            hits &= hits - 1;
         }
     }
+    return 0;
+}
 
-    list->equipments[list->count] = *equipment;
-    list->count++;
+__attribute__((target("avx2")))
+__m256i foldLower32(__m256i bytes) {
+    __m256i upper = _mm256_and_si256(_mm256_cmpgt_epi8(bytes, _mm256_set1_epi8('A' - 1)),
+                                     _mm256_cmpgt_epi8(_mm256_set1_epi8('Z' + 1), bytes));
+    return _mm256_or_si256(bytes, _mm256_and_si256(upper, _mm256_set1_epi8(0x20)));
 }
 
-void deleteEquipment(EquipmentList *list, int equipmentID){
-    int foundIndex = -1;
+// AVX2 version of fieldMatchesSse2 for fields of 32 to SCAN_FIELD_MAX bytes, 32 bytes at a time
+__attribute__((target("avx2")))
+int fieldMatchesAvx2(const char *field, size_t fieldSize, const ScanPattern *pattern) {
+    size_t patternLength = (size_t)pattern->length;
 
-    for (int i = 0; i < list->count; i++){
-        if(list->equipments[i].id == equipmentID){
-            foundIndex = i;
-            break;
+    if (!pattern->substring) {
+        // Compare through the terminator, which pattern->folded has as well
+        if (patternLength > fieldSize) {
+            return 0;
+        }
+        size_t compare = patternLength < fieldSize ? patternLength + 1 : fieldSize;
+        size_t offset = 0;
+        for (; offset < compare && offset + 32 <= fieldSize; offset += 32) {
+            __m256i text = foldLower32(_mm256_loadu_si256((const __m256i *)(field + offset)));
+            __m256i wanted = _mm256_loadu_si256((const __m256i *)(pattern->folded + offset));
+            uint32_t differ = ~(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(text, wanted));
+            if (compare - offset < 32) {
+                differ &= (1u << (compare - offset)) - 1;
+            }
+            if (differ != 0) {
+                return 0;
+            }
+        }
+        for (; offset < compare; offset++) {
+            if (tolower((unsigned char)field[offset]) != (unsigned char)pattern->folded[offset]) {
+                return 0;
+            }
         }
+        return 1;
     }
 
-    // Equipment not found if foundIndex = -1
-    if (foundIndex == -1){
-        printf("Equipment with ID %d not found.\n", equipmentID);
-        return;
+    // Fold into a copy and find the terminator; the last load overlaps the one before instead of
+    // reading past the field. The shifted loads below read up to 32 bytes past the field's text.
+    unsigned char folded[SCAN_FIELD_MAX + 32];
+    uint64_t terminators = 0;
+    for (size_t offset = 0; offset < fieldSize; offset += 32) {
+        size_t at = offset + 32 <= fieldSize ? offset : fieldSize - 32;
+        __m256i bytes = _mm256_loadu_si256((const __m256i *)(field + at));
+        _mm256_storeu_si256((__m256i *)(folded + at), foldLower32(bytes));
+        terminators |= (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(bytes, _mm256_setzero_si256())) << at;
     }
+    _mm256_storeu_si256((__m256i *)(folded + fieldSize), _mm256_setzero_si256());
+    size_t length = terminators != 0 ? (size_t)__builtin_ctzll(terminators) : fieldSize;
 
-    // Shift all subsequent equipments to the left by 1
-    for(int i = foundIndex; i < list->count - 1; i++){
-        list->equipments[i] = list->equipments[i+1];
+    if (patternLength == 0) {
+        return 1;
     }
-
-    // Decrement count
-    list->count--;
-
-    // Check if capacity should be reduced for efficiency
-    if (list->count > 0 && list->count <= list->capacity / 2){
-        // Halve capacity
-        list->capacity /= 2;
-
-        list->equipments = realloc(list->equipments, list->capacity * sizeof(Equipment));
-
-        if(list->equipments == NULL){
-            printf("Memory reallocation failed!\n");
-            exit(1); // Handle reallocation failure
+    if (patternLength > length) {
+        return 0;
+    }
+    __m256i first = _mm256_set1_epi8(pattern->folded[0]);
+    __m256i last = _mm256_set1_epi8(pattern->folded[patternLength - 1]);
+    size_t positions = length - patternLength + 1;
+    for (size_t start = 0; start < positions; start += 32) {
+        __m256i atFirst = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(folded + start)), first);
+        __m256i atLast = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(folded + start + patternLength - 1)), last);
+        uint32_t hits = (uint32_t)_mm256_movemask_epi8(_mm256_and_si256(atFirst, atLast));
+        if (positions - start < 32) {
+            hits &= (1u << (positions - start)) - 1;
+        }
+        while (hits != 0) {
+            size_t at = start + (size_t)__builtin_ctz(hits);
+            if (patternLength <= 2 || memcmp(folded + at + 1, pattern->folded + 1, patternLength - 2) == 0) {
+                return 1;
+            }
+            hits &= hits - 1;
         }
     }
+    return 0;
+}
+#endif
+
+// Returns 1 if the CPU has AVX2
+int hasAvx2(void) {
+#if defined(__x86_64__)
+    static int supported = -1;
+    if (supported == -1) {
+        supported = __builtin_cpu_supports("avx2") ? 1 : 0;
+    }
+    return supported;
+#else
+    return 0;
+#endif
 }
 
-void updateEquipmentStatus(Equipment *equipment) {
-    printf("Current status: %s\n", equipment->status);
-
-    // Get the current date
-    Date currentDate = getCurrentDate();
+int fieldMatches(const char *field, size_t fieldSize, const ScanPattern *pattern) {
+#if defined(__x86_64__)
+    if (fieldSize >= 32 && fieldSize <= SCAN_FIELD_MAX && hasAvx2()) {
+        return fieldMatchesAvx2(field, fieldSize, pattern);
+    }
+    if (fieldSize >= 16 && fieldSize <= SCAN_FIELD_MAX) {
+        return fieldMatchesSse2(field, fieldSize, pattern);
+    }
+#endif
+    return fieldMatchesScalar(field, fieldSize, pattern);
+}
 
-    // Present a menu for status selection
-    int statusChoice;
-    while (1) {
-        printf("Select new status:\n");
-        printf("1. Operational\n");
-        printf("2. Under Maintenance\n");
-        printf("Choose an option (1-2): ");
-        if (scanf("%d", &statusChoice) != 1) {
-            printf("Invalid input. Please enter 1 or 2.\n");
-            while (getchar() != '\n');
-            continue;
-        }
-        getchar(); // Consume newline
+// Prepares 'text' for fieldMatches: whole-field match, or anywhere in the field with 'substring'
+void initScanPattern(ScanPattern *pattern, const char *text, int substring) {
+    memset(pattern->folded, 0, sizeof(pattern->folded));
+    size_t length = strnlen(text, SCAN_FIELD_MAX - 1);
+    for (size_t i = 0; i < length; i++) {
+        pattern->folded[i] = (char)tolower((unsigned char)text[i]);
+    }
+    pattern->length = (int)length;
+    pattern->substring = substring;
+}
 
-        if (statusChoice == 1 || statusChoice == 2) {
-            break;
-        } else {
-            printf("Invalid choice. Please select 1 or 2.\n");
+// Function to write a whole buffer, retrying short writes
+int writeFully(int fd, const void *data, size_t length) {
+    const unsigned char *bytes = data;
+    while (length > 0) {
+        ssize_t written = write(fd, bytes, length);
+        if (written < 0) {
+            return 0;
         }
+        bytes += written;
+        length -= (size_t)written;
     }
+    return 1;
+}
 
-    if (statusChoice == 1) {
-        strcpy(equipment->status, "Operational");
-        // Set repairETA to 0
-        equipment->repairETA.day = 0;
-        equipment->repairETA.month = 0;
-        equipment->repairETA.year = 0;
-    } else {
-        strcpy(equipment->status, "Under Maintenance");
+// Writes out the buffered bytes
+void outputFlush(OutputBuffer *out) {
+    if (out->used > 0 && !out->failed && !writeFully(out->fd, out->data, out->used)) {
+        out->failed = 1;
+    }
+    out->used = 0;
+}
 
-        while (1) { // Loop until a valid date is entered
-            printf("Enter the repair ETA (dd mm yyyy): ");
-            int day, month, year;
-            if (scanf("%d %d %d", &day, &month, &year) != 3) {
-                printf("Error: Invalid date format. Please enter the day, month, and year as integers.\n");
-                // Clear the input buffer in the event of an invalid entry
-                while (getchar() != '\n'); // Discard invalid input
-                continue; // Re-prompt user
-            }
-            getchar();
+// Makes room for one record; callers then append at most EXPORT_RECORD_MAX bytes without checks
+void outputReserveRecord(OutputBuffer *out) {
+    if (EXPORT_BUFFER_SIZE - out->used < EXPORT_RECORD_MAX) {
+        outputFlush(out);
+    }
+}
 
-            // Validate the date
-            if (!isValidDate(day, month, year)) {
-                printf("Error: Invalid date entered. Please enter a valid date.\n");
-                continue;
-            }
+void outputChar(OutputBuffer *out, char c) {
+    out->data[out->used++] = c;
+}
 
-            Date repairETA = { day, month, year };
+void outputText(OutputBuffer *out, const char *text) {
+    size_t length = strlen(text);
+    memcpy(out->data + out->used, text, length);
+    out->used += length;
+}
 
-            int cmpResult = compareDates(repairETA, currentDate);
-            if (cmpResult < 0) {
-                printf("Error: Repair ETA cannot be in the past.\n");
-            } else {
-                // Update the repair ETA date
-                equipment->repairETA.day = day;
-                equipment->repairETA.month = month;
-                equipment->repairETA.year = year;
-                break; // Exit the loop if the date is valid
-            }
-        }
+void outputInt(OutputBuffer *out, int value) {
+    char digits[12];
+    int length = 0;
+    unsigned int magnitude = value < 0 ? 0u - (unsigned int)value : (unsigned int)value;
+    do {
+        digits[length++] = (char)('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude > 0);
+    if (value < 0) {
+        outputChar(out, '-');
+    }
+    while (length > 0) {
+        outputChar(out, digits[--length]);
     }
+}
 
-    printf("The equipment status has been successfully updated.\n");
+// Appends 'value' with at least 'width' digits, padded with zeros like printf's %0*d
+void outputPaddedInt(OutputBuffer *out, int value, int width) {
+    int digits = 1;
+    for (int rest = value / 10; rest != 0; rest /= 10) {
+        digits++;
+    }
+    for (; value >= 0 && digits < width; digits++) {
+        outputChar(out, '0');
+    }
+    outputInt(out, value);
 }
 
-void generateReport(EquipmentList *list, Report *report){
+// Appends a date as dd/mm/yyyy, the format the menus use
+void outputDate(OutputBuffer *out, Date date) {
+    outputPaddedInt(out, date.day, 2);
+    outputChar(out, '/');
+    outputPaddedInt(out, date.month, 2);
+    outputChar(out, '/');
+    outputPaddedInt(out, date.year, 4);
+}
 
-    // Initialize report fields
-    report->total_equipment_count = 0;
-    report->total_functional_equipment = 0;
-    report->total_broken_equipment = 0;
+// Appends a CSV field, quoted if it contains a comma, quote or line break.
+// 'size' bounds the field so a record without a terminator cannot overrun the buffer.
+void outputCsvField(OutputBuffer *out, const char *text, size_t size) {
+    size_t length = strnlen(text, size);
+    if (strcspn(text, ",\"\r\n") >= length) {
+        memcpy(out->data + out->used, text, length);
+        out->used += length;
+        return;
+    }
+    outputChar(out, '"');
+    for (size_t i = 0; i < length; i++) {
+        if (text[i] == '"') {
+            outputChar(out, '"');
+        }
+        outputChar(out, text[i]);
+    }
+    outputChar(out, '"');
+}
 
-    for(int i = 0; i < list->count; i++){
-        report->total_equipment_count += list->equipments[i].totalQuantity;
-        report->total_functional_equipment += list->equipments[i].functional;
-        report->total_broken_equipment += list->equipments[i].broken;
+// Appends a quoted JSON string, escaping quotes, backslashes and control characters
+void outputJsonString(OutputBuffer *out, const char *text, size_t size) {
+    const char hexDigits[] = "0123456789abcdef";
+    outputChar(out, '"');
+    for (size_t i = 0; i < size && text[i] != '\0'; i++) {
+        unsigned char c = (unsigned char)text[i];
+        if (c == '"' || c == '\\') {
+            outputChar(out, '\\');
+            outputChar(out, (char)c);
+        } else if (c < 0x20) {
+            outputText(out, "\\u00");
+            outputChar(out, hexDigits[c >> 4]);
+            outputChar(out, hexDigits[c & 15]);
+        } else {
+            outputChar(out, (char)c);
+        }
     }
+    outputChar(out, '"');
+}
 
-    // Set report date to current live date
-    report->report_date = getCurrentDate();
 
-    // Generate report summary
-    snprintf(report->summary, sizeof(report->summary),
-        "Total Equipment: %d\nFunctional Equipment: %d\nBroken Equipment: %d\n",
-        report->total_equipment_count,
-        report->total_functional_equipment,
-        report->total_broken_equipment);
+// Marks one slot as changed since the last save, growing the bitmap as needed
+void markDirty(DirtySet *set, int slot) {
+    if (slot >= set->capacity) {
+        int newCapacity = set->capacity > 0 ? set->capacity : 1024;
+        while (newCapacity <= slot) {
+            newCapacity *= 2;
+        }
+        set->bits = realloc(set->bits, (size_t)newCapacity / 8);
+        if (set->bits == NULL) {
+            printf("Memory allocation failed!\n");
+            exit(1);
+        }
+        memset(set->bits + set->capacity / 8, 0, (size_t)(newCapacity - set->capacity) / 8);
+        set->capacity = newCapacity;
+    }
+    unsigned char mask = (unsigned char)(1u << (slot % 8));
+    if (!(set->bits[slot / 8] & mask)) {
+        set->bits[slot / 8] |= mask;
+        set->count++;
+    }
+}
 
-    // Displays report
-    printf("Report Date: %02d/%02d/%04d\n", report->report_date.day, report->report_date.month, report->report_date.year);
-    printf("%s", report->summary);
+void markDirtyRange(DirtySet *set, int first, int last) {
+    for (int slot = last; slot >= first; slot--) {
+        markDirty(set, slot);
+    }
+}
 
+int isDirty(const DirtySet *set, int slot) {
+    return slot < set->capacity && (set->bits[slot / 8] & (1u << (slot % 8)));
 }
 
-void memberManagementMenu(MemberList *memberList, int *nextMemberID) {
-    int choice;
-    do {
-        printf("==========================================\n");
-        printf("        Member Management\n");
-        printf("==========================================\n");
-        printf("1. Add a New Member\n");
-        printf("2. List All Members\n");
-        printf("3. Find a Member\n");
-        printf("4. Update Member Details\n");
-        printf("5. Delete a Member\n");
-        printf("6. Back to Main Menu\n");
-        printf("==========================================\n");
-        printf("Enter your choice (1-6): \n");
-        if (scanf("%d", &choice) != 1) {
-            printf("Invalid input. Please enter a number between 1-6.\n");
-            while (getchar() != '\n');
+void clearDirty(DirtySet *set) {
+    if (set->bits != NULL) {
+        memset(set->bits, 0, (size_t)set->capacity / 8);
+    }
+    set->count = 0;
+}
+
+// Returns 1 if any slot in [first, last) is dirty
+int isRangeDirty(const DirtySet *set, int first, int last) {
+    for (int slot = first; slot < last && slot < set->capacity; slot++) {
+        if (slot % 8 == 0 && slot + 8 <= last && set->bits[slot / 8] == 0) {
+            slot += 7; // Skip a clean byte at once
             continue;
         }
-        getchar();  // Consume the newline character left in the buffer
+        if (isDirty(set, slot)) {
+            return 1;
+        }
+    }
+    return 0;
+}
 
-    switch(choice) {
-        case 1: {
-            Member newMember;
-            newMember.memberID = (*nextMemberID)++;
+// Home entry of 'key' (Fibonacci hashing: the multiply spreads consecutive IDs over the table)
+unsigned int idIndexHome(const IdIndex *index, int key) {
+    return ((uint32_t)key * 2654435769u) >> index->shift;
+}
 
-            // Input First Name
-            while (1) {
-                printf("Enter first name: ");
-                fgets(newMember.firstName, sizeof(newMember.firstName), stdin);
-                newMember.firstName[strcspn(newMember.firstName, "\n")] = '\0'; // remove newline
+// Resizes the table to 'capacity' entries and re-inserts everything
+void idIndexResize(IdIndex *index, int capacity) {
+    IdIndexEntry *old = index->entries;
+    int oldCapacity = index->capacity;
 
-                // Check if name contains only letters and spaces and is at least 2 characters
-                int validName = 1;
-                if (strlen(newMember.firstName) < 2) {
-                    validName = 0;
-                } else {
-                    for (size_t i = 0; i < strlen(newMember.firstName); i++) {
-                        if (!isalpha(newMember.firstName[i]) && !isspace(newMember.firstName[i])) {
-                            validName = 0;
-                            break;
-                        }
-                    }
-                }
+    index->entries = malloc((size_t)capacity * sizeof(IdIndexEntry));
+    if (index->entries == NULL) {
+        printf("Memory allocation failed!\n");
+        exit(1);
+    }
+    for (int i = 0; i < capacity; i++) {
+        index->entries[i].slot = -1;
+    }
+    index->capacity = capacity;
+    index->shift = 32;
+    for (int size = capacity; size > 1; size /= 2) {
+        index->shift--;
+    }
 
-                if (!validName) {
-                    printf("Invalid first name. Please enter a valid name with at least 2 letters.\n");
-                } else {
-                    break;
-                }
+    for (int i = 0; i < oldCapacity; i++) {
+        if (old[i].slot >= 0) {
+            unsigned int entry = idIndexHome(index, old[i].key);
+            while (index->entries[entry].slot >= 0) {
+                entry = (entry + 1) & (unsigned int)(capacity - 1);
             }
+            index->entries[entry] = old[i];
+        }
+    }
+    free(old);
+}
 
-            // Input Last Name
-            while (1) {
-                printf("Enter last name: ");
-                fgets(newMember.lastName, sizeof(newMember.lastName), stdin);
-                newMember.lastName[strcspn(newMember.lastName, "\n")] = '\0'; // remove newline
-
-                // Check if name contains only letters and spaces and is at least 2 characters
-                int validName = 1;
-                if (strlen(newMember.lastName) < 2) {
-                    validName = 0;
-                } else {
-                    for (size_t i = 0; i < strlen(newMember.lastName); i++) {
-                        if (!isalpha(newMember.lastName[i]) && !isspace(newMember.lastName[i])) {
-                            validName = 0;
-                            break;
-                        }
-                    }
-                }
+// Creates an empty index sized for 'expected' keys
+void idIndexInit(IdIndex *index, int expected) {
+    int capacity = 16;
+    while (capacity < expected * 2) {
+        capacity *= 2;
+    }
+    index->entries = NULL;
+    index->capacity = 0;
+    index->count = 0;
+    idIndexResize(index, capacity);
+}
 
-                if (!validName) {
-                    printf("Invalid last name. Please enter a valid name with at least 2 letters.\n");
-                } else {
-                    break;
-                }
-            }
+// Returns the slot stored for 'key', or -1 if there is none
+int idIndexGet(const IdIndex *index, int key) {
+    if (index->count == 0) {
+        return -1;
+    }
+    unsigned int entry = idIndexHome(index, key);
+    while (index->entries[entry].slot >= 0) {
+        if (index->entries[entry].key == key) {
+            return index->entries[entry].slot;
+        }
+        entry = (entry + 1) & (unsigned int)(index->capacity - 1);
+    }
+    return -1;
+}
 
-            // Input Phone Number
-            while (1) {
-                printf("Enter phone number (digits only): ");
-                fgets(newMember.phoneNum, sizeof(newMember.phoneNum), stdin);
-                newMember.phoneNum[strcspn(newMember.phoneNum, "\n")] = '\0';
+// Inserts 'key' or moves it to 'slot'
+void idIndexPut(IdIndex *index, int key, int slot) {
+    if ((index->count + 1) * 2 > index->capacity) {
+        idIndexResize(index, index->capacity > 0 ? index->capacity * 2 : 16);
+    }
+    unsigned int entry = idIndexHome(index, key);
+    while (index->entries[entry].slot >= 0) {
+        if (index->entries[entry].key == key) {
+            index->entries[entry].slot = slot;
+            return;
+        }
+        entry = (entry + 1) & (unsigned int)(index->capacity - 1);
+    }
+    index->entries[entry].key = key;
+    index->entries[entry].slot = slot;
+    index->count++;
+}
 
-                // Validate phone number (digits only)
-                int validPhone = 1;
-                for (size_t i = 0; i < strlen(newMember.phoneNum); i++) {
-                    if (!isdigit(newMember.phoneNum[i])) {
-                        validPhone = 0;
-                        break;
-                    }
-                }
+// Removes 'key'. Later entries of the same probe run are moved back into the gap, so lookups
+// never need deletion markers.
+void idIndexRemove(IdIndex *index, int key) {
+    if (index->count == 0) {
+        return;
+    }
+    unsigned int mask = (unsigned int)(index->capacity - 1);
+    unsigned int gap = idIndexHome(index, key);
+    while (index->entries[gap].slot >= 0 && index->entries[gap].key != key) {
+        gap = (gap + 1) & mask;
+    }
+    if (index->entries[gap].slot < 0) {
+        return;
+    }
 
-                if (!validPhone || strlen(newMember.phoneNum) < 7) {
-                    printf("Invalid phone number. Please enter digits only, at least 7 digits.\n");
-                } else {
-                    break;
-                }
-            }
+    unsigned int entry = gap;
+    while (1) {
+        entry = (entry + 1) & mask;
+        if (index->entries[entry].slot < 0) {
+            break;
+        }
+        // Move the entry back unless its home lies cyclically in (gap, entry]
+        unsigned int home = idIndexHome(index, index->entries[entry].key);
+        if (((entry - home) & mask) >= ((entry - gap) & mask)) {
+            index->entries[gap] = index->entries[entry];
+            gap = entry;
+        }
+    }
+    index->entries[gap].slot = -1;
+    index->count--;
+}
 
-            // Input Gender
-            while (1) {
-                printf("Enter gender (M/F): ");
-                scanf("%c", &newMember.gender);
-                getchar(); // consume newline
-                newMember.gender = toupper(newMember.gender);
-                if (newMember.gender != 'M' && newMember.gender != 'F') {
-                    printf("Invalid gender. Please enter 'M' or 'F'.\n");
-                } else {
-                    break;
-                }
-            }
+void idIndexFree(IdIndex *index) {
+    free(index->entries);
+    index->entries = NULL;
+    index->capacity = 0;
+    index->count = 0;
+}
 
-            // Input Emergency Contact Name
-            while (1) {
-                printf("Enter emergency contact name: ");
-                fgets(newMember.emergencyName, sizeof(newMember.emergencyName), stdin);
-                newMember.emergencyName[strcspn(newMember.emergencyName, "\n")] = '\0';
+void handleTableInit(HandleTable *table) {
+    table->entries = NULL;
+    table->count = 0;
+    table->capacity = 0;
+    table->freeEntry = -1;
+    table->slotEntries = NULL;
+    table->slotCapacity = 0;
+}
 
-                // Validate name
-                int validName = 1;
-                if (strlen(newMember.emergencyName) < 2) {
-                    validName = 0;
-                } else {
-                    for (size_t i = 0; i < strlen(newMember.emergencyName); i++) {
-                        if (!isalpha(newMember.emergencyName[i]) && !isspace(newMember.emergencyName[i])) {
-                            validName = 0;
-                            break;
-                        }
-                    }
-                }
+// Gives the record in 'slot' a handle entry
+void handleAttach(HandleTable *table, int slot) {
+    if (slot >= table->slotCapacity) {
+        int capacity = table->slotCapacity > 0 ? table->slotCapacity : 16;
+        while (capacity <= slot) {
+            capacity *= 2;
+        }
+        table->slotEntries = realloc(table->slotEntries, (size_t)capacity * sizeof(int));
+        if (table->slotEntries == NULL) {
+            printf("Memory allocation failed!\n");
+            exit(1);
+        }
+        for (int i = table->slotCapacity; i < capacity; i++) {
+            table->slotEntries[i] = -1;
+        }
+        table->slotCapacity = capacity;
+    }
 
-                if (!validName) {
-                    printf("Invalid name. Please enter a valid name with at least 2 letters.\n");
-                } else {
-                    break;
-                }
+    int entry = table->freeEntry;
+    if (entry != -1) {
+        table->freeEntry = table->entries[entry].slot;
+    } else {
+        if (table->count == table->capacity) {
+            table->capacity = table->capacity > 0 ? table->capacity * 2 : 16;
+            table->entries = realloc(table->entries, (size_t)table->capacity * sizeof(HandleEntry));
+            if (table->entries == NULL) {
+                printf("Memory allocation failed!\n");
+                exit(1);
             }
+        }
+        entry = table->count++;
+        table->entries[entry].generation = 1;
+    }
+    table->entries[entry].slot = slot;
+    table->slotEntries[slot] = entry;
+}
 
-            // Input Emergency Contact Phone
-            while (1) {
-                printf("Enter emergency contact phone (digits only): ");
-                fgets(newMember.emergencyPhone, sizeof(newMember.emergencyPhone), stdin);
-                newMember.emergencyPhone[strcspn(newMember.emergencyPhone, "\n")] = '\0';
-
-                // Validate phone number
-                int validPhone = 1;
-                for (size_t i = 0; i < strlen(newMember.emergencyPhone); i++) {
-                    if (!isdigit(newMember.emergencyPhone[i])) {
-                        validPhone = 0;
-                        break;
-                    }
-                }
+// Invalidates the handles of the record in 'slot', which is being deleted
+void handleDetach(HandleTable *table, int slot) {
+    int entry = table->slotEntries[slot];
+    if (entry == -1) {
+        return;
+    }
+    table->slotEntries[slot] = -1;
+    if (++table->entries[entry].generation == 0) {
+        table->entries[entry].generation = 1; // Never reuse the null generation
+    }
+    table->entries[entry].slot = table->freeEntry;
+    table->freeEntry = entry;
+}
 
-                if (!validPhone || strlen(newMember.emergencyPhone) < 7) {
-                    printf("Invalid phone number. Please enter digits only, at least 7 digits.\n");
-                } else {
-                    break;
-                }
-            }
+// Follows a record from slot 'from' to slot 'to'
+void handleMove(HandleTable *table, int from, int to) {
+    int entry = table->slotEntries[from];
+    table->slotEntries[from] = -1;
+    table->slotEntries[to] = entry;
+    if (entry != -1) {
+        table->entries[entry].slot = to;
+    }
+}
 
-            // Input Emergency Contact Relation
-            int relationChoice;
-            while (1) {
-                printf("Select emergency contact relation:\n");
-                printf("1. Spouse\n");
-                printf("2. Partner\n");
-                printf("3. Friend\n");
-                printf("4. Relative\n");
-                printf("5. Parent\n");
-                printf("6. Other\n");
-                printf("Choose an option (1-6): ");
-                if (scanf("%d", &relationChoice) != 1) {
-                    printf("Invalid input. Please enter a number between 1-6.\n");
-                    while (getchar() != '\n');
-                    continue;
-                }
-                getchar(); // consume newline
+// The handle of the record in 'slot'
+RecordHandle handleAt(const HandleTable *table, int slot) {
+    RecordHandle handle = {0, 0};
+    int entry = slot >= 0 && slot < table->slotCapacity ? table->slotEntries[slot] : -1;
+    if (entry != -1) {
+        handle.entry = (uint32_t)entry;
+        handle.generation = table->entries[entry].generation;
+    }
+    return handle;
+}
 
-                if (relationChoice >=1 && relationChoice <=6) {
-                    break;
-                } else {
-                    printf("Invalid choice. Please select a number between 1 and 6.\n");
-                }
-            }
+// Returns the slot a handle refers to, or -1 if it is null or its record has been deleted
+int handleSlot(const HandleTable *table, RecordHandle handle) {
+    if (handle.generation == 0 || handle.entry >= (uint32_t)table->count ||
+        table->entries[handle.entry].generation != handle.generation) {
+        return -1;
+    }
+    return table->entries[handle.entry].slot;
+}
 
-            const char *relations[] = {"Spouse", "Partner", "Friend", "Relative", "Parent", "Other"};
-            strcpy(newMember.emergencyRelation, relations[relationChoice -1]);
+void handleTableFree(HandleTable *table) {
+    free(table->entries);
+    free(table->slotEntries);
+    handleTableInit(table);
+}
 
-            // Prompt for date of birth
-            while (1) {
-                printf("Enter date of birth (dd mm yyyy): ");
-                if (scanf("%d %d %d", &newMember.dob.day, &newMember.dob.month, &newMember.dob.year) != 3) {
-                    printf("Invalid date format. Please enter day month year as numbers.\n");
-                    while (getchar() != '\n');
-                    continue;
-                }
-                getchar();
+// Home entry of 'key', from the high bits of a Fibonacci hash
+unsigned int multimapHome(const KeyMultimap *map, uint64_t key) {
+    return (unsigned int)((key * 11400714819323198485ull) >> map->shift);
+}
 
-                // Validate date of birth
-                Date currentDate = getCurrentDate();
+void multimapResize(KeyMultimap *map, int capacity) {
+    KeyMultimapEntry *old = map->entries;
+    int oldCapacity = map->capacity;
 
-                if (!isValidDate(newMember.dob.day, newMember.dob.month, newMember.dob.year)) {
-                    printf("Invalid date of birth. Please enter a valid date.\n");
-                    continue;
-                }
+    map->entries = calloc((size_t)capacity, sizeof(KeyMultimapEntry));
+    if (map->entries == NULL) {
+        printf("Memory allocation failed!\n");
+        exit(1);
+    }
+    map->capacity = capacity;
+    map->shift = 64;
+    for (int size = capacity; size > 1; size /= 2) {
+        map->shift--;
+    }
 
-                int age = calculateAge(newMember.dob, currentDate);
-                if (age < 13) {
-                    printf("Member must be at least 13 years old to register.\n");
-                    continue;
-                }
-                break;
+    for (int i = 0; i < oldCapacity; i++) {
+        if (old[i].count > 0) {
+            unsigned int entry = multimapHome(map, old[i].key);
+            while (map->entries[entry].count > 0) {
+                entry = (entry + 1) & (unsigned int)(capacity - 1);
             }
+            map->entries[entry] = old[i];
+        }
+    }
+    free(old);
+}
 
-            // Now, add the member to the list
-            addMember(memberList, &newMember);
+// Returns the entry holding 'key', or NULL
+KeyMultimapEntry *multimapFind(const KeyMultimap *map, uint64_t key) {
+    if (map->count == 0) {
+        return NULL;
+    }
+    unsigned int entry = multimapHome(map, key);
+    while (map->entries[entry].count > 0) {
+        if (map->entries[entry].key == key) {
+            return &map->entries[entry];
+        }
+        entry = (entry + 1) & (unsigned int)(map->capacity - 1);
+    }
+    return NULL;
+}
 
-            printf("Member added successfully!\n");
-            break;
+// Points '*ids' at the IDs stored under 'key' and returns how many there are
+int multimapGet(const KeyMultimap *map, uint64_t key, const int **ids) {
+    KeyMultimapEntry *entry = multimapFind(map, key);
+    if (entry == NULL) {
+        return 0;
+    }
+    *ids = entry->count == 1 ? &entry->first : entry->ids;
+    return entry->count;
+}
+
+void multimapAdd(KeyMultimap *map, uint64_t key, int id) {
+    KeyMultimapEntry *found = multimapFind(map, key);
+    if (found == NULL) {
+        if ((map->count + 1) * 2 > map->capacity) {
+            multimapResize(map, map->capacity > 0 ? map->capacity * 2 : 16);
         }
-        case 2:
-            listMembers(memberList);
-            break;
-        case 3: {
-            searchMembers(memberList);
-            break;
+        unsigned int entry = multimapHome(map, key);
+        while (map->entries[entry].count > 0) {
+            entry = (entry + 1) & (unsigned int)(map->capacity - 1);
         }
-        case 4: {
-            printf("Enter member ID to update: ");
-            int updateID;
-            if (scanf("%d", &updateID) != 1) {
-                printf("Invalid input. Please enter a valid member ID.\n");
-                while (getchar() != '\n');
+        found = &map->entries[entry];
+        found->key = key;
+        found->count = 1;
+        found->capacity = 0;
+        found->first = id;
+        found->ids = NULL;
+        map->count++;
+        return;
+    }
+
+    if (found->count == found->capacity || found->ids == NULL) {
+        int capacity = found->capacity > 0 ? found->capacity * 2 : 4;
+        found->ids = realloc(found->ids, (size_t)capacity * sizeof(int));
+        if (found->ids == NULL) {
+            printf("Memory allocation failed!\n");
+            exit(1);
+        }
+        if (found->capacity == 0) {
+            found->ids[0] = found->first;
+        }
+        found->capacity = capacity;
+    }
+    found->ids[found->count++] = id;
+}
+
+// Removes one 'id' stored under 'key', keeping the others in order
+void multimapRemove(KeyMultimap *map, uint64_t key, int id) {
+    KeyMultimapEntry *found = multimapFind(map, key);
+    if (found == NULL) {
+        return;
+    }
+    if (found->count > 1) {
+        for (int i = 0; i < found->count; i++) {
+            if (found->ids[i] == id) {
+                memmove(found->ids + i, found->ids + i + 1, (size_t)(found->count - i - 1) * sizeof(int));
+                found->count--;
                 break;
             }
-            getchar();
+        }
+        if (found->count == 1) {
+            found->first = found->ids[0];
+            free(found->ids);
+            found->ids = NULL;
+            found->capacity = 0;
+        }
+        return;
+    }
+    if (found->first != id) {
+        return;
+    }
 
-            Member *memberToUpdate = findMemberByID(memberList, updateID);
+    // Last ID for the key: empty the entry and move later entries of the probe run back into the gap
+    unsigned int mask = (unsigned int)(map->capacity - 1);
+    unsigned int gap = (unsigned int)(found - map->entries);
+    unsigned int entry = gap;
+    while (1) {
+        entry = (entry + 1) & mask;
+        if (map->entries[entry].count == 0) {
+            break;
+        }
+        unsigned int home = multimapHome(map, map->entries[entry].key);
+        if (((entry - home) & mask) >= ((entry - gap) & mask)) {
+            map->entries[gap] = map->entries[entry];
+            gap = entry;
+        }
+    }
+    map->entries[gap].count = 0;
+    map->count--;
+}
 
-            if (memberToUpdate != NULL) {
-                int updateChoice;
-                printf("Which field do you want to update?\n");
-                printf("1. First Name\n");
-                printf("2. Last Name\n");
-                printf("3. Phone Number\n");
-                printf("4. Gender\n");
-                printf("5. Emergency Contact Name\n");
-                printf("6. Emergency Contact Phone\n");
-                printf("7. Emergency Contact Relation\n");
-                printf("8. Date of Birth\n");
-                printf("Enter choice (1-8): ");
-                if (scanf("%d", &updateChoice) != 1) {
-                    printf("Invalid input. Please enter a number between 1-8.\n");
-                    while (getchar() != '\n');
-                    break;
-                }
-                getchar();
+// Creates an empty map sized for 'expected' keys
+void multimapInit(KeyMultimap *map, int expected) {
+    map->entries = NULL;
+    map->capacity = 0;
+    map->count = 0;
 
-                switch (updateChoice) {
-                    case 1:
-                        while (1) {
-                            printf("Enter new first name: ");
-                            fgets(memberToUpdate->firstName, sizeof(memberToUpdate->firstName), stdin);
-                            memberToUpdate->firstName[strcspn(memberToUpdate->firstName, "\n")] = '\0';
+    int capacity = 16;
+    while (capacity < expected * 2) {
+        capacity *= 2;
+    }
+    multimapResize(map, capacity);
+}
 
-                            int validName = 1;
-                            if (strlen(memberToUpdate->firstName) < 2) {
-                                validName = 0;
-                            } else {
-                                for (size_t i = 0; i < strlen(memberToUpdate->firstName); i++) {
-                                    if (!isalpha(memberToUpdate->firstName[i]) && !isspace(memberToUpdate->firstName[i])) {
-                                        validName = 0;
-                                        break;
-                                    }
-                                }
-                            }
+void multimapFree(KeyMultimap *map) {
+    for (int i = 0; i < map->capacity; i++) {
+        free(map->entries[i].ids);
+    }
+    free(map->entries);
+    map->entries = NULL;
+    map->capacity = 0;
+    map->count = 0;
+}
 
-                            if (!validName) {
-                                printf("Invalid first name. Please enter a valid name with at least 2 letters.\n");
-                            } else {
-                                break;
-                            }
-                        }
-                        break;
-                    case 2:
-                        while (1) {
-                            printf("Enter new last name: ");
-                            fgets(memberToUpdate->lastName, sizeof(memberToUpdate->lastName), stdin);
-                            memberToUpdate->lastName[strcspn(memberToUpdate->lastName, "\n")] = '\0';
+// Days from 1/1/1900 to a date, or -1 if the date is not valid
+int dayNumber(Date date) {
+    if (!isValidDate(date.day, date.month, date.year))
+        return -1;
+    // Years are counted from March so that the leap day is the last day of a year
+    int year = date.month <= 2 ? date.year - 1 : date.year;
+    int era = year / 400;
+    int yearOfEra = year - era * 400;
+    int dayOfYear = (153 * (date.month > 2 ? date.month - 3 : date.month + 9) + 2) / 5 + date.day - 1;
+    int dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+    return era * 146097 + dayOfEra - 693901; // 693901 is 1/1/1900 counted the same way
+}
 
-                            int validName = 1;
-                            if (strlen(memberToUpdate->lastName) < 2) {
-                                validName = 0;
-                            } else {
-                                for (size_t i = 0; i < strlen(memberToUpdate->lastName); i++) {
-                                    if (!isalpha(memberToUpdate->lastName[i]) && !isspace(memberToUpdate->lastName[i])) {
-                                        validName = 0;
-                                        break;
-                                    }
-                                }
-                            }
+// The date 'days' days after 1/1/1900, the inverse of dayNumber
+Date dateFromDayNumber(int days) {
+    int shifted = days + 693901;
+    int era = shifted / 146097;
+    int dayOfEra = shifted - era * 146097;
+    int yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+    int dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+    int monthFromMarch = (5 * dayOfYear + 2) / 153;
+
+    Date date;
+    date.day = dayOfYear - (153 * monthFromMarch + 2) / 5 + 1;
+    date.month = monthFromMarch < 10 ? monthFromMarch + 3 : monthFromMarch - 9;
+    date.year = yearOfEra + era * 400 + (date.month <= 2 ? 1 : 0);
+    return date;
+}
 
-                            if (!validName) {
-                                printf("Invalid last name. Please enter a valid name with at least 2 letters.\n");
-                            } else {
-                                break;
-                            }
-                        }
-                        break;
-                    case 3:
-                        while (1) {
-                            printf("Enter new phone number: ");
-                            fgets(memberToUpdate->phoneNum, sizeof(memberToUpdate->phoneNum), stdin);
-                            memberToUpdate->phoneNum[strcspn(memberToUpdate->phoneNum, "\n")] = '\0';
+// The calendar day of a time in local time, as a dayNumber
+int localDayNumber(time_t seconds) {
+    struct tm t;
+    localtime_r(&seconds, &t);
+    Date date = { t.tm_mday, t.tm_mon + 1, t.tm_year + 1900 };
+    return dayNumber(date);
+}
 
-                            int validPhone = 1;
-                            for (size_t i = 0; i < strlen(memberToUpdate->phoneNum); i++) {
-                                if (!isdigit(memberToUpdate->phoneNum[i])) {
-                                    validPhone = 0;
-                                    break;
-                                }
-                            }
+// Adds 'delta' to the size of the bucket of day 'day'
+void dobIndexAdjust(DobIndex *index, int day, int delta) {
+    for (int i = day + 1; i <= DOB_DAYS; i += i & -i) {
+        index->counts[i] += delta;
+    }
+}
 
-                            if (!validPhone || strlen(memberToUpdate->phoneNum) < 7) {
-                                printf("Invalid phone number. Please enter digits only, at least 7 digits.\n");
-                            } else {
-                                break;
-                            }
-                        }
-                        break;
-                    case 4:
-                        while (1) {
-                            printf("Enter new gender (M/F): ");
-                            scanf("%c", &memberToUpdate->gender);
-                            getchar();
-                            memberToUpdate->gender = toupper(memberToUpdate->gender);
-                            if (memberToUpdate->gender != 'M' && memberToUpdate->gender != 'F') {
-                                printf("Invalid gender. Please enter 'M' or 'F'.\n");
-                            } else {
-                                break;
-                            }
-                        }
-                        break;
-                    case 5:
-                        while (1) {
-                            printf("Enter new emergency contact name: ");
-                            fgets(memberToUpdate->emergencyName, sizeof(memberToUpdate->emergencyName), stdin);
-                            memberToUpdate->emergencyName[strcspn(memberToUpdate->emergencyName, "\n")] = '\0';
+// Members born on or before day 'day'
+int dobIndexCountThrough(const DobIndex *index, int day) {
+    int total = 0;
+    for (int i = day + 1; i > 0; i -= i & -i) {
+        total += index->counts[i];
+    }
+    return total;
+}
 
-                            int validName = 1;
-                            if (strlen(memberToUpdate->emergencyName) < 2) {
-                                validName = 0;
-                            } else {
-                                for (size_t i = 0; i < strlen(memberToUpdate->emergencyName); i++) {
-                                    if (!isalpha(memberToUpdate->emergencyName[i]) && !isspace(memberToUpdate->emergencyName[i])) {
-                                        validName = 0;
-                                        break;
-                                    }
-                                }
-                            }
+// The day on which the 'rank'-th member in date of birth order (counting from 1) was born
+int dobIndexDayOfRank(const DobIndex *index, int rank) {
+    int position = 0;
+    int step = 1;
+    while (step * 2 <= DOB_DAYS) {
+        step *= 2;
+    }
+    for (; step > 0; step /= 2) {
+        if (position + step <= DOB_DAYS && index->counts[position + step] < rank) {
+            position += step;
+            rank -= index->counts[position];
+        }
+    }
+    return position; // Tree slot position + 1, i.e. day 'position'
+}
 
-                            if (!validName) {
-                                printf("Invalid name. Please enter a valid name with at least 2 letters.\n");
-                            } else {
-                                break;
-                            }
-                        }
-                        break;
-                    case 6:
-                        while (1) {
-                            printf("Enter new emergency contact phone: ");
-                            fgets(memberToUpdate->emergencyPhone, sizeof(memberToUpdate->emergencyPhone), stdin);
-                            memberToUpdate->emergencyPhone[strcspn(memberToUpdate->emergencyPhone, "\n")] = '\0';
+void dobIndexAdd(DobIndex *index, const Member *member) {
+    int day = dayNumber(member->dob);
+    if (day < 0) {
+        return;
+    }
+    multimapAdd(&index->days, (uint64_t)day, member->memberID);
+    multimapAdd(&index->birthdays, (uint64_t)(member->dob.month * 32 + member->dob.day), member->memberID);
+    dobIndexAdjust(index, day, 1);
+}
 
-                            int validPhone = 1;
-                            for (size_t i = 0; i < strlen(memberToUpdate->emergencyPhone); i++) {
-                                if (!isdigit(memberToUpdate->emergencyPhone[i])) {
-                                    validPhone = 0;
-                                    break;
-                                }
-                            }
+void dobIndexRemove(DobIndex *index, const Member *member) {
+    int day = dayNumber(member->dob);
+    if (day < 0) {
+        return;
+    }
+    multimapRemove(&index->days, (uint64_t)day, member->memberID);
+    multimapRemove(&index->birthdays, (uint64_t)(member->dob.month * 32 + member->dob.day), member->memberID);
+    dobIndexAdjust(index, day, -1);
+}
 
-                            if (!validPhone || strlen(memberToUpdate->emergencyPhone) < 7) {
-                                printf("Invalid phone number. Please enter digits only, at least 7 digits.\n");
-                            } else {
-                                break;
-                            }
-                        }
-                        break;
-                    case 7: {
-                        int relationChoice;
-                        while (1) {
-                            printf("Select new emergency contact relation:\n");
-                            printf("1. Spouse\n");
-                            printf("2. Partner\n");
-                            printf("3. Friend\n");
-                            printf("4. Relative\n");
-                            printf("5. Parent\n");
-                            printf("6. Other\n");
-                            printf("Choose an option (1-6): ");
-                            if (scanf("%d", &relationChoice) != 1) {
-                                printf("Invalid input. Please enter a number between 1-6.\n");
-                                while (getchar() != '\n');
-                                continue;
-                            }
-                            getchar();
+// Creates an empty index sized for 'expected' members
+void dobIndexInit(DobIndex *index, int expected) {
+    multimapInit(&index->days, expected < DOB_DAYS ? expected : DOB_DAYS);
+    multimapInit(&index->birthdays, 366);
+    index->counts = calloc(DOB_DAYS + 1, sizeof(int));
+    if (index->counts == NULL) {
+        printf("Memory allocation failed!\n");
+        exit(1);
+    }
+}
 
-                            if (relationChoice >=1 && relationChoice <=6) {
-                                break;
-                            } else {
-                                printf("Invalid choice. Please select a number between 1 and 6.\n");
-                            }
-                        }
+void dobIndexFree(DobIndex *index) {
+    multimapFree(&index->days);
+    multimapFree(&index->birthdays);
+    free(index->counts);
+    index->counts = NULL;
+}
 
-                        const char *relations[] = {"Spouse", "Partner", "Friend", "Relative", "Parent", "Other"};
-                        strcpy(memberToUpdate->emergencyRelation, relations[relationChoice -1]);
-                        break;
-                    }
-                    case 8:
-                        while (1) {
-                            printf("Enter new date of birth (dd mm yyyy): ");
-                            if (scanf("%d %d %d", &memberToUpdate->dob.day, &memberToUpdate->dob.month, &memberToUpdate->dob.year) != 3) {
-                                printf("Invalid date format. Please enter day month year as numbers.\n");
-                                while (getchar() != '\n');
-                                continue;
-                            }
-                            getchar();
+void columnsInit(MemberColumns *columns) {
+    memset(columns, 0, sizeof(MemberColumns));
+}
 
-                            // Validate dob
-                            Date currentDate = getCurrentDate();
+void columnsReserve(MemberColumns *columns, int capacity) {
+    if (capacity <= columns->capacity) {
+        return;
+    }
+    int grown = columns->capacity > 0 ? columns->capacity : 16;
+    while (grown < capacity) {
+        grown *= 2;
+    }
+    columns->ids = realloc(columns->ids, (size_t)grown * sizeof(int));
+    columns->birthDays = realloc(columns->birthDays, (size_t)grown * sizeof(int));
+    columns->genders = realloc(columns->genders, (size_t)grown);
+    columns->firstNames = realloc(columns->firstNames, (size_t)grown * sizeof(uint32_t));
+    columns->lastNames = realloc(columns->lastNames, (size_t)grown * sizeof(uint32_t));
+    if (columns->ids == NULL || columns->birthDays == NULL || columns->genders == NULL ||
+        columns->firstNames == NULL || columns->lastNames == NULL) {
+        printf("Memory allocation failed!\n");
+        exit(1);
+    }
+    columns->capacity = grown;
+}
 
-                            if (!isValidDate(memberToUpdate->dob.day, memberToUpdate->dob.month, memberToUpdate->dob.year)) {
-                                printf("Invalid date of birth. Please enter a valid date.\n");
-                                continue;
-                            }
+// Fills the columns of 'slot' from a packed member, including a deleted one (memberID 0)
+void columnsSet(MemberColumns *columns, int slot, const PackedMember *packed) {
+    columnsReserve(columns, slot + 1);
+    columns->ids[slot] = packed->memberID;
+    columns->birthDays[slot] = packed->birthDay;
+    columns->genders[slot] = genderLetters[packed->gender];
+    columns->firstNames[slot] = packed->firstName;
+    columns->lastNames[slot] = packed->lastName;
+}
 
-                            int age = calculateAge(memberToUpdate->dob, currentDate);
-                            if (age < 13) {
-                                printf("Member must be at least 13 years old to register.\n");
-                                continue;
-                            }
-                            break;
-                        }
-                        break;
-                    default:
-                        printf("Invalid choice.\n");
-                }
+void columnsMove(MemberColumns *columns, int from, int to) {
+    columns->ids[to] = columns->ids[from];
+    columns->birthDays[to] = columns->birthDays[from];
+    columns->genders[to] = columns->genders[from];
+    columns->firstNames[to] = columns->firstNames[from];
+    columns->lastNames[to] = columns->lastNames[from];
+}
 
-                printf("Member details updated successfully!\n");
-            } else {
-                printf("Member with ID %d not found.\n", updateID);
-            }
+void columnsFree(MemberColumns *columns) {
+    free(columns->ids);
+    free(columns->birthDays);
+    free(columns->genders);
+    free(columns->firstNames);
+    free(columns->lastNames);
+    columnsInit(columns);
+}
 
-            break;
-        }
-        case 5: {
-            printf("Enter member ID to delete: ");
-            int deleteID;
-            if (scanf("%d", &deleteID) != 1) {
-                printf("Invalid input. Please enter a valid member ID.\n");
-                while (getchar() != '\n');
-                break;
-            }
-            getchar();
+// Opens (or creates) the log at 'path' for appending
+int walOpen(WriteAheadLog *log, const char *path, const char *snapshotPath) {
+    snprintf(log->path, sizeof(log->path), "%s", path);
+    log->snapshotPath = snapshotPath;
+    log->used = 0;
+    log->loggedRecords = 0;
+    log->buffer = malloc(WAL_BUFFER_SIZE);
+    if (log->buffer == NULL) {
+        printf("Memory allocation failed!\n");
+        exit(1);
+    }
 
-            deleteMember(memberList, deleteID);
+    log->fd = open(path, O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (log->fd < 0) {
+        printf("Error opening log file %s%s!\n", path, snapshotPath != NULL ? ", changes will only be saved on exit" : "");
+        return 0;
+    }
+    return 1;
+}
 
-            printf("Member deleted successfully!\n");
-            break;
-        }
-        case 6:
-            printf("Returning to Main Menu...\n");
-            break;
-        default:
-            printf("Invalid choice. Please try again.\n");
-        }
-    } while (choice != 6);
+// Writes staged records to the log file without waiting for the disk
+int walFlush(WriteAheadLog *log) {
+    if (log->fd < 0 || log->used == 0) {
+        return 1;
+    }
+    int ok = writeFully(log->fd, log->buffer, log->used);
+    log->used = 0;
+    if (!ok) {
+        printf("Error writing to log file %s!\n", log->path);
+    }
+    return ok;
 }
 
-void equipmentManagementMenu(EquipmentList *equipmentList, int *nextEquipmentID) {
-    int choice;
-    do {
-        printf("==========================================\n");
-        printf("        Equipment Management\n");
-        printf("==========================================\n");
-        printf("1. Add New Equipment\n");
-        printf("2. List All Equipment\n");
-        printf("3. Update Equipment Status\n");
-        printf("4. Delete Equipment\n");
-        printf("5. Back to Main Menu\n");
-        printf("==========================================\n");
-        printf("Enter your choice (1-5): \n");
-        if (scanf("%d", &choice) != 1) {
-            printf("Invalid input. Please enter a number between 1-5.\n");
-            while (getchar() != '\n');
-            continue;
-        }
-        getchar();  // Consume the newline character left in the buffer
+// Stages one record; it becomes durable on the next walCommit
+void walAppend(WriteAheadLog *log, WalRecordType type, const void *payload, uint32_t length) {
+    if (log->fd < 0) {
+        return;
+    }
 
-        switch(choice) {
-            case 1: {
-                // Add new equipment
-                Equipment newEquipment;
-                newEquipment.id = (*nextEquipmentID)++; // Assign a unique ID
+    WalRecordHeader header;
+    header.length = length;
+    header.type = type;
+    header.crc = crc32c(crc32c(0, &header.type, sizeof(header.type)), payload, length);
 
-                // Input Equipment Name
-                while (1) {
-                    printf("Enter equipment name: ");
-                    fgets(newEquipment.name, sizeof(newEquipment.name), stdin);
-                    newEquipment.name[strcspn(newEquipment.name, "\n")] = '\0';
-                    if (strlen(newEquipment.name) < 1) {
-                        printf("Equipment name cannot be empty.\n");
-                    } else {
-                        break;
-                    }
-                }
+    if (log->used + sizeof(header) + length > WAL_BUFFER_SIZE) {
+        walFlush(log);
+    }
+    memcpy(log->buffer + log->used, &header, sizeof(header));
+    memcpy(log->buffer + log->used + sizeof(header), payload, length);
+    log->used += sizeof(header) + length;
+    log->loggedRecords++;
+}
 
-                // Input Total Quantity
-                while (1) {
-                    printf("Enter total quantity: ");
-                    if (scanf("%d", &newEquipment.totalQuantity) != 1 || newEquipment.totalQuantity <= 0) {
-                        printf("Invalid input. Please enter a positive number.\n");
-                        while (getchar() != '\n');
-                        continue;
-                    }
-                    getchar();
-                    break;
-                }
+// Group commit: one write and one fdatasync for every record staged since the last commit
+int walCommit(WriteAheadLog *log) {
+    if (log->fd < 0) {
+        return 1;
+    }
+    if (!walFlush(log)) {
+        return 0;
+    }
+    if (fdatasync(log->fd) != 0) {
+        printf("Error syncing log file %s!\n", log->path);
+        return 0;
+    }
+    return 1;
+}
 
-                if (newEquipment.totalQuantity == 1) {
-                    // Ask if the equipment is functional
-                    int functionalChoice;
-                    while (1) {
-                        printf("Is the equipment functional?\n");
-                        printf("1. Yes\n");
-                        printf("2. No\n");
-                        printf("Choose an option (1-2): ");
-                        if (scanf("%d", &functionalChoice) != 1 || (functionalChoice !=1 && functionalChoice !=2)) {
-                            printf("Invalid input. Please enter 1 or 2.\n");
-                            while (getchar() != '\n');
-                            continue;
-                        }
-                        getchar();
-                        if (functionalChoice == 1) {
-                            newEquipment.functional = 1;
-                            newEquipment.broken = 0;
-                            break;
-                        } else {
-                            newEquipment.functional = 0;
-                            newEquipment.broken = 1;
-                            break;
-                        }
-                    }
-                } else {
-                    // For multiple quantities
-                    int allFunctionalChoice;
-                    while (1) {
-                        printf("Are all equipments functional?\n");
-                        printf("1. Yes\n");
-                        printf("2. No\n");
-                        printf("Choose an option (1-2): ");
-                        if (scanf("%d", &allFunctionalChoice) != 1 || (allFunctionalChoice !=1 && allFunctionalChoice !=2)) {
-                            printf("Invalid input. Please enter 1 or 2.\n");
-                            while (getchar() != '\n');
-                            continue;
-                        }
-                        getchar();
-                        if (allFunctionalChoice == 1) {
-                            newEquipment.functional = newEquipment.totalQuantity;
-                            newEquipment.broken = 0;
-                            break;
-                        } else {
-                            // Ask for the number of broken equipments
-                            while (1) {
-                                printf("Enter the number of broken equipments: ");
-                                if (scanf("%d", &newEquipment.broken) !=1 || newEquipment.broken <0 || newEquipment.broken > newEquipment.totalQuantity) {
-                                    printf("Invalid input. Please enter a number between 0 and %d.\n", newEquipment.totalQuantity);
-                                    while (getchar() != '\n');
-                                    continue;
-                                }
-                                getchar();
-                                newEquipment.functional = newEquipment.totalQuantity - newEquipment.broken;
-                                break;
-                            }
-                            break;
-                        }
-                    }
-                }
+// Writes the staged records without waiting for the disk and returns a duplicate of the log's
+// descriptor, so the caller can fdatasync it after releasing its locks even if the log file is
+// replaced meanwhile. Returns -1 if logging is off or the write failed.
+int walFlushForSync(WriteAheadLog *log) {
+    if (log->fd < 0 || !walFlush(log)) {
+        return -1;
+    }
+    return dup(log->fd);
+}
 
-                // Compute status based on functional and broken
-                if (newEquipment.broken > 0) {
-                    strcpy(newEquipment.status, "Under Maintenance");
+// Empties the log once its records are contained in the snapshot
+void walReset(WriteAheadLog *log) {
+    if (log->fd < 0) {
+        return;
+    }
+    log->used = 0;
+    log->loggedRecords = 0;
+    if (ftruncate(log->fd, 0) != 0 || fdatasync(log->fd) != 0) {
+        printf("Error truncating log file %s!\n", log->path);
+    }
+}
 
-                    // Prompt for repair ETA
-                    while (1) {
-                        printf("Enter repair ETA (dd mm yyyy): ");
-                        if (scanf("%d %d %d", &newEquipment.repairETA.day, &newEquipment.repairETA.month, &newEquipment.repairETA.year) != 3) {
-                            printf("Invalid date format. Please enter day month year as numbers.\n");
-                            while (getchar() != '\n');
-                            continue;
-                        }
-                        getchar();
+// Drops the first 'boundary' bytes of the log once a snapshot covers them. Records appended
+// after the boundary are copied into a fresh log that replaces the old one atomically.
+void walDiscardPrefix(WriteAheadLog *log, off_t boundary, int recordsInPrefix) {
+    if (log->fd < 0) {
+        return;
+    }
+    walFlush(log);
+    off_t end = lseek(log->fd, 0, SEEK_END);
+    if (end <= boundary) {
+        walReset(log);
+        return;
+    }
 
-                        // Validate the date
-                        Date currentDate = getCurrentDate();
+    size_t tailBytes = (size_t)(end - boundary);
+    unsigned char *tail = malloc(tailBytes);
+    if (tail == NULL) {
+        printf("Memory allocation failed!\n");
+        exit(1);
+    }
 
-                        if (!isValidDate(newEquipment.repairETA.day, newEquipment.repairETA.month, newEquipment.repairETA.year)) {
-                            printf("Invalid date entered. Please enter a valid date.\n");
-                            continue;
-                        }
+    char tempPath[sizeof(log->path) + sizeof(TEMP_SUFFIX)];
+    snprintf(tempPath, sizeof(tempPath), "%s%s", log->path, TEMP_SUFFIX);
+    int tempFd = open(tempPath, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    int ok = tempFd >= 0 && pread(log->fd, tail, tailBytes, boundary) == (ssize_t)tailBytes &&
+             writeFully(tempFd, tail, tailBytes) && fsync(tempFd) == 0;
+    if (tempFd >= 0) {
+        close(tempFd);
+    }
+    free(tail);
 
-                        Date repairETA = newEquipment.repairETA;
+    if (!ok || rename(tempPath, log->path) != 0) {
+        // Keeping the whole log is safe, replaying records the snapshot already has changes nothing
+        remove(tempPath);
+        return;
+    }
 
-                        int cmpResult = compareDates(repairETA, currentDate);
-                        if (cmpResult < 0) {
-                            printf("Error: Repair ETA cannot be in the past.\n");
-                        } else {
-                            break;
-                        }
-                    }
-                } else {
-                    strcpy(newEquipment.status, "Operational");
-                    // Set repairETA to 0
-                    newEquipment.repairETA.day = 0;
-                    newEquipment.repairETA.month = 0;
-                    newEquipment.repairETA.year = 0;
-                }
+    close(log->fd);
+    log->fd = open(log->path, O_WRONLY | O_APPEND);
+    if (log->fd < 0) {
+        printf("Error opening log file %s, changes will only be saved on exit!\n", log->path);
+    }
+    log->loggedRecords -= recordsInPrefix;
+}
 
-                // Add equipment to list
-                addEquipment(equipmentList, &newEquipment);
+void walClose(WriteAheadLog *log) {
+    if (log->fd >= 0) {
+        walCommit(log);
+        close(log->fd);
+        log->fd = -1;
+    }
+    free(log->buffer);
+    log->buffer = NULL;
+}
 
-                printf("Equipment added successfully!\n");
+// Function to replay every intact record of a log through 'apply'. A torn or corrupt tail
+// (e.g. from a crash in the middle of an append) is cut off. Returns the number of records replayed.
+int walReplay(const char *path, void (*apply)(void *context, WalRecordType type, const void *payload, uint32_t length), void *context) {
+    int fd = open(path, O_RDWR);
+    if (fd < 0) {
+        return 0; // No log yet
+    }
+
+    off_t fileSize = lseek(fd, 0, SEEK_END);
+    if (fileSize <= 0) {
+        close(fd);
+        return 0;
+    }
+
+    unsigned char *data = malloc((size_t)fileSize);
+    if (data == NULL) {
+        printf("Memory allocation failed!\n");
+        exit(1);
+    }
+    if (pread(fd, data, (size_t)fileSize, 0) != fileSize) {
+        printf("Error reading log file %s!\n", path);
+        free(data);
+        close(fd);
+        return 0;
+    }
+
+    size_t offset = 0;
+    int replayed = 0;
+    while (offset + sizeof(WalRecordHeader) <= (size_t)fileSize) {
+        WalRecordHeader header;
+        memcpy(&header, data + offset, sizeof(header));
+        const unsigned char *payload = data + offset + sizeof(header);
+
+        if (header.length > (size_t)fileSize - offset - sizeof(header) ||
+            crc32c(crc32c(0, &header.type, sizeof(header.type)), payload, header.length) != header.crc) {
+            break;
+        }
+        apply(context, (WalRecordType)header.type, payload, header.length);
+        offset += sizeof(header) + header.length;
+        replayed++;
+    }
+
+    if (offset < (size_t)fileSize) {
+        printf("Warning: discarding %ld damaged bytes at the end of %s.\n", (long)(fileSize - (off_t)offset), path);
+        if (ftruncate(fd, (off_t)offset) != 0) {
+            printf("Error truncating log file %s!\n", path);
+        }
+    }
+
+    free(data);
+    close(fd);
+    return replayed;
+}
+
+void segmentStoreInit(SegmentStore *store, size_t recordSize) {
+    store->segments = NULL;
+    store->segmentCount = 0;
+    store->directoryCapacity = 0;
+    store->recordSize = recordSize;
+    store->loaded = NULL;
+    store->loadedLength = 0;
+    store->loadedSegments = 0;
+}
+
+// The record in a slot. Growing the store never moves it, so the pointer stays valid until the
+// slot itself is reused.
+void *segmentRecord(const SegmentStore *store, int slot) {
+    return store->segments[slot >> SEGMENT_SHIFT] + (size_t)(slot & (SEGMENT_RECORDS - 1)) * store->recordSize;
+}
+
+int segmentStoreCapacity(const SegmentStore *store) {
+    return store->segmentCount * SEGMENT_RECORDS;
+}
+
+// Appends one segment to the store, pointing at 'records' or, when it is NULL, newly allocated
+void segmentStoreAppend(SegmentStore *store, unsigned char *records) {
+    if (store->segmentCount == store->directoryCapacity) {
+        store->directoryCapacity = store->directoryCapacity > 0 ? store->directoryCapacity * 2 : 16;
+        store->segments = realloc(store->segments, (size_t)store->directoryCapacity * sizeof(unsigned char *));
+        if (store->segments == NULL) {
+            printf("Memory allocation failed!\n");
+            exit(1);
+        }
+    }
+    if (records == NULL) {
+        records = malloc(SEGMENT_RECORDS * store->recordSize);
+        if (records == NULL) {
+            printf("Memory allocation failed!\n");
+            exit(1);
+        }
+    }
+    store->segments[store->segmentCount++] = records;
+}
+
+// Adds segments until the store can hold at least 'capacity' records
+void segmentStoreReserve(SegmentStore *store, int capacity) {
+    while (segmentStoreCapacity(store) < capacity) {
+        segmentStoreAppend(store, NULL);
+    }
+}
+
+// Takes over 'count' records loaded into one block ('loaded', a mapping of 'loadedLength' bytes,
+// or a heap block when loadedLength is 0). Whole segments stay in the block; the records after
+// the last whole segment are copied into a heap segment, so the list can grow past them.
+void segmentStoreAdopt(SegmentStore *store, void *records, int count, void *loaded, size_t loadedLength) {
+    int whole = count / SEGMENT_RECORDS;
+    for (int s = 0; s < whole; s++) {
+        segmentStoreAppend(store, (unsigned char *)records + (size_t)s * SEGMENT_RECORDS * store->recordSize);
+    }
+    store->loadedSegments = whole;
+
+    int rest = count - whole * SEGMENT_RECORDS;
+    if (rest > 0) {
+        segmentStoreAppend(store, NULL);
+        memcpy(store->segments[whole], (unsigned char *)records + (size_t)whole * SEGMENT_RECORDS * store->recordSize,
+               (size_t)rest * store->recordSize);
+    }
+
+    if (whole > 0) {
+        store->loaded = loaded;
+        store->loadedLength = loadedLength;
+    } else if (loadedLength > 0) {
+        munmap(loaded, loadedLength);
+    } else {
+        free(loaded);
+    }
+}
+
+// Releases the heap segments a store of 'count' records no longer needs, keeping SEGMENT_SPARE
+// empty ones so a list that shrinks and grows again around a boundary does not keep reallocating
+void segmentStoreTrim(SegmentStore *store, int count) {
+    int keep = (count + SEGMENT_RECORDS - 1) / SEGMENT_RECORDS + SEGMENT_SPARE;
+    if (keep < store->loadedSegments) {
+        keep = store->loadedSegments;
+    }
+    while (store->segmentCount > keep) {
+        free(store->segments[--store->segmentCount]);
+    }
+}
+
+// Fills 'copy' with a private heap copy of the first 'count' records of 'store'
+void segmentStoreCopy(SegmentStore *copy, const SegmentStore *store, int count) {
+    segmentStoreInit(copy, store->recordSize);
+    for (int first = 0; first < count; first += SEGMENT_RECORDS) {
+        int inSegment = count - first < SEGMENT_RECORDS ? count - first : SEGMENT_RECORDS;
+        segmentStoreAppend(copy, NULL);
+        memcpy(copy->segments[copy->segmentCount - 1], segmentRecord(store, first), (size_t)inSegment * store->recordSize);
+    }
+}
+
+void segmentStoreFree(SegmentStore *store) {
+    for (int s = store->loadedSegments; s < store->segmentCount; s++) {
+        free(store->segments[s]);
+    }
+    if (store->loadedLength > 0) {
+        munmap(store->loaded, store->loadedLength);
+    } else {
+        free(store->loaded);
+    }
+    free(store->segments);
+    segmentStoreInit(store, store->recordSize);
+}
+
+// Replaces 'filename' with the fully written 'tempPath'. The data file may be mapped by this
+// process, so it is never truncated or rewritten in place.
+int replaceDataFile(FILE *file, const char *tempPath, const char *filename, int writeOk) {
+    int ok = writeOk && fflush(file) == 0 && fsync(fileno(file)) == 0;
+    ok = fclose(file) == 0 && ok;
+    if (ok && rename(tempPath, filename) != 0) {
+        ok = 0;
+    }
+    if (!ok) {
+        remove(tempPath);
+    }
+    return ok;
+}
+
+// Returns 1 on little-endian hosts, where the on-disk byte order is the native one
+int isLittleEndianHost(void) {
+    uint16_t probe = 1;
+    return *(unsigned char *)&probe == 1;
+}
+
+uint32_t littleEndian32(uint32_t value) {
+    if (isLittleEndianHost()) {
+        return value;
+    }
+    return (value >> 24) | ((value >> 8) & 0xFF00u) | ((value << 8) & 0xFF0000u) | (value << 24);
+}
+
+uint16_t littleEndian16(uint16_t value) {
+    return isLittleEndianHost() ? value : (uint16_t)((value >> 8) | (value << 8));
+}
+
+// Lays out the schema's fields on disk, each aligned to its natural size, and decides whether
+// the encoded record is byte-for-byte the in-memory struct (so no conversion is needed)
+void initRecordSchema(RecordSchema *schema) {
+    if (schema->recordSize != 0) {
+        return;
+    }
+
+    size_t offset = 0;
+    size_t recordAlignment = 4;
+    int identity = isLittleEndianHost();
+    for (int i = 0; i < schema->fieldCount; i++) {
+        FieldDescriptor *field = &schema->fields[i];
+        size_t alignment = field->kind == FIELD_INT64 ? 8 : (field->kind == FIELD_INT32 ? 4 : 1);
+        offset = (offset + alignment - 1) / alignment * alignment;
+        field->diskOffset = offset;
+        offset += field->length;
+        if (field->diskOffset != field->structOffset) {
+            identity = 0;
+        }
+        if (alignment > recordAlignment) {
+            recordAlignment = alignment;
+        }
+    }
+    schema->recordSize = (offset + recordAlignment - 1) / recordAlignment * recordAlignment;
+    schema->identity = identity && schema->recordSize == schema->structSize;
+}
+
+void encodeRecord(const RecordSchema *schema, const void *record, unsigned char *encoded) {
+    if (schema->identity) {
+        memcpy(encoded, record, schema->recordSize);
+        return;
+    }
+
+    memset(encoded, 0, schema->recordSize);
+    for (int i = 0; i < schema->fieldCount; i++) {
+        const FieldDescriptor *field = &schema->fields[i];
+        const unsigned char *source = (const unsigned char *)record + field->structOffset;
+        if (field->kind == FIELD_INT32) {
+            int32_t value;
+            memcpy(&value, source, sizeof(value));
+            uint32_t stored = littleEndian32((uint32_t)value);
+            memcpy(encoded + field->diskOffset, &stored, sizeof(stored));
+        } else if (field->kind == FIELD_INT64) {
+            uint64_t value;
+            memcpy(&value, source, sizeof(value));
+            uint32_t halves[2] = { littleEndian32((uint32_t)value), littleEndian32((uint32_t)(value >> 32)) };
+            memcpy(encoded + field->diskOffset, halves, sizeof(halves));
+        } else {
+            memcpy(encoded + field->diskOffset, source, field->length);
+        }
+    }
+}
+
+void decodeRecord(const RecordSchema *schema, const unsigned char *encoded, void *record) {
+    if (schema->identity) {
+        memcpy(record, encoded, schema->recordSize);
+        return;
+    }
+
+    memset(record, 0, schema->structSize);
+    for (int i = 0; i < schema->fieldCount; i++) {
+        const FieldDescriptor *field = &schema->fields[i];
+        unsigned char *target = (unsigned char *)record + field->structOffset;
+        if (field->kind == FIELD_INT32) {
+            uint32_t stored;
+            memcpy(&stored, encoded + field->diskOffset, sizeof(stored));
+            int32_t value = (int32_t)littleEndian32(stored);
+            memcpy(target, &value, sizeof(value));
+        } else if (field->kind == FIELD_INT64) {
+            uint32_t halves[2];
+            memcpy(halves, encoded + field->diskOffset, sizeof(halves));
+            uint64_t value = (uint64_t)littleEndian32(halves[1]) << 32 | littleEndian32(halves[0]);
+            memcpy(target, &value, sizeof(value));
+        } else {
+            memcpy(target, encoded + field->diskOffset, field->length);
+            if (field->length > 1) {
+                target[field->length - 1] = '\0'; // Never trust a string from disk to be terminated
+            }
+        }
+    }
+}
+
+// Stages one record encoded with the schema; it becomes durable on the next walCommit
+void walAppendRecord(WriteAheadLog *log, WalRecordType type, const RecordSchema *schema, const void *record) {
+    unsigned char encoded[MAX_RECORD_SIZE];
+    encodeRecord(schema, record, encoded);
+    walAppend(log, type, encoded, (uint32_t)schema->recordSize);
+}
+
+// Stops the program when a data file fails validation, rather than letting the next save overwrite it
+void reportDamagedFile(const char *filename, const char *problem) {
+    printf("Error: %s is damaged (%s).\n", filename, problem);
+    printf("Restore it from a backup, or move it away to start with an empty list.\n");
+    exit(1);
+}
+
+// Maps a data file copy-on-write, so loading costs no copying and unmodified records stay shared
+// with the page cache. Returns NULL if the file cannot be mapped.
+unsigned char *mapRecords(int fd, size_t fileSize) {
+    unsigned char *base = mmap(NULL, fileSize, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    return base != MAP_FAILED ? base : NULL;
+}
+
+// Loads a data file written by saveDataFile, or an unversioned file from before the format
+// existed (an int count followed by raw structs). Every checksum block is validated before
+// the records are used. With 'allowMapping' and a schema that matches the in-memory layout,
+// the records are used straight from a copy-on-write mapping (*mapping is set, *mappingLength
+// bytes long); otherwise they are decoded into a heap array. The string section, if the file has
+// one, is returned in a heap buffer. Files in the previous format version, and unversioned files,
+// are decoded with schema->previous and DATA_FILE_LEGACY is returned for the caller to upgrade them.
+DataFileStatus loadDataFile(const char *filename, RecordSchema *schema, int allowMapping,
+                            void **records, int *count, void **mapping, size_t *mappingLength,
+                            char **strings, size_t *stringBytes) {
+    // The older layouts are needed to replay logs too, even when the file is current or missing
+    for (RecordSchema *layout = schema; layout != NULL; layout = layout->previous) {
+        initRecordSchema(layout);
+    }
+    *mapping = NULL;
+    *strings = NULL;
+    *stringBytes = 0;
+
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        return DATA_FILE_MISSING;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        close(fd);
+        return DATA_FILE_MISSING;
+    }
+    size_t fileSize = (size_t)info.st_size;
+
+    DataFileHeader header;
+    memset(&header, 0, sizeof(header));
+    if (pread(fd, &header, sizeof(header), 0) < (ssize_t)sizeof(int)) {
+        close(fd);
+        reportDamagedFile(filename, "file is too short");
+    }
+
+    if (littleEndian32(header.magic) != DATA_FILE_MAGIC) {
+        // Unversioned file: only accept it if its size matches its count exactly
+        RecordSchema *legacy = schema->previous != NULL ? schema->previous : schema;
+        int legacyCount;
+        memcpy(&legacyCount, &header, sizeof(int));
+        if (legacyCount < 0 || sizeof(int) + (size_t)legacyCount * legacy->structSize != fileSize) {
+            close(fd);
+            reportDamagedFile(filename, "unknown format");
+        }
+        *count = legacyCount;
+        *records = malloc((size_t)legacyCount * legacy->structSize + 1);
+        if (*records == NULL) {
+            printf("Memory allocation failed!\n");
+            exit(1);
+        }
+        size_t bytes = (size_t)legacyCount * legacy->structSize;
+        if (pread(fd, *records, bytes, sizeof(int)) != (ssize_t)bytes) {
+            close(fd);
+            reportDamagedFile(filename, "short read");
+        }
+        close(fd);
+        return DATA_FILE_LEGACY;
+    }
+
+    uint32_t storedHeaderCrc = littleEndian32(header.headerCrc);
+    if (crc32c(0, &header, offsetof(DataFileHeader, headerCrc)) != storedHeaderCrc) {
+        close(fd);
+        reportDamagedFile(filename, "header checksum mismatch");
+    }
+    if (littleEndian16(header.version) > schema->version) {
+        close(fd);
+        printf("Error: %s was written by a newer version of this program (format %u).\n", filename, littleEndian16(header.version));
+        exit(1);
+    }
+    DataFileStatus status = DATA_FILE_LOADED;
+    if (littleEndian16(header.version) < schema->version) {
+        if (schema->previous == NULL || schema->previous->version != littleEndian16(header.version)) {
+            close(fd);
+            printf("Error: %s is in format %u, which this version of the program cannot read.\n", filename, littleEndian16(header.version));
+            exit(1);
+        }
+        schema = schema->previous;
+        allowMapping = 0; // The records are about to be converted anyway
+        status = DATA_FILE_LEGACY;
+    }
+    if (littleEndian16(header.headerSize) != sizeof(DataFileHeader) || littleEndian32(header.recordSize) != schema->recordSize ||
+        littleEndian32(header.blockRecords) == 0) {
+        close(fd);
+        reportDamagedFile(filename, "unexpected record layout");
+    }
+
+    size_t recordCount = littleEndian32(header.recordCount);
+    size_t blockRecords = littleEndian32(header.blockRecords);
+    size_t blockCount = (recordCount + blockRecords - 1) / blockRecords;
+    size_t dataBytes = recordCount * schema->recordSize;
+    size_t sectionBytes = littleEndian32(header.stringBytes);
+    size_t sectionOffset = sizeof(DataFileHeader) + dataBytes + blockCount * sizeof(uint32_t);
+    if (recordCount > INT32_MAX || sectionOffset + (sectionBytes > 0 ? sectionBytes + sizeof(uint32_t) : 0) > fileSize) {
+        close(fd);
+        reportDamagedFile(filename, "file is truncated");
+    }
+
+    // Bring the encoded records into memory: mapped, read in place, or read for decoding
+    unsigned char *encoded = NULL;
+    unsigned char *mapped = NULL;
+    if (allowMapping && schema->identity) {
+        mapped = mapRecords(fd, fileSize);
+    }
+    if (mapped != NULL) {
+        encoded = mapped + sizeof(DataFileHeader);
+        *records = encoded;
+        *mapping = mapped;
+        *mappingLength = fileSize;
+    } else {
+        *records = malloc(recordCount * schema->structSize + 1);
+        encoded = schema->identity ? *records : malloc(dataBytes > 0 ? dataBytes : 1);
+        if (*records == NULL || encoded == NULL) {
+            printf("Memory allocation failed!\n");
+            exit(1);
+        }
+        if (pread(fd, encoded, dataBytes, sizeof(DataFileHeader)) != (ssize_t)dataBytes) {
+            close(fd);
+            reportDamagedFile(filename, "short read");
+        }
+    }
+
+    // Validate every block against the checksum trailer
+    uint32_t *storedCrcs = malloc(blockCount * sizeof(uint32_t) + 1);
+    uint32_t *actualCrcs = malloc(blockCount * sizeof(uint32_t) + 1);
+    if (storedCrcs == NULL || actualCrcs == NULL) {
+        printf("Memory allocation failed!\n");
+        exit(1);
+    }
+    if (pread(fd, storedCrcs, blockCount * sizeof(uint32_t), sizeof(DataFileHeader) + dataBytes) != (ssize_t)(blockCount * sizeof(uint32_t))) {
+        close(fd);
+        reportDamagedFile(filename, "short read");
+    }
+
+    if (sectionBytes > 0) {
+        *strings = malloc(sectionBytes);
+        uint32_t storedCrc;
+        if (*strings == NULL) {
+            printf("Memory allocation failed!\n");
+            exit(1);
+        }
+        if (pread(fd, *strings, sectionBytes, (off_t)sectionOffset) != (ssize_t)sectionBytes ||
+            pread(fd, &storedCrc, sizeof(storedCrc), (off_t)(sectionOffset + sectionBytes)) != (ssize_t)sizeof(storedCrc)) {
+            close(fd);
+            reportDamagedFile(filename, "short read");
+        }
+        if (crc32c(0, *strings, sectionBytes) != littleEndian32(storedCrc)) {
+            close(fd);
+            reportDamagedFile(filename, "checksum mismatch in the string section");
+        }
+        *stringBytes = sectionBytes;
+    }
+    close(fd);
+
+    if (dataBytes > 0) {
+        crc32cBlocks(encoded, dataBytes, blockRecords * schema->recordSize, actualCrcs);
+    }
+    for (size_t block = 0; block < blockCount; block++) {
+        if (littleEndian32(storedCrcs[block]) != actualCrcs[block]) {
+            char problem[96];
+            snprintf(problem, sizeof(problem), "checksum mismatch in records %zu-%zu",
+                block * blockRecords + 1, (block + 1) * blockRecords < recordCount ? (block + 1) * blockRecords : recordCount);
+            reportDamagedFile(filename, problem);
+        }
+    }
+    free(storedCrcs);
+    free(actualCrcs);
+
+    if (!schema->identity) {
+        for (size_t i = 0; i < recordCount; i++) {
+            decodeRecord(schema, encoded + i * schema->recordSize, (unsigned char *)*records + i * schema->structSize);
+        }
+        free(encoded);
+    }
+
+    *count = (int)recordCount;
+    return status;
+}
+
+// Writes the first 'count' records as header, encoded records, checksum trailer and string section
+// ('stringBytes' of 'strings' and their CRC32C, left out when stringBytes is 0) to a temp file and
+// renames it over 'filename'. Returns 1 once the file is on disk.
+int saveDataFile(const char *filename, RecordSchema *schema, const SegmentStore *records, int count,
+                 const char *strings, size_t stringBytes) {
+    initRecordSchema(schema);
+
+    char tempPath[256];
+    snprintf(tempPath, sizeof(tempPath), "%s%s", filename, TEMP_SUFFIX);
+
+    FILE *file = fopen(tempPath, "wb");
+    if (file == NULL) {
+        return 0;
+    }
+
+    size_t blockCount = ((size_t)count + CHECKSUM_BLOCK_RECORDS - 1) / CHECKSUM_BLOCK_RECORDS;
+    size_t blockBytes = CHECKSUM_BLOCK_RECORDS * schema->recordSize;
+    uint32_t *crcs = malloc(blockCount * sizeof(uint32_t) + 1);
+    unsigned char *block = schema->identity ? NULL : malloc(blockBytes);
+    if (crcs == NULL || (!schema->identity && block == NULL)) {
+        printf("Memory allocation failed!\n");
+        exit(1);
+    }
+
+    DataFileHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = littleEndian32(DATA_FILE_MAGIC);
+    header.version = littleEndian16(schema->version);
+    header.headerSize = littleEndian16(sizeof(DataFileHeader));
+    header.recordSize = littleEndian32((uint32_t)schema->recordSize);
+    header.recordCount = littleEndian32((uint32_t)count);
+    header.blockRecords = littleEndian32(CHECKSUM_BLOCK_RECORDS);
+    header.stringBytes = littleEndian32((uint32_t)stringBytes);
+    header.headerCrc = littleEndian32(crc32c(0, &header, offsetof(DataFileHeader, headerCrc)));
+    int ok = fwrite(&header, sizeof(header), 1, file) == 1;
+
+    if (schema->identity) {
+        // The segments already are the encoded form, and each holds whole checksum blocks
+        for (int first = 0; first < count && ok; first += SEGMENT_RECORDS) {
+            size_t dataBytes = (size_t)(count - first < SEGMENT_RECORDS ? count - first : SEGMENT_RECORDS) * schema->recordSize;
+            const void *segment = segmentRecord(records, first);
+            crc32cBlocks(segment, dataBytes, blockBytes, crcs + first / CHECKSUM_BLOCK_RECORDS);
+            ok = fwrite(segment, 1, dataBytes, file) == dataBytes;
+        }
+    } else {
+        for (size_t b = 0; b < blockCount && ok; b++) {
+            size_t first = b * CHECKSUM_BLOCK_RECORDS;
+            size_t inBlock = (size_t)count - first < CHECKSUM_BLOCK_RECORDS ? (size_t)count - first : CHECKSUM_BLOCK_RECORDS;
+            for (size_t i = 0; i < inBlock; i++) {
+                encodeRecord(schema, segmentRecord(records, (int)(first + i)), block + i * schema->recordSize);
+            }
+            crcs[b] = crc32c(0, block, inBlock * schema->recordSize);
+            ok = fwrite(block, schema->recordSize, inBlock, file) == inBlock;
+        }
+    }
+
+    for (size_t b = 0; b < blockCount; b++) {
+        crcs[b] = littleEndian32(crcs[b]);
+    }
+    ok = ok && fwrite(crcs, sizeof(uint32_t), blockCount, file) == blockCount;
+    if (stringBytes > 0) {
+        uint32_t stringCrc = littleEndian32(crc32c(0, strings, stringBytes));
+        ok = ok && fwrite(strings, 1, stringBytes, file) == stringBytes && fwrite(&stringCrc, sizeof(stringCrc), 1, file) == 1;
+    }
+
+    free(crcs);
+    free(block);
+    return replaceDataFile(file, tempPath, filename, ok);
+}
+
+// Writes the records, trailer and header held in a redo buffer (see saveDataFileIncremental)
+// to their final places in the data file
+int applyRedo(int fd, const unsigned char *redo) {
+    RedoHeader redoHeader;
+    memcpy(&redoHeader, redo, sizeof(redoHeader));
+    const unsigned char *cursor = redo + sizeof(redoHeader);
+
+    for (uint32_t i = 0; i < redoHeader.entryCount; i++) {
+        uint32_t slot;
+        memcpy(&slot, cursor, sizeof(slot));
+        off_t offset = (off_t)sizeof(DataFileHeader) + (off_t)slot * redoHeader.recordSize;
+        if (pwrite(fd, cursor + sizeof(slot), redoHeader.recordSize, offset) != (ssize_t)redoHeader.recordSize) {
+            return 0;
+        }
+        cursor += sizeof(slot) + redoHeader.recordSize;
+    }
+
+    // The trailer and the string section (when it changed) are written back to back
+    const unsigned char *trailer = cursor;
+    size_t tailBytes = redoHeader.trailerBlocks * sizeof(uint32_t) + (redoHeader.stringBytes > 0 ? redoHeader.stringBytes + sizeof(uint32_t) : 0);
+    DataFileHeader header;
+    memcpy(&header, trailer + tailBytes, sizeof(header));
+    off_t trailerOffset = (off_t)sizeof(DataFileHeader) + (off_t)littleEndian32(header.recordCount) * redoHeader.recordSize;
+
+    if (pwrite(fd, trailer, tailBytes, trailerOffset) != (ssize_t)tailBytes ||
+        pwrite(fd, &header, sizeof(header), 0) != (ssize_t)sizeof(header)) {
+        return 0;
+    }
+    return fsync(fd) == 0;
+}
+
+// Finishes an incremental save that was interrupted after its redo file was complete. A redo
+// file that fails its checksum was never applied, so the data file is intact and it is dropped.
+void recoverIncrementalSave(const char *filename, const RecordSchema *schema) {
+    char redoPath[256];
+    snprintf(redoPath, sizeof(redoPath), "%s%s", filename, REDO_SUFFIX);
+
+    int redoFd = open(redoPath, O_RDONLY);
+    if (redoFd < 0) {
+        return;
+    }
+    struct stat info;
+    unsigned char *redo = NULL;
+    int valid = 0;
+    if (fstat(redoFd, &info) == 0 && (size_t)info.st_size >= sizeof(RedoHeader) + sizeof(DataFileHeader) + sizeof(uint32_t)) {
+        size_t size = (size_t)info.st_size;
+        redo = malloc(size);
+        if (redo != NULL && pread(redoFd, redo, size, 0) == (ssize_t)size) {
+            RedoHeader redoHeader;
+            uint32_t storedCrc;
+            memcpy(&redoHeader, redo, sizeof(redoHeader));
+            memcpy(&storedCrc, redo + size - sizeof(uint32_t), sizeof(uint32_t));
+            size_t expected = sizeof(RedoHeader) + (size_t)redoHeader.entryCount * (sizeof(uint32_t) + redoHeader.recordSize) +
+                              (size_t)redoHeader.trailerBlocks * sizeof(uint32_t) +
+                              (redoHeader.stringBytes > 0 ? (size_t)redoHeader.stringBytes + sizeof(uint32_t) : 0) +
+                              sizeof(DataFileHeader) + sizeof(uint32_t);
+            valid = redoHeader.magic == REDO_FILE_MAGIC && redoHeader.recordSize == schema->recordSize &&
+                    expected == size && crc32c(0, redo, size - sizeof(uint32_t)) == storedCrc;
+        }
+    }
+    close(redoFd);
+
+    if (valid) {
+        int fd = open(filename, O_WRONLY);
+        if (fd < 0 || !applyRedo(fd, redo)) {
+            printf("Error: could not finish the interrupted save of %s.\n", filename);
+            exit(1);
+        }
+        close(fd);
+        printf("Finished an interrupted save of %s.\n", filename);
+    }
+    free(redo);
+    remove(redoPath);
+}
+
+// Saves only the records marked in 'dirty', plus the header and checksum trailer, into the data
+// file written by the last save (which held 'persistedCount' records). Checksums of changed
+// blocks are recomputed; the others are kept from the old trailer. The string section may only
+// have grown since that save; it is rewritten if it did, or if the trailer before it moved. The
+// new bytes are first written to a redo file, so a crash halfway through never leaves a
+// half-updated data file. Returns 1 on success, 0 on a write error and -1 if the file does not
+// allow an incremental save.
+int saveDataFileIncremental(const char *filename, RecordSchema *schema, const SegmentStore *records, int count,
+                            const char *strings, size_t stringBytes, const DirtySet *dirty, int persistedCount) {
+    initRecordSchema(schema);
+
+    int fd = open(filename, O_RDWR);
+    if (fd < 0) {
+        return -1;
+    }
+
+    DataFileHeader header;
+    if (pread(fd, &header, sizeof(header), 0) != (ssize_t)sizeof(header) ||
+        littleEndian32(header.magic) != DATA_FILE_MAGIC || littleEndian16(header.version) != schema->version ||
+        littleEndian32(header.recordSize) != schema->recordSize || littleEndian32(header.blockRecords) != CHECKSUM_BLOCK_RECORDS ||
+        littleEndian32(header.recordCount) != (uint32_t)persistedCount || littleEndian32(header.stringBytes) > stringBytes) {
+        close(fd);
+        return -1;
+    }
+    size_t newStringBytes = count != persistedCount || littleEndian32(header.stringBytes) != stringBytes ? stringBytes : 0;
+
+    size_t recordSize = schema->recordSize;
+    int oldBlocks = (persistedCount + CHECKSUM_BLOCK_RECORDS - 1) / CHECKSUM_BLOCK_RECORDS;
+    int newBlocks = (count + CHECKSUM_BLOCK_RECORDS - 1) / CHECKSUM_BLOCK_RECORDS;
+    int entryCount = 0;
+    for (int slot = 0; slot < count; slot++) {
+        if (isDirty(dirty, slot)) {
+            entryCount++;
+        }
+    }
+
+    // Redo buffer: header, dirty records, new trailer, string section, new data file header, checksum
+    size_t redoSize = sizeof(RedoHeader) + (size_t)entryCount * (sizeof(uint32_t) + recordSize) +
+                      (size_t)newBlocks * sizeof(uint32_t) + (newStringBytes > 0 ? newStringBytes + sizeof(uint32_t) : 0) +
+                      sizeof(DataFileHeader) + sizeof(uint32_t);
+    unsigned char *redo = malloc(redoSize);
+    uint32_t *oldCrcs = malloc((size_t)oldBlocks * sizeof(uint32_t) + 1);
+    unsigned char *block = malloc(CHECKSUM_BLOCK_RECORDS * recordSize);
+    if (redo == NULL || oldCrcs == NULL || block == NULL) {
+        printf("Memory allocation failed!\n");
+        exit(1);
+    }
+
+    int ok = pread(fd, oldCrcs, (size_t)oldBlocks * sizeof(uint32_t), (off_t)(sizeof(DataFileHeader) + (size_t)persistedCount * recordSize)) ==
+             (ssize_t)((size_t)oldBlocks * sizeof(uint32_t));
+
+    RedoHeader redoHeader = { REDO_FILE_MAGIC, (uint32_t)recordSize, (uint32_t)entryCount, (uint32_t)newBlocks, (uint32_t)newStringBytes };
+    memcpy(redo, &redoHeader, sizeof(redoHeader));
+    unsigned char *cursor = redo + sizeof(redoHeader);
+    for (int slot = 0; slot < count; slot++) {
+        if (isDirty(dirty, slot)) {
+            uint32_t storedSlot = (uint32_t)slot;
+            memcpy(cursor, &storedSlot, sizeof(storedSlot));
+            encodeRecord(schema, segmentRecord(records, slot), cursor + sizeof(storedSlot));
+            cursor += sizeof(storedSlot) + recordSize;
+        }
+    }
+
+    for (int b = 0; b < newBlocks; b++) {
+        int first = b * CHECKSUM_BLOCK_RECORDS;
+        int last = first + CHECKSUM_BLOCK_RECORDS < count ? first + CHECKSUM_BLOCK_RECORDS : count;
+        int resized = b == newBlocks - 1 && count != persistedCount;
+        uint32_t crc;
+        if (b < oldBlocks && !resized && !isRangeDirty(dirty, first, last)) {
+            crc = oldCrcs[b];
+        } else {
+            // Checksum the block as it will be on disk: clean records as they are in the file
+            // (struct padding in memory need not match it), dirty ones as encoded now
+            int onDisk = last < persistedCount ? last : persistedCount;
+            if (onDisk > first) {
+                size_t bytes = (size_t)(onDisk - first) * recordSize;
+                ok = ok && pread(fd, block, bytes, (off_t)(sizeof(DataFileHeader) + (size_t)first * recordSize)) == (ssize_t)bytes;
+            }
+            for (int slot = first; slot < last; slot++) {
+                if (slot >= onDisk || isDirty(dirty, slot)) {
+                    encodeRecord(schema, segmentRecord(records, slot), block + (size_t)(slot - first) * recordSize);
+                }
+            }
+            crc = littleEndian32(crc32c(0, block, (size_t)(last - first) * recordSize));
+        }
+        memcpy(cursor, &crc, sizeof(crc));
+        cursor += sizeof(crc);
+    }
+    if (newStringBytes > 0) {
+        uint32_t stringCrc = littleEndian32(crc32c(0, strings, newStringBytes));
+        memcpy(cursor, strings, newStringBytes);
+        memcpy(cursor + newStringBytes, &stringCrc, sizeof(stringCrc));
+        cursor += newStringBytes + sizeof(stringCrc);
+    }
+
+    header.recordCount = littleEndian32((uint32_t)count);
+    header.stringBytes = littleEndian32((uint32_t)stringBytes);
+    header.headerCrc = littleEndian32(crc32c(0, &header, offsetof(DataFileHeader, headerCrc)));
+    memcpy(cursor, &header, sizeof(header));
+    cursor += sizeof(header);
+    uint32_t redoCrc = crc32c(0, redo, (size_t)(cursor - redo));
+    memcpy(cursor, &redoCrc, sizeof(redoCrc));
+
+    char redoPath[256];
+    snprintf(redoPath, sizeof(redoPath), "%s%s", filename, REDO_SUFFIX);
+    if (ok) {
+        int redoFd = open(redoPath, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        ok = redoFd >= 0 && writeFully(redoFd, redo, redoSize) && fsync(redoFd) == 0;
+        if (redoFd >= 0) {
+            close(redoFd);
+        }
+    }
+
+    // The redo file is durable, now update the data file in place
+    if (ok) {
+        ok = applyRedo(fd, redo);
+        if (ok) {
+            remove(redoPath);
+        }
+    } else {
+        remove(redoPath);
+    }
+
+    close(fd);
+    free(redo);
+    free(oldCrcs);
+    free(block);
+    return ok;
+}
+
+// Background thread that writes queued snapshots, so saving never blocks the menus
+void *snapshotWorkerMain(void *argument) {
+    SnapshotWorker *worker = argument;
+
+    pthread_mutex_lock(&worker->mutex);
+    while (1) {
+        while (worker->queued == 0 && !worker->stopping) {
+            pthread_cond_wait(&worker->wake, &worker->mutex);
+        }
+        if (worker->queued == 0) {
+            break; // Stopping and nothing left to write
+        }
+        SnapshotJob *job = worker->queue[0];
+        worker->queued--;
+        memmove(worker->queue, worker->queue + 1, (size_t)worker->queued * sizeof(SnapshotJob *));
+        pthread_mutex_unlock(&worker->mutex);
+
+        int result = saveDataFile(job->filename, job->schema, &job->records, job->count, job->strings, job->stringBytes);
+
+        pthread_mutex_lock(&worker->mutex);
+        job->result = result;
+        job->state = SNAPSHOT_DONE;
+        pthread_cond_broadcast(&worker->finished);
+    }
+    pthread_mutex_unlock(&worker->mutex);
+    return NULL;
+}
+
+int startSnapshotWorker(SnapshotWorker *worker) {
+    worker->queued = 0;
+    worker->stopping = 0;
+    pthread_mutex_init(&worker->mutex, NULL);
+    pthread_cond_init(&worker->wake, NULL);
+    pthread_cond_init(&worker->finished, NULL);
+
+    // Set up the CRC32C code paths before a second thread can use them
+    hasHardwareCrc32c();
+    crc32cSoftware(0, NULL, 0);
+
+    if (pthread_create(&worker->thread, NULL, snapshotWorkerMain, worker) != 0) {
+        printf("Error starting the background save thread, saving in the foreground instead.\n");
+        return 0;
+    }
+    return 1;
+}
+
+// Lets the worker finish its queue, then stops it
+void stopSnapshotWorker(SnapshotWorker *worker) {
+    pthread_mutex_lock(&worker->mutex);
+    worker->stopping = 1;
+    pthread_cond_signal(&worker->wake);
+    pthread_mutex_unlock(&worker->mutex);
+    pthread_join(worker->thread, NULL);
+}
+
+// Takes a private copy of the records and hands it to the worker. Copying is a memcpy per segment,
+// after which the menus may change the list freely while the snapshot is written.
+void queueSnapshot(SnapshotJob *job, const char *filename, RecordSchema *schema, const SegmentStore *records, int count,
+                   const char *strings, size_t stringBytes, off_t logBoundary, int loggedRecords) {
+    segmentStoreCopy(&job->records, records, count);
+    job->strings = NULL;
+    job->stringBytes = stringBytes;
+    if (stringBytes > 0) {
+        job->strings = malloc(stringBytes);
+        if (job->strings == NULL) {
+            printf("Memory allocation failed!\n");
+            exit(1);
+        }
+        memcpy(job->strings, strings, stringBytes);
+    }
+    job->filename = filename;
+    job->schema = schema;
+    job->count = count;
+    job->logBoundary = logBoundary;
+    job->loggedRecords = loggedRecords;
+    job->startedAt = time(NULL);
+
+    SnapshotWorker *worker = job->worker;
+    pthread_mutex_lock(&worker->mutex);
+    job->state = SNAPSHOT_QUEUED;
+    worker->queue[worker->queued++] = job;
+    pthread_cond_signal(&worker->wake);
+    pthread_mutex_unlock(&worker->mutex);
+}
+
+// Returns the result of the job's snapshot (1 saved, 0 failed) and makes the job idle again, or
+// -1 if no snapshot has finished. With 'wait' set, waits for a snapshot that is still in progress.
+int finishSnapshot(SnapshotJob *job, int wait) {
+    if (job->worker == NULL) {
+        return -1;
+    }
+
+    SnapshotWorker *worker = job->worker;
+    pthread_mutex_lock(&worker->mutex);
+    while (wait && job->state == SNAPSHOT_QUEUED) {
+        pthread_cond_wait(&worker->finished, &worker->mutex);
+    }
+    int result = -1;
+    if (job->state == SNAPSHOT_DONE) {
+        result = job->result;
+        job->state = SNAPSHOT_IDLE;
+        segmentStoreFree(&job->records);
+        free(job->strings);
+        job->strings = NULL;
+    }
+    pthread_mutex_unlock(&worker->mutex);
+    return result;
+}
+
+// Returns 1 if the list has waited long enough, or changed enough, to be snapshotted again
+int isSnapshotDue(const SnapshotJob *job, const DirtySet *dirty, int persistedCount, int loggedRecords) {
+    if (dirty->count == 0 && persistedCount >= 0) {
+        return 0; // Nothing to save
+    }
+    return persistedCount < 0 || dirty->count >= snapshotDirtyRecords || loggedRecords >= WAL_CHECKPOINT_RECORDS ||
+           (snapshotIntervalSeconds > 0 && time(NULL) - job->startedAt >= snapshotIntervalSeconds);
+}
+
+void printMember(const Member *member){
+    printf("Member ID: %d\n", member->memberID);
+    printf("First Name: %s\n", member->firstName);
+    printf("Last Name: %s\n", member->lastName);
+    printf("Phone Number: %s\n", member->phoneNum);
+    printf("Gender: %c\n", member->gender);
+    printf("Emergency Contact Name: %s\n", member->emergencyName);
+    printf("Emergency Contact Phone: %s\n", member->emergencyPhone);
+    printf("Emergency Contact Relation: %s\n", member->emergencyRelation);
+    printf("Date of Birth: %02d/%02d/%04d\n", member->dob.day, member->dob.month, member->dob.year);
+    printf("-------------------------------\n");
+}
+
+// FNV-1a hash of a name with ASCII letters folded to lower case, continuing from 'hash'
+uint64_t foldedNameHash(const char *name, uint64_t hash) {
+    for (const unsigned char *c = (const unsigned char *)name; *c != '\0'; c++) {
+        hash = (hash ^ (uint64_t)tolower(*c)) * 1099511628211ull;
+    }
+    return hash;
+}
+
+// Appends the distinct trigrams of each space-separated word of 'text' to 'grams' (which holds
+// 'count' already) and returns the new count. Words are lower-cased and padded with two zero
+// bytes in front, so the first trigrams of a word encode its prefix; with 'wholeWords' one zero
+// byte is added at the end as well, marking where the word stops.
+int nameTrigrams(const char *text, uint64_t *grams, int count, int wholeWords) {
+    const unsigned char *c = (const unsigned char *)text;
+    while (*c != '\0') {
+        while (*c == ' ') {
+            c++;
+        }
+        if (*c == '\0') {
+            break;
+        }
+        uint64_t window = 0;
+        for (; ; c++) {
+            int atEnd = *c == '\0' || *c == ' ';
+            if (atEnd && !wholeWords) {
+                break;
+            }
+            window = ((window << 8) | (atEnd ? 0 : (uint64_t)tolower(*c))) & 0xFFFFFF;
+            int duplicate = 0;
+            for (int i = 0; i < count && !duplicate; i++) {
+                duplicate = grams[i] == window;
+            }
+            if (!duplicate && count < MAX_NAME_TRIGRAMS) {
+                grams[count++] = window;
+            }
+            if (atEnd) {
+                break;
+            }
+        }
+    }
+    return count;
+}
+
+// Edit distance between 'query' and the closest prefix of 'word' (both lower case), counting a
+// swap of two neighbouring letters as one edit. Gives up with limit + 1 once every prefix is
+// further away than 'limit'.
+int prefixEditDistance(const char *query, int queryLength, const char *word, int wordLength, int limit) {
+    if (limit == 0) {
+        return queryLength <= wordLength && memcmp(query, word, (size_t)queryLength) == 0 ? 0 : 1;
+    }
+
+    // rows[r][j]: distance between the first i - 2 + r letters of query and the first j of word
+    int rows[3][NAME_LENGTH + 1] = {{0}};
+    int *older = rows[0], *previous = rows[1], *current = rows[2];
+
+    for (int j = 0; j <= wordLength; j++) {
+        previous[j] = j;
+    }
+    for (int i = 1; i <= queryLength; i++) {
+        current[0] = i;
+        int rowMin = i;
+        for (int j = 1; j <= wordLength; j++) {
+            int cost = query[i - 1] == word[j - 1] ? 0 : 1;
+            int best = previous[j - 1] + cost;
+            if (previous[j] + 1 < best) {
+                best = previous[j] + 1;
+            }
+            if (current[j - 1] + 1 < best) {
+                best = current[j - 1] + 1;
+            }
+            if (i > 1 && j > 1 && query[i - 1] == word[j - 2] && query[i - 2] == word[j - 1] && older[j - 2] + 1 < best) {
+                best = older[j - 2] + 1;
+            }
+            current[j] = best;
+            if (best < rowMin) {
+                rowMin = best;
+            }
+        }
+        if (rowMin > limit) {
+            return limit + 1;
+        }
+        int *recycled = older;
+        older = previous;
+        previous = current;
+        current = recycled;
+    }
+
+    int best = previous[0];
+    for (int j = 1; j <= wordLength; j++) {
+        if (previous[j] < best) {
+            best = previous[j];
+        }
+    }
+    return best;
+}
+
+#define NAME_HASH_SEED 14695981039346656037ull
+#define PHONE_KEY_DIGITS 16 // Longest phone number that fits in a phoneKey
+
+uint64_t fullNameKey(const char *firstName, const char *lastName) {
+    // The separator keeps "Ann Lee" + "Smith" apart from "Ann" + "Lee Smith"
+    uint64_t hash = foldedNameHash(firstName, NAME_HASH_SEED);
+    hash = (hash ^ 0xFF) * 1099511628211ull;
+    return foldedNameHash(lastName, hash);
+}
+
+// Index key of a phone number: its digits as an integer, with the digit count in the top byte so
+// that leading zeros still count ("0123" and "123" differ). Other characters are ignored.
+// Returns 0 when there are no digits or more than PHONE_KEY_DIGITS.
+uint64_t phoneKey(const char *phone) {
+    uint64_t value = 0, digits = 0;
+    for (const char *c = phone; *c != '\0'; c++) {
+        if (isdigit((unsigned char)*c)) {
+            if (++digits > PHONE_KEY_DIGITS) {
+                return 0;
+            }
+            value = value * 10 + (uint64_t)(*c - '0');
+        }
+    }
+    return digits == 0 ? 0 : (digits << 56) | value;
+}
+
+// Writes the phone number a phoneKey was made from into 'phone' ("" for key 0)
+void phoneFromKey(uint64_t key, char *phone, size_t size) {
+    size_t digits = (size_t)(key >> 56);
+    uint64_t value = key & ((1ull << 56) - 1);
+    if (digits >= size) {
+        digits = size - 1;
+    }
+    phone[digits] = '\0';
+    while (digits > 0) {
+        phone[--digits] = (char)('0' + value % 10);
+        value /= 10;
+    }
+}
+
+// Adds an offset to the arena's table, which has a free bucket
+void nameArenaInsert(NameArena *arena, uint32_t offset) {
+    size_t mask = arena->tableSize - 1;
+    size_t bucket = (size_t)foldedNameHash(arena->bytes + offset, NAME_HASH_SEED) & mask;
+    while (arena->table[bucket] != NAME_ARENA_EMPTY) {
+        bucket = (bucket + 1) & mask;
+    }
+    arena->table[bucket] = offset;
+    arena->strings++;
+}
+
+// Keeps the table at most half full
+void nameArenaReserveTable(NameArena *arena) {
+    if ((arena->strings + 1) * 2 <= arena->tableSize) {
+        return;
+    }
+    uint32_t *old = arena->table;
+    size_t oldSize = arena->tableSize;
+    arena->tableSize = oldSize > 0 ? oldSize * 2 : 1024;
+    arena->table = malloc(arena->tableSize * sizeof(uint32_t));
+    if (arena->table == NULL) {
+        printf("Memory allocation failed!\n");
+        exit(1);
+    }
+    memset(arena->table, 0xFF, arena->tableSize * sizeof(uint32_t));
+    arena->strings = 0;
+    for (size_t i = 0; i < oldSize; i++) {
+        if (old[i] != NAME_ARENA_EMPTY) {
+            nameArenaInsert(arena, old[i]);
+        }
+    }
+    free(old);
+}
+
+// Returns the offset of 'name' in the arena, adding it if it is not there yet
+uint32_t nameArenaIntern(NameArena *arena, const char *name) {
+    nameArenaReserveTable(arena);
+    size_t mask = arena->tableSize - 1;
+    size_t bucket = (size_t)foldedNameHash(name, NAME_HASH_SEED) & mask;
+    for (; arena->table[bucket] != NAME_ARENA_EMPTY; bucket = (bucket + 1) & mask) {
+        if (strcmp(arena->bytes + arena->table[bucket], name) == 0) {
+            return arena->table[bucket];
+        }
+    }
+
+    size_t length = strnlen(name, NAME_LENGTH - 1);
+    if (arena->used + length + 1 + NAME_LENGTH > arena->capacity) {
+        size_t capacity = arena->capacity > 0 ? arena->capacity * 2 : 4096;
+        while (arena->used + length + 1 + NAME_LENGTH > capacity) {
+            capacity *= 2;
+        }
+        arena->bytes = realloc(arena->bytes, capacity);
+        if (arena->bytes == NULL) {
+            printf("Memory allocation failed!\n");
+            exit(1);
+        }
+        arena->capacity = capacity;
+    }
+    uint32_t offset = (uint32_t)arena->used;
+    memcpy(arena->bytes + offset, name, length);
+    arena->bytes[offset + length] = '\0';
+    arena->used += length + 1;
+    memset(arena->bytes + arena->used, 0, NAME_LENGTH); // The slack stays zeroed
+    arena->table[bucket] = offset;
+    arena->strings++;
+    return offset;
+}
+
+void nameArenaInit(NameArena *arena) {
+    memset(arena, 0, sizeof(NameArena));
+    nameArenaIntern(arena, "");
+    arena->packedUsed = arena->used;
+}
+
+// Takes over the string section of members.dat. Returns 0 if it does not hold valid names.
+int nameArenaAdopt(NameArena *arena, char *strings, size_t stringBytes) {
+    if (stringBytes == 0 || strings[0] != '\0' || strings[stringBytes - 1] != '\0') {
+        return 0;
+    }
+    memset(arena, 0, sizeof(NameArena));
+    arena->bytes = realloc(strings, stringBytes + NAME_LENGTH);
+    if (arena->bytes == NULL) {
+        printf("Memory allocation failed!\n");
+        exit(1);
+    }
+    memset(arena->bytes + stringBytes, 0, NAME_LENGTH);
+    arena->used = stringBytes;
+    arena->capacity = stringBytes + NAME_LENGTH;
+    arena->packedUsed = stringBytes;
+    for (size_t offset = 0; offset < stringBytes; ) {
+        size_t length = strlen(arena->bytes + offset);
+        if (length >= NAME_LENGTH) {
+            return 0;
+        }
+        nameArenaReserveTable(arena);
+        nameArenaInsert(arena, (uint32_t)offset);
+        offset += length + 1;
+    }
+    return 1;
+}
+
+void nameArenaFree(NameArena *arena) {
+    free(arena->bytes);
+    free(arena->table);
+    memset(arena, 0, sizeof(NameArena));
+}
+
+// Code of a relationship in relationNames; anything else counts as "Other"
+uint8_t relationCode(const char *relation) {
+    int count = (int)(sizeof(relationNames) / sizeof(relationNames[0]));
+    for (int i = 0; i < count; i++) {
+        if (strcasecmp(relation, relationNames[i]) == 0) {
+            return (uint8_t)i;
+        }
+    }
+    return (uint8_t)(count - 1);
+}
+
+void packMember(MemberList *list, const Member *member, PackedMember *packed) {
+    packed->phoneNum = phoneKey(member->phoneNum);
+    packed->emergencyPhone = phoneKey(member->emergencyPhone);
+    packed->memberID = member->memberID;
+    packed->firstName = nameArenaIntern(&list->names, member->firstName);
+    packed->lastName = nameArenaIntern(&list->names, member->lastName);
+    packed->emergencyName = nameArenaIntern(&list->names, member->emergencyName);
+    packed->birthDay = dayNumber(member->dob);
+    packed->gender = member->gender == 'M' ? GENDER_MALE : (member->gender == 'F' ? GENDER_FEMALE : GENDER_UNKNOWN);
+    packed->emergencyRelation = relationCode(member->emergencyRelation);
+}
+
+void unpackMember(const MemberList *list, const PackedMember *packed, Member *member) {
+    memset(member, 0, sizeof(Member));
+    member->memberID = packed->memberID;
+    strcpy(member->firstName, list->names.bytes + packed->firstName);
+    strcpy(member->lastName, list->names.bytes + packed->lastName);
+    phoneFromKey(packed->phoneNum, member->phoneNum, sizeof(member->phoneNum));
+    member->gender = genderLetters[packed->gender];
+    strcpy(member->emergencyName, list->names.bytes + packed->emergencyName);
+    phoneFromKey(packed->emergencyPhone, member->emergencyPhone, sizeof(member->emergencyPhone));
+    strcpy(member->emergencyRelation, relationNames[packed->emergencyRelation]);
+    if (packed->birthDay >= 0) {
+        member->dob = dateFromDayNumber(packed->birthDay);
+    }
+}
+
+// The packed member in a slot (deleted if its memberID is 0)
+PackedMember* packedMemberAt(const MemberList *list, int slot){
+    return segmentRecord(&list->store, slot);
+}
+
+// Unpacks the member in a slot into 'member'
+void readMember(const MemberList *list, int slot, Member *member){
+    unpackMember(list, packedMemberAt(list, slot), member);
+}
+
+// Packs 'member' into a slot and fills its columns
+void storeMember(MemberList *list, int slot, const Member *member){
+    PackedMember *packed = packedMemberAt(list, slot);
+    packMember(list, member, packed);
+    columnsSet(&list->columns, slot, packed);
+}
+
+// Grows the list so it can hold at least 'capacity' members; the members it holds do not move
+void reserveMembers(MemberList *list, int capacity){
+    segmentStoreReserve(&list->store, capacity);
+}
+
+// Rebuilds the name arena from the names of the members still in the list, dropping the names of
+// members that were renamed or deleted. The offsets change, so members.dat is rewritten in full:
+// every slot is marked as changed, which also holds if a snapshot taken before the repack is
+// collected afterwards and makes the save incremental again.
+void packMemberNames(MemberList *list){
+    NameArena old = list->names;
+    nameArenaInit(&list->names);
+    for (int slot = 0; slot < list->count; slot++) {
+        PackedMember *packed = packedMemberAt(list, slot);
+        if (packed->memberID == 0) {
+            packed->firstName = packed->lastName = packed->emergencyName = 0;
+        } else {
+            packed->firstName = nameArenaIntern(&list->names, old.bytes + packed->firstName);
+            packed->lastName = nameArenaIntern(&list->names, old.bytes + packed->lastName);
+            packed->emergencyName = nameArenaIntern(&list->names, old.bytes + packed->emergencyName);
+        }
+        list->columns.firstNames[slot] = packed->firstName;
+        list->columns.lastNames[slot] = packed->lastName;
+    }
+    list->names.packedUsed = list->names.used;
+    nameArenaFree(&old);
+    if (list->count > 0) {
+        markDirtyRange(&list->dirty, 0, list->count - 1);
+    }
+    list->persistedCount = -1;
+}
+
+// Rebuilds the name arena once it has doubled since it was last built, which keeps the cost
+// amortised O(1) per name stored and the unused names at most half of it
+void trimMemberNames(MemberList *list){
+    if (list->names.used >= 65536 && list->names.used >= 2 * list->names.packedUsed) {
+        packMemberNames(list);
+    }
+}
+
+void indexMember(MemberList *list, const Member *member){
+    multimapAdd(&list->firstNameIndex, foldedNameHash(member->firstName, NAME_HASH_SEED), member->memberID);
+    multimapAdd(&list->lastNameIndex, foldedNameHash(member->lastName, NAME_HASH_SEED), member->memberID);
+    multimapAdd(&list->fullNameIndex, fullNameKey(member->firstName, member->lastName), member->memberID);
+
+    uint64_t grams[MAX_NAME_TRIGRAMS];
+    int gramCount = nameTrigrams(member->lastName, grams, nameTrigrams(member->firstName, grams, 0, 1), 1);
+    for (int i = 0; i < gramCount; i++) {
+        multimapAdd(&list->trigramIndex, grams[i], member->memberID);
+    }
+
+    multimapAdd(&list->phoneIndex, phoneKey(member->phoneNum), member->memberID);
+    multimapAdd(&list->emergencyPhoneIndex, phoneKey(member->emergencyPhone), member->memberID);
+    dobIndexAdd(&list->dobIndex, member);
+}
+
+void unindexMember(MemberList *list, const Member *member){
+    multimapRemove(&list->firstNameIndex, foldedNameHash(member->firstName, NAME_HASH_SEED), member->memberID);
+    multimapRemove(&list->lastNameIndex, foldedNameHash(member->lastName, NAME_HASH_SEED), member->memberID);
+    multimapRemove(&list->fullNameIndex, fullNameKey(member->firstName, member->lastName), member->memberID);
+
+    uint64_t grams[MAX_NAME_TRIGRAMS];
+    int gramCount = nameTrigrams(member->lastName, grams, nameTrigrams(member->firstName, grams, 0, 1), 1);
+    for (int i = 0; i < gramCount; i++) {
+        multimapRemove(&list->trigramIndex, grams[i], member->memberID);
+    }
+
+    multimapRemove(&list->phoneIndex, phoneKey(member->phoneNum), member->memberID);
+    multimapRemove(&list->emergencyPhoneIndex, phoneKey(member->emergencyPhone), member->memberID);
+    dobIndexRemove(&list->dobIndex, member);
+}
+
+// Returns the ID of a member other than 'exceptID' registered with 'phone', or -1 if there is none
+int phoneOwner(MemberList *list, const char *phone, int exceptID){
+    const int *ids;
+    int count = multimapGet(&list->phoneIndex, phoneKey(phone), &ids);
+    for (int i = 0; i < count; i++) {
+        if (ids[i] != exceptID) {
+            return ids[i];
+        }
+    }
+    return -1;
+}
+
+void addMember(MemberList *list, Member *member){
+    // Check if list is full, and add a segment if so
+    if(list->count == segmentStoreCapacity(&list->store)){
+        reserveMembers(list, list->count + 1);
+    }
+
+    // Add new member
+    storeMember(list, list->count, member);
+    idIndexPut(&list->idIndex, member->memberID, list->count);
+    handleAttach(&list->handles, list->count);
+    indexMember(list, member);
+    markDirty(&list->dirty, list->count);
+    list->count++;
+
+    walAppendRecord(&list->log, WAL_MEMBER_PUT, &memberSchema, member);
+}
+
+// Returns the position of the member in the list, or -1 if not found
+int findMemberIndex(MemberList *list, int memberID){
+    return idIndexGet(&list->idIndex, memberID);
+}
+
+// Deletes the member in a slot by clearing its memberID, leaving the other members where they are.
+// The slot is reclaimed by compactMembers.
+void removeMemberAt(MemberList *list, int foundIndex){
+    Member member;
+    readMember(list, foundIndex, &member);
+    idIndexRemove(&list->idIndex, member.memberID);
+    handleDetach(&list->handles, foundIndex);
+    unindexMember(list, &member);
+    list->columns.ids[foundIndex] = 0;
+    packedMemberAt(list, foundIndex)->memberID = 0;
+    list->deletedCount++;
+    markDirty(&list->dirty, foundIndex);
+}
+
+// Returns 1 once deleted slots make up enough of the list to be worth compacting
+int shouldCompact(int deletedCount, int count){
+    return deletedCount >= COMPACT_MIN_DELETED && deletedCount * COMPACT_DELETED_RATIO >= count;
+}
+
+// Slides the remaining members over the deleted slots, keeping their order
+void compactMembers(MemberList *list){
+    int live = 0;
+    int firstMoved = -1;
+    for (int i = 0; i < list->count; i++) {
+        if (packedMemberAt(list, i)->memberID == 0) {
+            continue;
+        }
+        if (i != live) {
+            if (firstMoved == -1) {
+                firstMoved = live;
+            }
+            *packedMemberAt(list, live) = *packedMemberAt(list, i);
+            idIndexPut(&list->idIndex, packedMemberAt(list, live)->memberID, live);
+            handleMove(&list->handles, i, live);
+            columnsMove(&list->columns, i, live);
+        }
+        live++;
+    }
+    if (firstMoved != -1) {
+        markDirtyRange(&list->dirty, firstMoved, live - 1);
+    }
+    list->count = live;
+    list->deletedCount = 0;
+    trimMemberNames(list);
+    segmentStoreTrim(&list->store, list->count);
+}
+
+// Stores the edited 'member' back into its slot, logs it and marks it for saving, and re-indexes it
+// if a name, phone number or date of birth changed; 'previous' holds its old values
+void updateMember(MemberList *list, int slot, const Member *member, const Member *previous){
+    if (strcmp(previous->firstName, member->firstName) != 0 || strcmp(previous->lastName, member->lastName) != 0 ||
+        strcmp(previous->phoneNum, member->phoneNum) != 0 || strcmp(previous->emergencyPhone, member->emergencyPhone) != 0 ||
+        compareDates(previous->dob, member->dob) != 0){
+        unindexMember(list, previous);
+        indexMember(list, member);
+    }
+    storeMember(list, slot, member);
+    trimMemberNames(list);
+    markDirty(&list->dirty, slot);
+    walAppendRecord(&list->log, WAL_MEMBER_PUT, &memberSchema, member);
+}
+
+void deleteMember(MemberList *list, int memberID){
+
+    int foundIndex = findMemberIndex(list, memberID);
+
+    // Member not found if foundIndex = -1
+    if (foundIndex == -1){
+        printf("Member with ID %d not found.\n", memberID);
+        return;
+    }
+
+    removeMemberAt(list, foundIndex);
+
+    walAppend(&list->log, WAL_MEMBER_DELETE, &memberID, sizeof(memberID));
+}
+
+void printMemberAt(const MemberList *list, int slot){
+    Member member;
+    readMember(list, slot, &member);
+    printMember(&member);
+}
+
+void listMembers(MemberList *list){
+    // Check for an empty list
+    if (list->count == list->deletedCount){
+        printf("There are no current members in the database\n");
+        return;
+    }
+
+    for(int i = 0; i < list->count; i++){
+        if (packedMemberAt(list, i)->memberID != 0) {
+            printMemberAt(list, i);
+        }
+    }
+}
+
+// Unpacks the member into 'member' and returns 1, or returns 0 if there is no such member
+int findMemberByID(MemberList *list, int memberID, Member *member){
+    int index = findMemberIndex(list, memberID);
+    if (index != -1){
+        readMember(list, index, member);
+        return 1;
+    }
+
+    // If member not found
+    return 0;
+}
+
+// Prints a member known to be in the list, e.g. one found through an index
+void printMemberByID(MemberList *list, int memberID){
+    int index = findMemberIndex(list, memberID);
+    if (index != -1) {
+        printMemberAt(list, index);
+    }
+}
+
+// Returns a handle to the member, or a null handle if there is no such member
+RecordHandle findMemberHandle(MemberList *list, int memberID){
+    return handleAt(&list->handles, findMemberIndex(list, memberID));
+}
+
+// Unpacks the member a handle refers to into 'member' and returns its current slot, or returns -1
+// if it has been deleted
+int resolveMember(MemberList *list, RecordHandle handle, Member *member){
+    int slot = handleSlot(&list->handles, handle);
+    if (slot != -1) {
+        readMember(list, slot, member);
+    }
+    return slot;
+}
+
+// Prints the members whose first and/or last name match (ignoring case); NULL skips that name.
+// Returns the number of members printed.
+int printMembersByName(MemberList *list, const char *firstName, const char *lastName){
+    const int *ids;
+    int candidates;
+    if (firstName != NULL && lastName != NULL) {
+        candidates = multimapGet(&list->fullNameIndex, fullNameKey(firstName, lastName), &ids);
+    } else if (firstName != NULL) {
+        candidates = multimapGet(&list->firstNameIndex, foldedNameHash(firstName, NAME_HASH_SEED), &ids);
+    } else {
+        candidates = multimapGet(&list->lastNameIndex, foldedNameHash(lastName, NAME_HASH_SEED), &ids);
+    }
+
+    int found = 0;
+    for (int i = 0; i < candidates; i++) {
+        int index = findMemberIndex(list, ids[i]);
+        if (index == -1) {
+            continue;
+        }
+        // Rule out hash collisions
+        const PackedMember *packed = packedMemberAt(list, index);
+        if ((firstName == NULL || strcasecmp(list->names.bytes + packed->firstName, firstName) == 0) &&
+            (lastName == NULL || strcasecmp(list->names.bytes + packed->lastName, lastName) == 0)) {
+            printMemberByID(list, ids[i]);
+            found++;
+        }
+    }
+    return found;
+}
+
+// Typos allowed in a query word: none for very short words, and never so many that a match could
+// share no trigram with the query (an insertion, deletion or substitution changes at most three)
+int fuzzyEditLimit(int wordLength) {
+    int limit = wordLength <= 3 ? 0 : (wordLength <= 6 ? 1 : 2);
+    while (limit > 0 && 3 * limit >= wordLength) {
+        limit--;
+    }
+    return limit;
+}
+
+// How well 'member' matches the query words: the sum over the words of the distance to the
+// closest name word prefix, or -1 if some word is further away than its limit
+int fuzzyMatchScore(const char *firstName, const char *lastName, char words[][NAME_LENGTH], int wordCount) {
+    char nameWords[FUZZY_MAX_WORDS * 2][NAME_LENGTH];
+    int nameWordCount = 0;
+    const char *names[2] = { firstName, lastName };
+    for (int n = 0; n < 2; n++) {
+        const char *c = names[n];
+        while (*c != '\0' && nameWordCount < FUZZY_MAX_WORDS * 2) {
+            while (*c == ' ') {
+                c++;
+            }
+            int length = 0;
+            while (*c != '\0' && *c != ' ' && length < NAME_LENGTH - 1) {
+                nameWords[nameWordCount][length++] = (char)tolower((unsigned char)*c++);
+            }
+            while (*c != '\0' && *c != ' ') {
+                c++;
+            }
+            if (length > 0) {
+                nameWords[nameWordCount++][length] = '\0';
+            }
+        }
+    }
+
+    int total = 0;
+    for (int w = 0; w < wordCount; w++) {
+        int length = (int)strlen(words[w]);
+        int limit = fuzzyEditLimit(length);
+        int best = limit + 1;
+        for (int n = 0; n < nameWordCount && best > 0; n++) {
+            int distance = prefixEditDistance(words[w], length, nameWords[n], (int)strlen(nameWords[n]), limit);
+            if (distance < best) {
+                best = distance;
+            }
+        }
+        if (best > limit) {
+            return -1;
+        }
+        total += best;
+    }
+    return total;
+}
+
+// Prints up to FUZZY_RESULTS members whose names best match 'query', the start of one or more
+// name words, possibly misspelled (e.g. "jon smi"). Returns the number of members printed.
+//
+// Candidates come from the trigram index. Every member on the posting lists of a query word's
+// trigrams gets a count of the trigrams it shares with the word; candidates are taken from the
+// word with the fewest and must reach the minimum count for every word. The word's prefix trigrams are
+// counted along with its end-of-word trigram, which only whole-word matches share, so those come
+// first. An edit changes at most four prefix trigrams (three, unless letters are swapped), which
+// gives both the minimum count for a member within the word's edit limit and a lower bound on the
+// distance of every count. Candidates are scored from the highest count down, and the search
+// stops once no remaining member can rank above the results (ranked by distance, then count).
+int printFuzzyMatches(MemberList *list, const char *query) {
+    char words[FUZZY_MAX_WORDS][NAME_LENGTH];
+    int wordCount = 0;
+    for (const char *c = query; *c != '\0' && wordCount < FUZZY_MAX_WORDS; ) {
+        while (*c == ' ') {
+            c++;
+        }
+        int length = 0;
+        while (*c != '\0' && *c != ' ' && length < NAME_LENGTH - 1) {
+            words[wordCount][length++] = (char)tolower((unsigned char)*c++);
+        }
+        while (*c != '\0' && *c != ' ') {
+            c++;
+        }
+        if (length > 0) {
+            words[wordCount++][length] = '\0';
+        }
+    }
+    if (wordCount == 0) {
+        return 0;
+    }
+
+    // Look up the posting lists of every word. A member sharing 'minShared' of a word's trigrams is
+    // on one of its (gramCount - minShared + 1) shortest lists, which bounds the candidates it gives.
+    const int *lists[FUZZY_MAX_WORDS][MAX_NAME_TRIGRAMS];
+    int listLengths[FUZZY_MAX_WORDS][MAX_NAME_TRIGRAMS];
+    int gramCounts[FUZZY_MAX_WORDS], prefixCounts[FUZZY_MAX_WORDS], minShareds[FUZZY_MAX_WORDS];
+    int primary = 0, maxID = 0;
+    long fewestCandidates = -1;
+    for (int w = 0; w < wordCount; w++) {
+        uint64_t grams[MAX_NAME_TRIGRAMS];
+        prefixCounts[w] = nameTrigrams(words[w], grams, 0, 0);
+        gramCounts[w] = nameTrigrams(words[w], grams, prefixCounts[w], 1);
+        minShareds[w] = prefixCounts[w] - 4 * fuzzyEditLimit((int)strlen(words[w]));
+        if (minShareds[w] < 1) {
+            minShareds[w] = 1;
+        }
+
+        int sorted[MAX_NAME_TRIGRAMS];
+        for (int g = 0; g < gramCounts[w]; g++) {
+            listLengths[w][g] = multimapGet(&list->trigramIndex, grams[g], &lists[w][g]);
+            sorted[g] = listLengths[w][g];
+            for (int i = 0; i < listLengths[w][g]; i++) {
+                if (lists[w][g][i] > maxID) {
+                    maxID = lists[w][g][i];
+                }
+            }
+        }
+        long candidates = 0;
+        for (int g = 0; g < gramCounts[w] - minShareds[w] + 1; g++) {
+            // Selection sort is plenty for a few dozen lists
+            int shortest = g;
+            for (int h = g + 1; h < gramCounts[w]; h++) {
+                if (sorted[h] < sorted[shortest]) {
+                    shortest = h;
+                }
+            }
+            int length = sorted[shortest];
+            sorted[shortest] = sorted[g];
+            sorted[g] = length;
+            candidates += length;
+        }
+        if (fewestCandidates < 0 || candidates < fewestCandidates) {
+            fewestCandidates = candidates;
+            primary = w;
+        }
+    }
+
+    // Count the shared trigrams of every member on the lists (IDs are small, so arrays will do).
+    // The other words are counted first, leaving a bit in 'passed' for each word whose minimum
+    // count a member reaches.
+    unsigned char *shared = calloc((size_t)maxID + 1, 1);
+    unsigned char *passed = wordCount > 1 ? calloc((size_t)maxID + 1, 1) : NULL;
+    if (shared == NULL || (wordCount > 1 && passed == NULL)) {
+        printf("Memory allocation failed!\n");
+        exit(1);
+    }
+    unsigned char allPassed = 0;
+    for (int w = 0; w < wordCount; w++) {
+        if (w == primary) {
+            continue;
+        }
+        allPassed |= (unsigned char)(1 << w);
+        for (int g = 0; g < gramCounts[w]; g++) {
+            for (int i = 0; i < listLengths[w][g]; i++) {
+                shared[lists[w][g][i]]++;
+            }
+        }
+        for (int g = 0; g < gramCounts[w]; g++) {
+            for (int i = 0; i < listLengths[w][g]; i++) {
+                int memberID = lists[w][g][i];
+                if (shared[memberID] >= minShareds[w]) {
+                    passed[memberID] |= (unsigned char)(1 << w);
+                }
+                shared[memberID] = 0;
+            }
+        }
+    }
+    int gramCount = gramCounts[primary], prefixGrams = prefixCounts[primary], minShared = minShareds[primary];
+    for (int g = 0; g < gramCount; g++) {
+        for (int i = 0; i < listLengths[primary][g]; i++) {
+            shared[lists[primary][g][i]]++;
+        }
+    }
+
+    // Group the candidates by count
+    int *buckets[MAX_NAME_TRIGRAMS + 1] = { NULL };
+    int bucketSizes[MAX_NAME_TRIGRAMS + 1] = { 0 };
+    int bucketCapacities[MAX_NAME_TRIGRAMS + 1] = { 0 };
+    for (int g = 0; g < gramCount; g++) {
+        for (int i = 0; i < listLengths[primary][g]; i++) {
+            int memberID = lists[primary][g][i];
+            int count = shared[memberID];
+            if (count < minShared || (passed != NULL && passed[memberID] != allPassed)) {
+                continue;
+            }
+            shared[memberID] = 0; // Taken
+            if (bucketSizes[count] == bucketCapacities[count]) {
+                bucketCapacities[count] = bucketCapacities[count] > 0 ? bucketCapacities[count] * 2 : 256;
+                buckets[count] = realloc(buckets[count], (size_t)bucketCapacities[count] * sizeof(int));
+                if (buckets[count] == NULL) {
+                    printf("Memory allocation failed!\n");
+                    exit(1);
+                }
+            }
+            buckets[count][bucketSizes[count]++] = memberID;
+        }
+    }
+    free(shared);
+    free(passed);
+
+    int results[FUZZY_RESULTS], distances[FUZZY_RESULTS];
+    int resultCount = 0;
+    for (int count = gramCount; count >= minShared; count--) {
+        int lowerBound = count >= prefixGrams ? 0 : (prefixGrams - count + 3) / 4;
+        for (int i = 0; i < bucketSizes[count]; i++) {
+            if (resultCount == FUZZY_RESULTS && distances[FUZZY_RESULTS - 1] <= lowerBound) {
+                break;
+            }
+            int index = findMemberIndex(list, buckets[count][i]);
+            if (index == -1) {
+                continue;
+            }
+            const PackedMember *packed = packedMemberAt(list, index);
+            int distance = fuzzyMatchScore(list->names.bytes + packed->firstName, list->names.bytes + packed->lastName, words, wordCount);
+            if (distance < 0) {
+                continue;
+            }
+            // Ties go to the member found first, which shares at least as many trigrams
+            int position = resultCount;
+            while (position > 0 && distance < distances[position - 1]) {
+                position--;
+            }
+            if (position == FUZZY_RESULTS) {
+                continue;
+            }
+            int last = resultCount < FUZZY_RESULTS ? resultCount++ : FUZZY_RESULTS - 1;
+            for (int r = last; r > position; r--) {
+                results[r] = results[r - 1];
+                distances[r] = distances[r - 1];
+            }
+            results[position] = buckets[count][i];
+            distances[position] = distance;
+        }
+    }
+    for (int count = 0; count <= gramCount; count++) {
+        free(buckets[count]);
+    }
+
+    for (int r = 0; r < resultCount; r++) {
+        printMemberByID(list, results[r]);
+    }
+    return resultCount;
+}
+
+// Calls 'visit' (unless it is NULL) with the slot of each member whose first or last name matches
+// 'pattern', reading only the name columns. Returns the number of matching members.
+int visitMembersWithName(MemberList *list, const ScanPattern *pattern, void (*visit)(void *context, int slot), void *context) {
+    const MemberColumns *columns = &list->columns;
+    int found = 0;
+    for (int i = 0; i < list->count; i++) {
+        if (columns->ids[i] == 0) {
+            continue;
+        }
+        if (fieldMatches(list->names.bytes + columns->firstNames[i], NAME_LENGTH, pattern) ||
+            fieldMatches(list->names.bytes + columns->lastNames[i], NAME_LENGTH, pattern)) {
+            if (visit != NULL) {
+                visit(context, i);
+            }
+            found++;
+        }
+    }
+    return found;
+}
+
+void printVisitedSlot(void *context, int slot) {
+    printMemberAt(context, slot);
+}
+
+// Prints the members whose first or last name matches 'pattern'. Returns the number printed.
+int printMembersWithName(MemberList *list, const ScanPattern *pattern) {
+    return visitMembersWithName(list, pattern, printVisitedSlot, list);
+}
+
+// Prints the members whose emergency contact's name matches 'pattern'. Returns the number of
+// members printed.
+int printMembersWithEmergencyName(MemberList *list, const ScanPattern *pattern) {
+    int found = 0;
+    for (int i = 0; i < list->count; i++) {
+        const PackedMember *packed = packedMemberAt(list, i);
+        if (packed->memberID != 0 && fieldMatches(list->names.bytes + packed->emergencyName, NAME_LENGTH, pattern)) {
+            printMemberAt(list, i);
+            found++;
+        }
+    }
+    return found;
+}
+
+// Day number of the latest valid date on or before day/month/year, limited to the dates a
+// DobIndex covers (-1 if the date is before them)
+int dayOnOrBefore(int day, int month, int year) {
+    if (year < 1900)
+        return -1;
+    if (year > 2100)
+        return DOB_DAYS - 1;
+    while (day > 1 && !isValidDate(day, month, year)) {
+        day--; // e.g. 29 February in a year that is not a leap year
+    }
+    Date date = {day, month, year};
+    return dayNumber(date);
+}
+
+// Calls 'visit' with the ID of each member whose age on 'today' (as calculateAge counts it) is
+// from minAge to maxAge, oldest first. Returns their number, which with a NULL 'visit' is counted
+// without going through them.
+int visitMembersByAge(MemberList *list, int minAge, int maxAge, Date today,
+                      void (*visit)(void *context, int memberID), void *context) {
+    // Born on or before today's date minAge years ago, and after today's date maxAge + 1 years ago
+    int first = dayOnOrBefore(today.day, today.month, today.year - maxAge - 1) + 1;
+    int last = dayOnOrBefore(today.day, today.month, today.year - minAge);
+    if (last < first) {
+        return 0;
+    }
+
+    DobIndex *index = &list->dobIndex;
+    int before = first > 0 ? dobIndexCountThrough(index, first - 1) : 0;
+    int found = dobIndexCountThrough(index, last) - before;
+    if (visit == NULL) {
+        return found;
+    }
+
+    // Step from one non-empty day to the next by rank, visiting each day's bucket
+    for (int rank = before + 1; rank <= before + found; ) {
+        const int *ids;
+        int count = multimapGet(&index->days, (uint64_t)dobIndexDayOfRank(index, rank), &ids);
+        if (count == 0) {
+            break;
+        }
+        for (int i = 0; i < count; i++) {
+            visit(context, ids[i]);
+        }
+        rank += count;
+    }
+    return found;
+}
+
+void printVisitedMember(void *context, int memberID) {
+    printMemberByID(context, memberID);
+}
+
+// Prints the members whose age on 'today' is from minAge to maxAge, oldest first. Returns the
+// number printed.
+int printMembersByAge(MemberList *list, int minAge, int maxAge, Date today) {
+    int found = visitMembersByAge(list, minAge, maxAge, today, NULL, NULL);
+    if (found > 0) {
+        printf("%d members aged %d to %d:\n", found, minAge, maxAge);
+        visitMembersByAge(list, minAge, maxAge, today, printVisitedMember, list);
+    }
+    return found;
+}
+
+// Calls 'visit' with the ID and birthday of each member whose birthday is in the 'days' days
+// starting with 'today', day by day. Members born on 29 February have their birthday on
+// 28 February in years without one. Returns the number of members visited.
+int visitUpcomingBirthdays(MemberList *list, Date today, int days,
+                           void (*visit)(void *context, int memberID, Date birthday), void *context) {
+    int start = dayNumber(today);
+    if (start < 0) {
+        return 0;
+    }
+
+    int found = 0;
+    for (int offset = 0; offset < days && offset < 366 && start + offset < DOB_DAYS; offset++) {
+        Date date = dateFromDayNumber(start + offset);
+        const int *ids = NULL;
+        int count = multimapGet(&list->dobIndex.birthdays, (uint64_t)(date.month * 32 + date.day), &ids);
+        const int *leapIds = NULL;
+        int leapCount = 0;
+        if (date.month == 2 && date.day == 28 && !isValidDate(29, 2, date.year)) {
+            leapCount = multimapGet(&list->dobIndex.birthdays, (uint64_t)(2 * 32 + 29), &leapIds);
+        }
+        for (int i = 0; i < count; i++) {
+            visit(context, ids[i], date);
+        }
+        for (int i = 0; i < leapCount; i++) {
+            visit(context, leapIds[i], date);
+        }
+        found += count + leapCount;
+    }
+    return found;
+}
+
+void printBirthdayMember(void *context, int memberID, Date birthday) {
+    BirthdayPrinter *printer = context;
+    if (birthday.day != printer->heading.day || birthday.month != printer->heading.month ||
+        birthday.year != printer->heading.year) {
+        printf("Birthdays on %02d/%02d/%04d:\n", birthday.day, birthday.month, birthday.year);
+        printer->heading = birthday;
+    }
+    printMemberByID(printer->list, memberID);
+}
+
+// Prints the members whose birthday is in the 'days' days starting with 'today', under a heading
+// for each day. Returns the number printed.
+int printUpcomingBirthdays(MemberList *list, Date today, int days) {
+    BirthdayPrinter printer = {list, {0, 0, 0}};
+    return visitUpcomingBirthdays(list, today, days, printBirthdayMember, &printer);
+}
+
+// Counts the members of each gender (male, female, other) in each of the AGE_BANDS age bands on
+// 'today', reading only the gender and date of birth columns
+void countMemberDemographics(MemberList *list, Date today, int counts[AGE_BANDS][3]) {
+    // A member is at least ageBandStarts[b] old if born on or before bornBy[b]
+    int bornBy[AGE_BANDS];
+    for (int b = 0; b < AGE_BANDS; b++) {
+        bornBy[b] = dayOnOrBefore(today.day, today.month, today.year - ageBandStarts[b]);
+    }
+
+    const MemberColumns *columns = &list->columns;
+    memset(counts, 0, AGE_BANDS * sizeof(counts[0]));
+    for (int i = 0; i < list->count; i++) {
+        if (columns->ids[i] == 0) {
+            continue;
+        }
+        int band = 0;
+        for (int b = 1; b < AGE_BANDS; b++) {
+            band += columns->birthDays[i] <= bornBy[b];
+        }
+        int gender = columns->genders[i] == 'M' ? 0 : (columns->genders[i] == 'F' ? 1 : 2);
+        counts[band][gender]++;
+    }
+}
+
+// Prints how many members there are of each gender in each age band
+void printMemberDemographics(MemberList *list, Date today) {
+    static const char *bandNames[] = {"Under 18", "18-25", "26-35", "36-50", "51-65", "Over 65"};
+    int counts[AGE_BANDS][3];
+    countMemberDemographics(list, today, counts);
+
+    int totals[3] = {0, 0, 0};
+    printf("%-10s %8s %8s %8s\n", "Age", "Male", "Female", "Total");
+    for (int b = 0; b < AGE_BANDS; b++) {
+        printf("%-10s %8d %8d %8d\n", bandNames[b], counts[b][0], counts[b][1], counts[b][0] + counts[b][1] + counts[b][2]);
+        for (int g = 0; g < 3; g++) {
+            totals[g] += counts[b][g];
+        }
+    }
+    printf("%-10s %8d %8d %8d\n", "All", totals[0], totals[1], totals[0] + totals[1] + totals[2]);
+}
+
+void searchMembers(MemberList *list) {
+    if (list->count == list->deletedCount) {
+        printf("No members found in the database.\n");
+        return;
+    }
+
+    int searchChoice;
+    printf("Search by:\n");
+    printf("1. Member ID\n");
+    printf("2. First Name\n");
+    printf("3. Last Name\n");
+    printf("4. Both First and Last Name\n");
+    printf("5. Partial or Misspelled Name\n");
+    printf("6. Emergency Contact Name\n");
+    printf("7. Text in a Member's Name\n");
+    printf("8. Text in an Emergency Contact's Name\n");
+    printf("9. Phone Number (incl. Emergency Contact)\n");
+    printf("Enter your choice (1-9): ");
+    if (scanf("%d", &searchChoice) != 1 || searchChoice < 1 || searchChoice > 9) {
+        printf("Invalid choice.\n");
+        while (getchar() != '\n');
+        return;
+    }
+    getchar(); // consume newline
+
+    switch (searchChoice) {
+        case 1: {
+            // Search by Member ID
+            printf("Enter member ID to search: ");
+            int searchID;
+            if (scanf("%d", &searchID) != 1) {
+                printf("Invalid input. Please enter a valid member ID.\n");
+                while (getchar() != '\n');
+                return;
+            }
+            getchar();
+
+            Member foundMember;
+            if (findMemberByID(list, searchID, &foundMember)) {
+                printMember(&foundMember);
+            } else {
+                printf("Member with ID %d not found.\n", searchID);
+            }
+            break;
+        }
+        case 2: {
+            // Search by First Name
+            char firstName[50];
+            printf("Enter first name to search: ");
+            fgets(firstName, sizeof(firstName), stdin);
+            firstName[strcspn(firstName, "\n")] = '\0';
+
+            int found = printMembersByName(list, firstName, NULL);
+            if (!found) {
+                printf("No members found with the first name '%s'.\n", firstName);
+            }
+            break;
+        }
+        case 3: {
+            // Search by Last Name
+            char lastName[50];
+            printf("Enter last name to search: ");
+            fgets(lastName, sizeof(lastName), stdin);
+            lastName[strcspn(lastName, "\n")] = '\0';
+
+            int found = printMembersByName(list, NULL, lastName);
+            if (!found) {
+                printf("No members found with the last name '%s'.\n", lastName);
+            }
+            break;
+        }
+        case 4: {
+            // Search by Both First and Last Name
+            char firstName[50], lastName[50];
+            printf("Enter first name to search: ");
+            fgets(firstName, sizeof(firstName), stdin);
+            firstName[strcspn(firstName, "\n")] = '\0';
+
+            printf("Enter last name to search: ");
+            fgets(lastName, sizeof(lastName), stdin);
+            lastName[strcspn(lastName, "\n")] = '\0';
+
+            int found = printMembersByName(list, firstName, lastName);
+            if (!found) {
+                printf("No members found with the name '%s %s'.\n", firstName, lastName);
+            }
+            break;
+        }
+        case 5: {
+            // Search by the start of a name, allowing for typos
+            char query[100];
+            printf("Enter part of a name to search (e.g. 'jon smi'): ");
+            fgets(query, sizeof(query), stdin);
+            query[strcspn(query, "\n")] = '\0';
+
+            if (!printFuzzyMatches(list, query)) {
+                printf("No members found with a name like '%s'.\n", query);
+            }
+            break;
+        }
+        case 6: {
+            // Search by Emergency Contact Name (not indexed, every member is checked)
+            char emergencyName[50];
+            printf("Enter emergency contact name to search: ");
+            fgets(emergencyName, sizeof(emergencyName), stdin);
+            emergencyName[strcspn(emergencyName, "\n")] = '\0';
+
+            ScanPattern pattern;
+            initScanPattern(&pattern, emergencyName, 0);
+            if (!printMembersWithEmergencyName(list, &pattern)) {
+                printf("No members found with the emergency contact '%s'.\n", emergencyName);
+            }
+            break;
+        }
+        case 7:
+        case 8: {
+            // Search for text within the first or last name, or within the emergency contact name
+            char text[50];
+            printf("Enter text to search for: ");
+            fgets(text, sizeof(text), stdin);
+            text[strcspn(text, "\n")] = '\0';
+
+            ScanPattern pattern;
+            initScanPattern(&pattern, text, 1);
+            int found = searchChoice == 7 ? printMembersWithName(list, &pattern) : printMembersWithEmergencyName(list, &pattern);
+            if (!found) {
+                printf("No members found with '%s' in %s.\n", text, searchChoice == 7 ? "their name" : "their emergency contact's name");
+            }
+            break;
+        }
+        case 9: {
+            // Search by Phone Number, both the member's own and as an emergency contact
+            char phone[20];
+            printf("Enter phone number to search: ");
+            fgets(phone, sizeof(phone), stdin);
+            phone[strcspn(phone, "\n")] = '\0';
+
+            uint64_t key = phoneKey(phone);
+            const int *ids;
+            int count = multimapGet(&list->phoneIndex, key, &ids);
+            for (int i = 0; i < count; i++) {
+                printMemberByID(list, ids[i]);
+            }
+            if (count == 0) {
+                printf("No members found with the phone number '%s'.\n", phone);
+            }
+
+            int contacts = multimapGet(&list->emergencyPhoneIndex, key, &ids);
+            if (contacts > 0) {
+                printf("Members listing this number as their emergency contact:\n");
+            }
+            for (int i = 0; i < contacts; i++) {
+                printMemberByID(list, ids[i]);
+            }
+            break;
+        }
+        default:
+            printf("Invalid choice.\n");
+    }
+}
+
+// The equipment in a slot (deleted if its id is 0)
+Equipment* equipmentAt(const EquipmentList *list, int slot){
+    return segmentRecord(&list->store, slot);
+}
+
+StatusChange* statusChangeAt(const StatusHistory *history, int position){
+    return segmentRecord(&history->store, position);
+}
+
+// Returns the aggregates of an equipment, or NULL if it has no changes yet and 'create' is 0
+StatusStats* statusStatsFor(StatusHistory *history, int equipmentID, int create){
+    int position = idIndexGet(&history->statsIndex, equipmentID);
+    if (position != -1) {
+        return &history->stats[position];
+    }
+    if (!create) {
+        return NULL;
+    }
+    if (history->statsCount == history->statsCapacity) {
+        history->statsCapacity = history->statsCapacity > 0 ? history->statsCapacity * 2 : 64;
+        history->stats = realloc(history->stats, (size_t)history->statsCapacity * sizeof(StatusStats));
+        if (history->stats == NULL) {
+            printf("Memory allocation failed!\n");
+            exit(1);
+        }
+    }
+    position = history->statsCount++;
+    memset(&history->stats[position], 0, sizeof(StatusStats));
+    history->stats[position].equipmentID = equipmentID;
+    history->stats[position].promisedDay = -1;
+    idIndexPut(&history->statsIndex, equipmentID, position);
+    return &history->stats[position];
+}
+
+// Folds one change into an equipment's aggregates. A new ETA for a repair in progress is kept in
+// the time series, but the ETA accuracy is judged against the one given when the repair started.
+void applyStatusChange(StatusStats *stats, const StatusChange *change){
+    if (stats->firstSeen == 0) {
+        stats->firstSeen = change->changedAt;
+    }
+    if (change->status == EQUIPMENT_UNDER_MAINTENANCE) {
+        if (stats->downSince == 0) {
+            stats->failures++;
+            stats->downSince = change->changedAt;
+            stats->promisedDay = change->repairETADay;
+        }
+    } else if (stats->downSince != 0) {
+        stats->repairs++;
+        if (change->changedAt > stats->downSince) {
+            stats->downSeconds += change->changedAt - stats->downSince; // Not negative if the clock was set back
+        }
+        if (stats->promisedDay >= 0) {
+            int late = localDayNumber((time_t)change->changedAt) - stats->promisedDay;
+            stats->estimatedRepairs++;
+            stats->daysLate += late;
+            if (late <= 0) {
+                stats->onTimeRepairs++;
+            }
+        }
+        stats->downSince = 0;
+        stats->promisedDay = -1;
+    }
+}
+
+// Appends a change to the time series in memory and updates its equipment's aggregates
+void addStatusChange(StatusHistory *history, const StatusChange *change){
+    if (history->count == segmentStoreCapacity(&history->store)) {
+        segmentStoreReserve(&history->store, history->count + 1);
+    }
+    *statusChangeAt(history, history->count) = *change;
+    multimapAdd(&history->byEquipment, (uint64_t)(uint32_t)change->equipmentID, history->count);
+    history->count++;
+    applyStatusChange(statusStatsFor(history, change->equipmentID, 1), change);
+}
+
+// Records the status an equipment has just been given. The record is synced together with the
+// equipment log, by commitEquipmentLog or the server's group commit.
+void recordStatusChange(StatusHistory *history, const Equipment *equipment){
+    StatusChange change;
+    change.equipmentID = equipment->id;
+    change.changedAt = (uint32_t)time(NULL);
+    change.status = equipment->status;
+    change.repairETADay = equipment->status == EQUIPMENT_UNDER_MAINTENANCE ? dayNumber(equipment->repairETA) : -1;
+    addStatusChange(history, &change);
+    walAppendRecord(&history->log, WAL_STATUS_CHANGE, &statusChangeSchema, &change);
+    history->unsynced++;
+}
+
+// Syncs the status changes recorded since the last commit, if there are any
+void commitStatusLog(StatusHistory *history){
+    if (history->unsynced > 0) {
+        walCommit(&history->log);
+        history->unsynced = 0;
+    }
+}
+
+void repairScheduleInit(RepairSchedule *schedule) {
+    schedule->timers = NULL;
+    schedule->count = 0;
+    schedule->capacity = 0;
+    idIndexInit(&schedule->positions, 0);
+}
+
+// Puts a timer at heap index 'at' and records where it is
+void repairSchedulePlace(RepairSchedule *schedule, int at, RepairTimer timer) {
+    schedule->timers[at] = timer;
+    idIndexPut(&schedule->positions, timer.equipmentID, at);
+}
+
+int repairTimerBefore(RepairTimer a, RepairTimer b) {
+    return a.etaDay < b.etaDay || (a.etaDay == b.etaDay && a.equipmentID < b.equipmentID);
+}
+
+// Moves the timer at 'at' up or down until the heap is in order again
+void repairScheduleFix(RepairSchedule *schedule, int at) {
+    RepairTimer timer = schedule->timers[at];
+    while (at > 0 && repairTimerBefore(timer, schedule->timers[(at - 1) / 2])) {
+        repairSchedulePlace(schedule, at, schedule->timers[(at - 1) / 2]);
+        at = (at - 1) / 2;
+    }
+    while (1) {
+        int child = 2 * at + 1;
+        if (child >= schedule->count) {
+            break;
+        }
+        if (child + 1 < schedule->count && repairTimerBefore(schedule->timers[child + 1], schedule->timers[child])) {
+            child++;
+        }
+        if (!repairTimerBefore(schedule->timers[child], timer)) {
+            break;
+        }
+        repairSchedulePlace(schedule, at, schedule->timers[child]);
+        at = child;
+    }
+    repairSchedulePlace(schedule, at, timer);
+}
+
+// Removes an equipment's timer, if it has one
+void unscheduleRepair(RepairSchedule *schedule, int equipmentID) {
+    int at = idIndexGet(&schedule->positions, equipmentID);
+    if (at == -1) {
+        return;
+    }
+    idIndexRemove(&schedule->positions, equipmentID);
+    schedule->count--;
+    if (at < schedule->count) {
+        schedule->timers[at] = schedule->timers[schedule->count];
+        repairScheduleFix(schedule, at);
+    }
+}
+
+// Sets an equipment's timer to its repair ETA, or removes it if the equipment is not waiting for
+// a repair. O(log n) in the number of repairs in progress.
+void scheduleRepair(RepairSchedule *schedule, const Equipment *equipment) {
+    int etaDay = equipment->status == EQUIPMENT_UNDER_MAINTENANCE ? dayNumber(equipment->repairETA) : -1;
+    if (etaDay == -1) {
+        unscheduleRepair(schedule, equipment->id);
+        return;
+    }
+    RepairTimer timer = { etaDay, equipment->id };
+    int at = idIndexGet(&schedule->positions, equipment->id);
+    if (at == -1) {
+        if (schedule->count == schedule->capacity) {
+            schedule->capacity = schedule->capacity > 0 ? schedule->capacity * 2 : 64;
+            schedule->timers = realloc(schedule->timers, (size_t)schedule->capacity * sizeof(RepairTimer));
+            if (schedule->timers == NULL) {
+                printf("Memory allocation failed!\n");
+                exit(1);
+            }
+        }
+        at = schedule->count++;
+    }
+    schedule->timers[at] = timer;
+    repairScheduleFix(schedule, at);
+}
+
+void repairScheduleFree(RepairSchedule *schedule) {
+    free(schedule->timers);
+    idIndexFree(&schedule->positions);
+}
+
+// Adds (sign 1) or takes away (sign -1) an equipment's quantities in the running totals
+void countEquipment(EquipmentTotals *totals, const Equipment *equipment, int sign){
+    totals->totalQuantity += sign * equipment->totalQuantity;
+    totals->functional += sign * equipment->functional;
+    totals->broken += sign * equipment->broken;
+}
+
+void addEquipment(EquipmentList *list, Equipment *equipment){
+    // Check if list is full, and add a segment if so
+    if(list->count == segmentStoreCapacity(&list->store)){
+        segmentStoreReserve(&list->store, list->count + 1);
+    }
+
+    *equipmentAt(list, list->count) = *equipment;
+    countEquipment(&list->totals, equipment, 1);
+    if (list->statusHistory.recording) {
+        recordStatusChange(&list->statusHistory, equipment);
+    }
+    scheduleRepair(&list->schedule, equipment);
+    idIndexPut(&list->idIndex, equipment->id, list->count);
+    handleAttach(&list->handles, list->count);
+    markDirty(&list->dirty, list->count);
+    list->count++;
+
+    walAppendRecord(&list->log, WAL_EQUIPMENT_PUT, &equipmentSchema, equipment);
+}
+
+// Returns the position of the equipment in the list, or -1 if not found
+int findEquipmentIndex(EquipmentList *list, int equipmentID){
+    return idIndexGet(&list->idIndex, equipmentID);
+}
+
+// Returns a handle to the equipment, or a null handle if there is no such equipment
+RecordHandle findEquipmentHandle(EquipmentList *list, int equipmentID){
+    return handleAt(&list->handles, findEquipmentIndex(list, equipmentID));
+}
+
+// Returns the equipment a handle refers to, or NULL if it has been deleted. The pointer is only
+// valid until the list is next compacted.
+Equipment* resolveEquipment(EquipmentList *list, RecordHandle handle){
+    int slot = handleSlot(&list->handles, handle);
+    return slot != -1 ? equipmentAt(list, slot) : NULL;
+}
+
+// Deletes the equipment in a slot by clearing its id; the slot is reclaimed by compactEquipment
+void removeEquipmentAt(EquipmentList *list, int foundIndex){
+    countEquipment(&list->totals, equipmentAt(list, foundIndex), -1);
+    unscheduleRepair(&list->schedule, equipmentAt(list, foundIndex)->id);
+    idIndexRemove(&list->idIndex, equipmentAt(list, foundIndex)->id);
+    handleDetach(&list->handles, foundIndex);
+    equipmentAt(list, foundIndex)->id = 0;
+    list->deletedCount++;
+    markDirty(&list->dirty, foundIndex);
+}
+
+// Slides the remaining equipment over the deleted slots, keeping their order
+void compactEquipment(EquipmentList *list){
+    int live = 0;
+    int firstMoved = -1;
+    for (int i = 0; i < list->count; i++) {
+        if (equipmentAt(list, i)->id == 0) {
+            continue;
+        }
+        if (i != live) {
+            if (firstMoved == -1) {
+                firstMoved = live;
+            }
+            *equipmentAt(list, live) = *equipmentAt(list, i);
+            idIndexPut(&list->idIndex, equipmentAt(list, live)->id, live);
+            handleMove(&list->handles, i, live);
+        }
+        live++;
+    }
+    if (firstMoved != -1) {
+        markDirtyRange(&list->dirty, firstMoved, live - 1);
+    }
+    list->count = live;
+    list->deletedCount = 0;
+    segmentStoreTrim(&list->store, list->count);
+}
+
+// Replaces the equipment in a slot with an edited copy, then logs it and marks it for saving
+void updateEquipment(EquipmentList *list, int slot, const Equipment *equipment){
+    const Equipment *previous = equipmentAt(list, slot);
+    if (list->statusHistory.recording && (previous->status != equipment->status ||
+        (equipment->status == EQUIPMENT_UNDER_MAINTENANCE && compareDates(previous->repairETA, equipment->repairETA) != 0))) {
+        recordStatusChange(&list->statusHistory, equipment);
+    }
+    countEquipment(&list->totals, previous, -1);
+    *equipmentAt(list, slot) = *equipment;
+    countEquipment(&list->totals, equipment, 1);
+    scheduleRepair(&list->schedule, equipment);
+    markDirty(&list->dirty, slot);
+    walAppendRecord(&list->log, WAL_EQUIPMENT_PUT, &equipmentSchema, equipment);
+}
+
+// Makes the equipment whose repair ETA is before 'today' Operational again, taking the timers off
+// the top of the schedule, and prints each one if 'announce' is set. Returns the number restored.
+int restoreOverdueEquipment(EquipmentList *list, Date today, int announce){
+    int todayNumber = dayNumber(today);
+    int restored = 0;
+    while (list->schedule.count > 0 && list->schedule.timers[0].etaDay < todayNumber) {
+        RepairTimer due = list->schedule.timers[0];
+        int slot = findEquipmentIndex(list, due.equipmentID);
+        if (slot == -1) {
+            unscheduleRepair(&list->schedule, due.equipmentID); // Not expected, deletes remove the timer
+            continue;
+        }
+        Equipment equipment = *equipmentAt(list, slot);
+        equipment.status = EQUIPMENT_OPERATIONAL;
+        equipment.repairETA.day = 0;
+        equipment.repairETA.month = 0;
+        equipment.repairETA.year = 0;
+        updateEquipment(list, slot, &equipment); // Also removes the timer
+        if (announce) {
+            Date eta = dateFromDayNumber(due.etaDay);
+            printf("Equipment %d (%s) is Operational again: its repair ETA %02d/%02d/%04d has passed.\n",
+                equipment.id, equipment.name, eta.day, eta.month, eta.year);
+        }
+        restored++;
+    }
+    return restored;
+}
+
+int compareRepairTimers(const void *a, const void *b){
+    const RepairTimer *x = a, *y = b;
+    return repairTimerBefore(*x, *y) ? -1 : (repairTimerBefore(*y, *x) ? 1 : 0);
+}
+
+// Lists the equipment still under maintenance after its repair ETA, earliest ETA first. Only the
+// overdue timers and their direct children are visited: below a timer that is not overdue, no
+// timer in the heap is either. Returns the number listed.
+int printOverdueRepairs(EquipmentList *list, Date today){
+    int todayNumber = dayNumber(today);
+    RepairSchedule *schedule = &list->schedule;
+    if (schedule->count == 0 || schedule->timers[0].etaDay >= todayNumber) {
+        return 0;
+    }
+    int *pending = malloc((size_t)schedule->count * sizeof(int)); // Heap indexes still to visit
+    RepairTimer *overdue = malloc((size_t)schedule->count * sizeof(RepairTimer));
+    if (pending == NULL || overdue == NULL) {
+        printf("Memory allocation failed!\n");
+        exit(1);
+    }
+    int pendingCount = 0, overdueCount = 0;
+    pending[pendingCount++] = 0;
+    while (pendingCount > 0) {
+        int at = pending[--pendingCount];
+        if (schedule->timers[at].etaDay >= todayNumber) {
+            continue;
+        }
+        overdue[overdueCount++] = schedule->timers[at];
+        // Only indexes inside the heap are pushed, each once, so 'pending' never holds more than count
+        for (int child = 2 * at + 1; child <= 2 * at + 2 && child < schedule->count; child++) {
+            pending[pendingCount++] = child;
+        }
+    }
+    qsort(overdue, (size_t)overdueCount, sizeof(RepairTimer), compareRepairTimers);
+
+    printf("Overdue repairs (still under maintenance after their ETA):\n");
+    for (int i = 0; i < overdueCount; i++) {
+        const Equipment *equipment = equipmentAt(list, findEquipmentIndex(list, overdue[i].equipmentID));
+        Date eta = dateFromDayNumber(overdue[i].etaDay);
+        printf("  ID %d %s: %d broken, ETA %02d/%02d/%04d, %d days overdue\n", equipment->id, equipment->name,
+            equipment->broken, eta.day, eta.month, eta.year, todayNumber - overdue[i].etaDay);
+    }
+    free(overdue);
+    free(pending);
+    return overdueCount;
+}
+
+void deleteEquipment(EquipmentList *list, int equipmentID){
+    int foundIndex = findEquipmentIndex(list, equipmentID);
+
+    // Equipment not found if foundIndex = -1
+    if (foundIndex == -1){
+        printf("Equipment with ID %d not found.\n", equipmentID);
+        return;
+    }
+
+    removeEquipmentAt(list, foundIndex);
+
+    walAppend(&list->log, WAL_EQUIPMENT_DELETE, &equipmentID, sizeof(equipmentID));
+}
+
+// Prompts for a new status and writes it to the equipment through its handle. The prompts work on a
+// copy, since the list may change while they wait for input.
+void updateEquipmentStatus(EquipmentList *list, RecordHandle handle) {
+    Equipment *stored = resolveEquipment(list, handle);
+    if (stored == NULL) {
+        printf("Equipment not found.\n");
+        return;
+    }
+    Equipment edited = *stored;
+    Equipment *equipment = &edited;
+    printf("Current status: %s\n", equipmentStatusNames[equipment->status]);
+
+    // Get the current date
+    Date currentDate = getCurrentDate();
+
+    // Present a menu for status selection
+    int statusChoice;
+    while (1) {
+        printf("Select new status:\n");
+        printf("1. Operational\n");
+        printf("2. Under Maintenance\n");
+        printf("Choose an option (1-2): ");
+        if (scanf("%d", &statusChoice) != 1) {
+            printf("Invalid input. Please enter 1 or 2.\n");
+            while (getchar() != '\n');
+            continue;
+        }
+        getchar(); // Consume newline
+
+        if (statusChoice == 1 || statusChoice == 2) {
+            break;
+        } else {
+            printf("Invalid choice. Please select 1 or 2.\n");
+        }
+    }
+
+    if (statusChoice == 1) {
+        equipment->status = EQUIPMENT_OPERATIONAL;
+        // Set repairETA to 0
+        equipment->repairETA.day = 0;
+        equipment->repairETA.month = 0;
+        equipment->repairETA.year = 0;
+    } else {
+        equipment->status = EQUIPMENT_UNDER_MAINTENANCE;
+
+        while (1) { // Loop until a valid date is entered
+            printf("Enter the repair ETA (dd mm yyyy): ");
+            int day, month, year;
+            if (scanf("%d %d %d", &day, &month, &year) != 3) {
+                printf("Error: Invalid date format. Please enter the day, month, and year as integers.\n");
+                // Clear the input buffer in the event of an invalid entry
+                while (getchar() != '\n'); // Discard invalid input
+                continue; // Re-prompt user
+            }
+            getchar();
+
+            // Validate the date
+            if (!isValidDate(day, month, year)) {
+                printf("Error: Invalid date entered. Please enter a valid date.\n");
+                continue;
+            }
+
+            Date repairETA = { day, month, year };
+
+            int cmpResult = compareDates(repairETA, currentDate);
+            if (cmpResult < 0) {
+                printf("Error: Repair ETA cannot be in the past.\n");
+            } else {
+                // Update the repair ETA date
+                equipment->repairETA.day = day;
+                equipment->repairETA.month = month;
+                equipment->repairETA.year = year;
+                break; // Exit the loop if the date is valid
+            }
+        }
+    }
+
+    int slot = handleSlot(&list->handles, handle);
+    if (slot == -1) {
+        printf("The equipment was deleted before the update could be saved.\n");
+        return;
+    }
+    updateEquipment(list, slot, &edited);
+
+    printf("The equipment status has been successfully updated.\n");
+}
+
+// Fills in the summary from the totals
+void summarizeReport(Report *report){
+    snprintf(report->summary, sizeof(report->summary),
+        "Total Equipment: %d\nFunctional Equipment: %d\nBroken Equipment: %d\n",
+        report->total_equipment_count,
+        report->total_functional_equipment,
+        report->total_broken_equipment);
+}
+
+// Sums the live equipment the slow way, to check the running totals against
+void recountEquipment(const EquipmentList *list, EquipmentTotals *totals){
+    memset(totals, 0, sizeof(*totals));
+    for(int i = 0; i < list->count; i++){
+        if (equipmentAt(list, i)->id != 0) {
+            countEquipment(totals, equipmentAt(list, i), 1);
+        }
+    }
+}
+
+// Fills in the report without printing it. The totals are the running ones, so this does not
+// depend on the size of the list.
+void computeReport(EquipmentList *list, Report *report){
+    EquipmentTotals totals = list->totals;
+    if (checkEquipmentTotals) {
+        EquipmentTotals recount;
+        recountEquipment(list, &recount);
+        if (memcmp(&recount, &totals, sizeof(totals)) != 0) {
+            printf("Error: running equipment totals %d/%d/%d differ from a recount %d/%d/%d, reporting the recount.\n",
+                totals.totalQuantity, totals.functional, totals.broken,
+                recount.totalQuantity, recount.functional, recount.broken);
+            totals = recount;
+        }
+    }
+    report->report_ID = 0;
+    report->total_equipment_count = totals.totalQuantity;
+    report->total_functional_equipment = totals.functional;
+    report->total_broken_equipment = totals.broken;
+
+    // Set report date to current live date
+    report->report_date = getCurrentDate();
+    summarizeReport(report);
+}
+
+void printReport(const Report *report){
+    if (report->report_ID != 0) {
+        printf("Report ID: %d\n", report->report_ID);
+    }
+    printf("Report Date: %02d/%02d/%04d\n", report->report_date.day, report->report_date.month, report->report_date.year);
+    printf("%s", report->summary);
+}
+
+StoredReport* reportAt(const ReportHistory *history, int position){
+    return segmentRecord(&history->store, position);
+}
+
+void unpackReport(const StoredReport *stored, Report *report){
+    report->report_ID = stored->reportID;
+    report->report_date = dateFromDayNumber(stored->reportDay);
+    report->total_equipment_count = stored->totalEquipment;
+    report->total_functional_equipment = stored->functional;
+    report->total_broken_equipment = stored->broken;
+    summarizeReport(report);
+}
+
+// Returns the first place in byDate whose report is from 'day' or later
+int firstReportOnOrAfter(const ReportHistory *history, int day){
+    int low = 0, high = history->count;
+    while (low < high) {
+        int middle = low + (high - low) / 2;
+        if (reportAt(history, history->byDate[middle])->reportDay < day) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+// Appends a report to the history in memory and indexes it
+void addReport(ReportHistory *history, const StoredReport *stored){
+    if (history->count == segmentStoreCapacity(&history->store)) {
+        segmentStoreReserve(&history->store, history->count + 1);
+    }
+    if (history->count == history->byDateCapacity) {
+        history->byDateCapacity = history->byDateCapacity > 0 ? history->byDateCapacity * 2 : 1024;
+        history->byDate = realloc(history->byDate, (size_t)history->byDateCapacity * sizeof(int));
+        if (history->byDate == NULL) {
+            printf("Memory allocation failed!\n");
+            exit(1);
+        }
+    }
+    int position = history->count;
+    *reportAt(history, position) = *stored;
+    idIndexPut(&history->idIndex, stored->reportID, position);
+
+    // Reports normally arrive in date order and go at the end; one made after the clock was set
+    // back is moved in after the reports of its day
+    int place = position;
+    if (place > 0 && reportAt(history, history->byDate[place - 1])->reportDay > stored->reportDay) {
+        place = firstReportOnOrAfter(history, stored->reportDay + 1);
+        memmove(history->byDate + place + 1, history->byDate + place, (size_t)(position - place) * sizeof(int));
+    }
+    history->byDate[place] = position;
+    history->count++;
+    if (stored->reportID >= history->nextReportID) {
+        history->nextReportID = stored->reportID + 1;
+    }
+}
+
+// Gives the report the next report ID and appends it to the history and to reports.log
+void recordReport(ReportHistory *history, Report *report){
+    StoredReport stored;
+    stored.reportID = history->nextReportID;
+    stored.reportDay = dayNumber(report->report_date);
+    stored.totalEquipment = report->total_equipment_count;
+    stored.functional = report->total_functional_equipment;
+    stored.broken = report->total_broken_equipment;
+    addReport(history, &stored);
+    report->report_ID = stored.reportID;
+
+    walAppendRecord(&history->log, WAL_REPORT, &reportSchema, &stored);
+    walCommit(&history->log);
+}
+
+// Looks up a past report. Returns 0 if there is no report with that ID.
+int findReport(const ReportHistory *history, int reportID, Report *report){
+    int position = idIndexGet(&history->idIndex, reportID);
+    if (position == -1) {
+        return 0;
+    }
+    unpackReport(reportAt(history, position), report);
+    return 1;
+}
+
+// Prints the reports made from 'from' to 'to', oldest first. Returns the number printed.
+int printReportsBetween(const ReportHistory *history, Date from, Date to){
+    int last = dayNumber(to);
+    int printed = 0;
+    for (int i = firstReportOnOrAfter(history, dayNumber(from)); i < history->count; i++) {
+        const StoredReport *stored = reportAt(history, history->byDate[i]);
+        if (stored->reportDay > last) {
+            break;
+        }
+        Report report;
+        unpackReport(stored, &report);
+        printf("------------------------------------------\n");
+        printReport(&report);
+        printed++;
+    }
+    return printed;
+}
+
+// Generates a report without displaying it, adding it to 'history' unless that is NULL
+void buildReport(EquipmentList *list, ReportHistory *history, Report *report){
+    computeReport(list, report);
+    if (history != NULL) {
+        recordReport(history, report);
+    }
+}
+
+// Generates and displays a report, listing the equipment past its repair ETA after it. With
+// --auto-restore, that equipment is restored and the restores are committed first.
+void generateReport(EquipmentList *list, ReportHistory *history, Report *report){
+    if (autoRestoreEquipment && restoreOverdueEquipment(list, getCurrentDate(), 1) > 0) {
+        syncEquipmentLog(list);
+    }
+    buildReport(list, history, report);
+    printReport(report);
+    printOverdueRepairs(list, report->report_date);
+}
+
+// Opens 'path' for an export, allocating the shared output buffer on first use
+int openExport(OutputBuffer *out, const char *path) {
+    if (exportBuffer == NULL) {
+        exportBuffer = malloc(EXPORT_BUFFER_SIZE);
+        if (exportBuffer == NULL) {
+            printf("Memory allocation failed!\n");
+            exit(1);
+        }
+    }
+    out->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    out->data = exportBuffer;
+    out->used = 0;
+    out->failed = 0;
+    if (out->fd < 0) {
+        printf("Error: could not create %s.\n", path);
+        return 0;
+    }
+    return 1;
+}
+
+// Returns 1 if everything reached the file
+int closeExport(OutputBuffer *out, const char *path) {
+    outputFlush(out);
+    if (close(out->fd) != 0) {
+        out->failed = 1;
+    }
+    if (out->failed) {
+        printf("Error writing %s.\n", path);
+    }
+    return !out->failed;
+}
+
+// Appends a member as a CSV record in the export column order, without the line break
+void outputMemberCsv(OutputBuffer *out, const Member *member) {
+    outputInt(out, member->memberID);
+    outputChar(out, ',');
+    outputCsvField(out, member->firstName, sizeof(member->firstName));
+    outputChar(out, ',');
+    outputCsvField(out, member->lastName, sizeof(member->lastName));
+    outputChar(out, ',');
+    outputCsvField(out, member->phoneNum, sizeof(member->phoneNum));
+    outputChar(out, ',');
+    outputCsvField(out, &member->gender, 1);
+    outputChar(out, ',');
+    outputCsvField(out, member->emergencyName, sizeof(member->emergencyName));
+    outputChar(out, ',');
+    outputCsvField(out, member->emergencyPhone, sizeof(member->emergencyPhone));
+    outputChar(out, ',');
+    outputCsvField(out, member->emergencyRelation, sizeof(member->emergencyRelation));
+    outputChar(out, ',');
+    outputDate(out, member->dob);
+}
+
+// Appends equipment as a CSV record in the export column order, without the line break
+void outputEquipmentCsv(OutputBuffer *out, const Equipment *equipment) {
+    outputInt(out, equipment->id);
+    outputChar(out, ',');
+    outputCsvField(out, equipment->name, sizeof(equipment->name));
+    outputChar(out, ',');
+    outputInt(out, equipment->totalQuantity);
+    outputChar(out, ',');
+    outputInt(out, equipment->functional);
+    outputChar(out, ',');
+    outputInt(out, equipment->broken);
+    outputChar(out, ',');
+    outputCsvField(out, equipmentStatusNames[equipment->status], strlen(equipmentStatusNames[equipment->status]));
+    outputChar(out, ',');
+    if (equipment->repairETA.day != 0) {
+        outputDate(out, equipment->repairETA);
+    }
+}
+
+// Writes every member to 'path' as CSV (with a header line) or as one JSON object per line
+int exportMembers(const MemberList *list, const char *path, ExportFormat format) {
+    OutputBuffer out;
+    if (!openExport(&out, path)) {
+        return 0;
+    }
+
+    if (format == EXPORT_CSV) {
+        outputText(&out, "memberID,firstName,lastName,phone,gender,emergencyName,emergencyPhone,emergencyRelation,dob\n");
+    }
+    for (int i = 0; i < list->count; i++) {
+        if (packedMemberAt(list, i)->memberID == 0) {
+            continue;
+        }
+        Member unpacked;
+        const Member *member = &unpacked;
+        readMember(list, i, &unpacked);
+        outputReserveRecord(&out);
+        if (format == EXPORT_CSV) {
+            outputMemberCsv(&out, member);
+            outputChar(&out, '\n');
+        } else {
+            outputText(&out, "{\"memberID\":");
+            outputInt(&out, member->memberID);
+            outputText(&out, ",\"firstName\":");
+            outputJsonString(&out, member->firstName, sizeof(member->firstName));
+            outputText(&out, ",\"lastName\":");
+            outputJsonString(&out, member->lastName, sizeof(member->lastName));
+            outputText(&out, ",\"phone\":");
+            outputJsonString(&out, member->phoneNum, sizeof(member->phoneNum));
+            outputText(&out, ",\"gender\":");
+            outputJsonString(&out, &member->gender, 1);
+            outputText(&out, ",\"emergencyName\":");
+            outputJsonString(&out, member->emergencyName, sizeof(member->emergencyName));
+            outputText(&out, ",\"emergencyPhone\":");
+            outputJsonString(&out, member->emergencyPhone, sizeof(member->emergencyPhone));
+            outputText(&out, ",\"emergencyRelation\":");
+            outputJsonString(&out, member->emergencyRelation, sizeof(member->emergencyRelation));
+            outputText(&out, ",\"dob\":\"");
+            outputDate(&out, member->dob);
+            outputText(&out, "\"}\n");
+        }
+    }
+    return closeExport(&out, path);
+}
+
+// Writes every equipment entry to 'path'; the repair ETA is left empty (null in JSON) when there is none
+int exportEquipment(const EquipmentList *list, const char *path, ExportFormat format) {
+    OutputBuffer out;
+    if (!openExport(&out, path)) {
+        return 0;
+    }
+
+    if (format == EXPORT_CSV) {
+        outputText(&out, "id,name,totalQuantity,functional,broken,status,repairETA\n");
+    }
+    for (int i = 0; i < list->count; i++) {
+        const Equipment *equipment = equipmentAt(list, i);
+        if (equipment->id == 0) {
+            continue;
+        }
+        int hasRepairETA = equipment->repairETA.day != 0;
+        outputReserveRecord(&out);
+        if (format == EXPORT_CSV) {
+            outputEquipmentCsv(&out, equipment);
+            outputChar(&out, '\n');
+        } else {
+            outputText(&out, "{\"id\":");
+            outputInt(&out, equipment->id);
+            outputText(&out, ",\"name\":");
+            outputJsonString(&out, equipment->name, sizeof(equipment->name));
+            outputText(&out, ",\"totalQuantity\":");
+            outputInt(&out, equipment->totalQuantity);
+            outputText(&out, ",\"functional\":");
+            outputInt(&out, equipment->functional);
+            outputText(&out, ",\"broken\":");
+            outputInt(&out, equipment->broken);
+            outputText(&out, ",\"status\":");
+            outputJsonString(&out, equipmentStatusNames[equipment->status], strlen(equipmentStatusNames[equipment->status]));
+            if (hasRepairETA) {
+                outputText(&out, ",\"repairETA\":\"");
+                outputDate(&out, equipment->repairETA);
+                outputText(&out, "\"}\n");
+            } else {
+                outputText(&out, ",\"repairETA\":null}\n");
+            }
+        }
+    }
+    return closeExport(&out, path);
+}
+
+// Asks for the export format and file name. Returns 0 if the input was invalid.
+int promptExport(ExportFormat *format, char *path, size_t pathSize) {
+    int choice;
+    printf("Export format:\n");
+    printf("1. CSV\n");
+    printf("2. JSON Lines\n");
+    printf("Enter your choice (1-2): ");
+    if (scanf("%d", &choice) != 1 || (choice != 1 && choice != 2)) {
+        printf("Invalid input. Please enter 1 or 2.\n");
+        while (getchar() != '\n');
+        return 0;
+    }
+    getchar();
+    *format = choice == 1 ? EXPORT_CSV : EXPORT_JSON_LINES;
+
+    printf("Enter the path of the export file: ");
+    fgets(path, pathSize, stdin);
+    path[strcspn(path, "\n")] = '\0'; // remove newline
+    if (strlen(path) == 0) {
+        printf("File name cannot be empty.\n");
+        return 0;
+    }
+    return 1;
+}
+
+// Picks up the result of a background snapshot. On success the log up to the copy is dropped;
+// on failure the next save rewrites the whole file.
+void collectMemberSnapshot(MemberList *list, int wait){
+    int result = finishSnapshot(&list->snapshot, wait);
+    if (result == 1){
+        list->persistedCount = list->snapshot.count;
+        walDiscardPrefix(&list->log, list->snapshot.logBoundary, list->snapshot.loggedRecords);
+    } else if (result == 0){
+        printf("Error: background save of %s failed, it will be retried.\n", list->snapshot.filename);
+        list->persistedCount = -1;
+    }
+}
+
+void collectEquipmentSnapshot(EquipmentList *list, int wait){
+    int result = finishSnapshot(&list->snapshot, wait);
+    if (result == 1){
+        list->persistedCount = list->snapshot.count;
+        walDiscardPrefix(&list->log, list->snapshot.logBoundary, list->snapshot.loggedRecords);
+    } else if (result == 0){
+        printf("Error: background save of %s failed, it will be retried.\n", list->snapshot.filename);
+        list->persistedCount = -1;
+    }
+}
+
+// Saves in the foreground and empties the log, used on exit
+void checkpointMembers(MemberList *list){
+    walCommit(&list->log);
+    collectMemberSnapshot(list, 1);
+    if (saveMembersToFile(list, list->log.snapshotPath)){
+        walReset(&list->log);
+    }
+}
+
+void checkpointEquipment(EquipmentList *list){
+    walCommit(&list->log);
+    collectEquipmentSnapshot(list, 1);
+    if (saveEquipmentToFile(list, list->log.snapshotPath)){
+        walReset(&list->log);
+    }
+}
+
+// Compacts away deleted slots once there are enough of them, then hands a copy of the list to the
+// background worker once enough changes have accumulated. The copy's changes count as saved from
+// here on; if the snapshot fails, the next save rewrites the whole file. Runs after the log is
+// committed.
+void maintainMembers(MemberList *list){
+    if (shouldCompact(list->deletedCount, list->count)){
+        compactMembers(list); // Between menu actions, so a delete itself never moves records
+    }
+    collectMemberSnapshot(list, 0);
+
+    if (list->snapshot.state != SNAPSHOT_IDLE ||
+        !isSnapshotDue(&list->snapshot, &list->dirty, list->persistedCount, list->log.loggedRecords)){
+        return;
+    }
+    if (list->snapshot.worker == NULL){
+        checkpointMembers(list);
+        return;
+    }
+    off_t logBoundary = list->log.fd >= 0 ? lseek(list->log.fd, 0, SEEK_END) : 0;
+    queueSnapshot(&list->snapshot, list->log.snapshotPath, &packedMemberSchema, &list->store, list->count,
+                  list->names.bytes, list->names.used, logBoundary, list->log.loggedRecords);
+    clearDirty(&list->dirty);
+}
+
+// Makes the mutations of the last menu action durable, then compacts and snapshots the list
+void commitMemberLog(MemberList *list){
+    walCommit(&list->log);
+    maintainMembers(list);
+}
+
+// Same as maintainMembers, for equipment
+void maintainEquipment(EquipmentList *list){
+    if (shouldCompact(list->deletedCount, list->count)){
+        compactEquipment(list); // Between menu actions, so a delete itself never moves records
+    }
+    collectEquipmentSnapshot(list, 0);
+
+    if (list->snapshot.state != SNAPSHOT_IDLE ||
+        !isSnapshotDue(&list->snapshot, &list->dirty, list->persistedCount, list->log.loggedRecords)){
+        return;
+    }
+    if (list->snapshot.worker == NULL){
+        checkpointEquipment(list);
+        return;
+    }
+    off_t logBoundary = list->log.fd >= 0 ? lseek(list->log.fd, 0, SEEK_END) : 0;
+    queueSnapshot(&list->snapshot, list->log.snapshotPath, &equipmentSchema, &list->store, list->count, NULL, 0,
+                  logBoundary, list->log.loggedRecords);
+    clearDirty(&list->dirty);
+}
+
+// Makes the staged mutations and the status changes they made durable, then compacts and
+// snapshots the list
+void syncEquipmentLog(EquipmentList *list){
+    walCommit(&list->log);
+    commitStatusLog(&list->statusHistory);
+    maintainEquipment(list);
+}
+
+// Commits the mutations of the last menu action. With --auto-restore, overdue equipment is
+// restored and announced first, so the restores are committed with them.
+void commitEquipmentLog(EquipmentList *list){
+    if (autoRestoreEquipment) {
+        restoreOverdueEquipment(list, getCurrentDate(), 1);
+    }
+    syncEquipmentLog(list);
+}
+
+// Copies one CSV field into 'target' (at most size-1 characters). Fields may be wrapped in double
+// quotes, with "" standing for a quote inside them. Returns the start of the next field, or NULL
+// if the field does not fit.
+const char *readCsvField(const char *cursor, const char *end, char *target, size_t size, int *lastField) {
+    size_t length = 0;
+    int fits = 1;
+
+    if (cursor < end && *cursor == '"') {
+        cursor++;
+        while (cursor < end) {
+            if (*cursor == '"') {
+                if (cursor + 1 < end && cursor[1] == '"') {
+                    cursor++;
+                } else {
+                    cursor++;
+                    break;
+                }
+            }
+            if (length + 1 < size) {
+                target[length++] = *cursor;
+            } else {
+                fits = 0;
+            }
+            cursor++;
+        }
+    }
+    while (cursor < end && *cursor != ',') {
+        if (*cursor != '\r') {
+            if (length + 1 < size) {
+                target[length++] = *cursor;
+            } else {
+                fits = 0;
+            }
+        }
+        cursor++;
+    }
+    target[length] = '\0';
+    *lastField = cursor >= end;
+    return fits ? (cursor < end ? cursor + 1 : cursor) : NULL;
+}
+
+// Reads a date written as three numbers in day, month, year order with any separators, e.g. 31/12/1990
+int parseDate(const char *text, Date *date) {
+    int parts[3] = {0, 0, 0};
+    int part = 0;
+    int digits = 0;
+    for (const char *c = text; ; c++) {
+        if (*c >= '0' && *c <= '9') {
+            if (part == 3 || digits == 4) {
+                return 0;
+            }
+            parts[part] = parts[part] * 10 + (*c - '0');
+            digits++;
+        } else {
+            if (digits > 0) {
+                part++;
+                digits = 0;
+            }
+            if (*c == '\0') {
+                break;
+            }
+        }
+    }
+    if (part != 3) {
+        return 0;
+    }
+    date->day = parts[0];
+    date->month = parts[1];
+    date->year = parts[2];
+    return 1;
+}
+
+// Parses and validates one CSV row with the same rules as the Add a New Member prompts. Returns
+// NULL if the row is a valid member, otherwise the reason it was rejected.
+const char *parseMemberRow(const char *line, const char *end, Member *member, Date today) {
+    char gender[8], relation[16], dob[24];
+    struct { char *target; size_t size; const char *tooLong; } fields[] = {
+        { member->firstName, sizeof(member->firstName), "first name too long" },
+        { member->lastName, sizeof(member->lastName), "last name too long" },
+        { member->phoneNum, sizeof(member->phoneNum), "phone number too long" },
+        { gender, sizeof(gender), "invalid gender" },
+        { member->emergencyName, sizeof(member->emergencyName), "emergency contact name too long" },
+        { member->emergencyPhone, sizeof(member->emergencyPhone), "emergency contact phone too long" },
+        { relation, sizeof(relation), "invalid emergency contact relation" },
+        { dob, sizeof(dob), "invalid date of birth" },
+    };
+    int fieldCount = (int)(sizeof(fields) / sizeof(fields[0]));
+
+    const char *cursor = line;
+    int lastField = 0;
+    for (int i = 0; i < fieldCount; i++) {
+        if (lastField) {
+            return "missing fields";
+        }
+        cursor = readCsvField(cursor, end, fields[i].target, fields[i].size, &lastField);
+        if (cursor == NULL) {
+            return fields[i].tooLong;
+        }
+    }
+    if (!lastField) {
+        return "too many fields";
+    }
+
+    if (!isValidPersonName(member->firstName))
+        return "invalid first name";
+    if (!isValidPersonName(member->lastName))
+        return "invalid last name";
+    if (!isValidPhoneNumber(member->phoneNum))
+        return "invalid phone number";
+
+    member->gender = (char)toupper((unsigned char)gender[0]);
+    if (gender[1] != '\0' || (member->gender != 'M' && member->gender != 'F'))
+        return "invalid gender";
+
+    if (!isValidPersonName(member->emergencyName))
+        return "invalid emergency contact name";
+    if (!isValidPhoneNumber(member->emergencyPhone))
+        return "invalid emergency contact phone";
+
+    int relationIndex = -1;
+    for (int i = 0; i < (int)(sizeof(relationNames) / sizeof(relationNames[0])); i++) {
+        if (strcasecmp(relation, relationNames[i]) == 0) {
+            relationIndex = i;
+            break;
+        }
+    }
+    if (relationIndex == -1)
+        return "invalid emergency contact relation";
+    strcpy(member->emergencyRelation, relationNames[relationIndex]);
+
+    if (!parseDate(dob, &member->dob) || !isValidDate(member->dob.day, member->dob.month, member->dob.year))
+        return "invalid date of birth";
+    if (calculateAge(member->dob, today) < 13)
+        return "member must be at least 13 years old";
+
+    return NULL;
+}
+
+// Worker thread: parses every line of its chunk into members or rejections
+void *importChunkMain(void *argument) {
+    ImportChunk *chunk = argument;
+    const char *line = chunk->start;
+
+    while (line < chunk->end) {
+        const char *lineEnd = memchr(line, '\n', (size_t)(chunk->end - line));
+        if (lineEnd == NULL) {
+            lineEnd = chunk->end;
+        }
+
+        if (lineEnd > line && !(lineEnd - line == 1 && *line == '\r')) {
+            if (chunk->count == chunk->capacity) {
+                chunk->capacity = chunk->capacity > 0 ? chunk->capacity * 2 : 1024;
+                chunk->members = realloc(chunk->members, (size_t)chunk->capacity * sizeof(Member));
+                chunk->memberLines = realloc(chunk->memberLines, (size_t)chunk->capacity * sizeof(long));
+                if (chunk->members == NULL || chunk->memberLines == NULL) {
+                    printf("Memory allocation failed!\n");
+                    exit(1);
+                }
+            }
+            Member *member = &chunk->members[chunk->count];
+            memset(member, 0, sizeof(Member));
+            const char *reason = parseMemberRow(line, lineEnd, member, chunk->today);
+            if (reason == NULL) {
+                chunk->memberLines[chunk->count++] = chunk->lines;
+            } else {
+                if (chunk->rejectionCount == chunk->rejectionCapacity) {
+                    chunk->rejectionCapacity = chunk->rejectionCapacity > 0 ? chunk->rejectionCapacity * 2 : 64;
+                    chunk->rejections = realloc(chunk->rejections, (size_t)chunk->rejectionCapacity * sizeof(ImportRejection));
+                    if (chunk->rejections == NULL) {
+                        printf("Memory allocation failed!\n");
+                        exit(1);
+                    }
+                }
+                chunk->rejections[chunk->rejectionCount].line = chunk->lines;
+                chunk->rejections[chunk->rejectionCount].reason = reason;
+                chunk->rejectionCount++;
+            }
+        }
+
+        chunk->lines++;
+        line = lineEnd + 1;
+    }
+    return NULL;
+}
+
+// Lists a rejected import row in the rejects file, creating it on the first call.
+// 'memberID' is the member a duplicate row clashes with, or -1.
+void writeImportRejection(FILE **rejects, const char *rejectsPath, long line, const char *reason, int memberID) {
+    if (*rejects == NULL && (*rejects = fopen(rejectsPath, "w")) == NULL) {
+        printf("Error: could not write %s.\n", rejectsPath);
+        return;
+    }
+    if (memberID >= 0) {
+        fprintf(*rejects, "line %ld: %s (member ID %d)\n", line, reason, memberID);
+    } else {
+        fprintf(*rejects, "line %ld: %s\n", line, reason);
+    }
+}
+
+// Imports members from a CSV file with the columns
+//   firstName,lastName,phone,gender,emergencyName,emergencyPhone,emergencyRelation,dob
+// (dob as dd/mm/yyyy; a first line starting with "firstName" is taken as a header). The file is
+// streamed in batches, each split into one chunk of whole lines per core and parsed in parallel.
+// Valid rows get consecutive IDs and are appended in file order; rows whose phone number is
+// already registered (including to an earlier row of the file) are rejected as duplicates.
+// Rejected rows are listed with their line number and reason in '<path>.rejects.txt'.
+void importMembersFromCSV(MemberList *list, const char *path, int *nextMemberID) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        printf("Error: could not open %s.\n", path);
+        return;
+    }
+    size_t fileSize = 0; // Left at 0 if unknown, so each batch only reserves room for itself
+    struct stat info;
+    if (fstat(fd, &info) == 0 && info.st_size > 0) {
+        fileSize = (size_t)info.st_size;
+    }
+
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    int threadCount = cores < 1 ? 1 : (cores > IMPORT_MAX_THREADS ? IMPORT_MAX_THREADS : (int)cores);
+    ImportChunk chunks[IMPORT_MAX_THREADS];
+    pthread_t threads[IMPORT_MAX_THREADS];
+    int running[IMPORT_MAX_THREADS];
+    memset(chunks, 0, sizeof(chunks));
+
+    char *buffer = malloc(IMPORT_BATCH_BYTES);
+    if (buffer == NULL) {
+        printf("Memory allocation failed!\n");
+        exit(1);
+    }
+
+    char rejectsPath[512];
+    snprintf(rejectsPath, sizeof(rejectsPath), "%s.rejects.txt", path);
+    FILE *rejects = NULL; // Created on the first rejected row
+    unlink(rejectsPath);
+
+    Date today = getCurrentDate();
+    struct timespec started, finished;
+    clock_gettime(CLOCK_MONOTONIC, &started);
+
+    size_t carried = 0; // Bytes of an incomplete last line kept for the next batch
+    long firstLine = 1; // File line number of the batch's first line
+    long imported = 0, rejected = 0;
+    size_t bytesRead = 0;
+    int atEnd = 0;
+    while (!atEnd) {
+        ssize_t got = read(fd, buffer + carried, IMPORT_BATCH_BYTES - carried);
+        if (got < 0) {
+            printf("Error reading %s.\n", path);
+            break;
+        }
+        atEnd = got == 0;
+        bytesRead += (size_t)got;
+        size_t filled = carried + (size_t)got;
+
+        // Only whole lines are parsed, unless this is the end of the file
+        size_t usable = filled;
+        if (!atEnd) {
+            char *lastNewline = NULL;
+            for (size_t i = filled; i > 0; i--) {
+                if (buffer[i - 1] == '\n') {
+                    lastNewline = buffer + i - 1;
+                    break;
+                }
+            }
+            if (lastNewline == NULL) {
+                if (filled == IMPORT_BATCH_BYTES) {
+                    printf("Error: line %ld of %s is too long.\n", firstLine, path);
+                    break;
+                }
+                carried = filled;
+                continue;
+            }
+            usable = (size_t)(lastNewline - buffer) + 1;
+        }
+        if (usable == 0) {
+            break;
+        }
+
+        const char *start = buffer;
+        if (firstLine == 1 && strncasecmp(buffer, "firstName", 9) == 0) {
+            const char *headerEnd = memchr(buffer, '\n', usable);
+            start = headerEnd != NULL ? headerEnd + 1 : buffer + usable;
+        }
+
+        // Split the batch into one chunk of whole lines per thread
+        const char *batchEnd = buffer + usable;
+        const char *chunkStart = start;
+        for (int t = 0; t < threadCount; t++) {
+            const char *chunkEnd = t == threadCount - 1 ? batchEnd : chunkStart + (batchEnd - start) / threadCount;
+            if (chunkEnd > batchEnd) {
+                chunkEnd = batchEnd;
+            }
+            if (chunkEnd < batchEnd) {
+                const char *newline = memchr(chunkEnd, '\n', (size_t)(batchEnd - chunkEnd));
+                chunkEnd = newline != NULL ? newline + 1 : batchEnd;
+            }
+            chunks[t].start = chunkStart;
+            chunks[t].end = chunkEnd;
+            chunks[t].today = today;
+            chunks[t].count = 0;
+            chunks[t].rejectionCount = 0;
+            chunks[t].lines = 0;
+            chunkStart = chunkEnd;
+        }
+        for (int t = 1; t < threadCount; t++) {
+            running[t] = pthread_create(&threads[t], NULL, importChunkMain, &chunks[t]) == 0;
+            if (!running[t]) {
+                importChunkMain(&chunks[t]); // Parse it here instead
+            }
+        }
+        importChunkMain(&chunks[0]);
+        for (int t = 1; t < threadCount; t++) {
+            if (running[t]) {
+                pthread_join(threads[t], NULL);
+            }
+        }
+
+        // One reservation for the batch, then append in file order with consecutive IDs
+        int valid = 0;
+        for (int t = 0; t < threadCount; t++) {
+            valid += chunks[t].count;
+        }
+        if (valid > 0) {
+            // Size the reservation for the whole file from how dense this batch was
+            double rowsPerByte = (double)valid / (double)usable;
+            double expectedRest = rowsPerByte * (double)(fileSize > bytesRead ? fileSize - bytesRead : 0);
+            double room = (double)INT_MAX - list->count - valid;
+            if (expectedRest > room) {
+                expectedRest = room;
+            }
+            reserveMembers(list, list->count + valid + (int)expectedRest);
+        }
+        long line = firstLine + (start != buffer ? 1 : 0);
+        int firstSlot = list->count;
+        for (int t = 0; t < threadCount; t++) {
+            ImportChunk *chunk = &chunks[t];
+            int r = 0;
+            for (int i = 0; i < chunk->count; i++) {
+                // Rejections before this row first, to keep the rejects file in line order
+                for (; r < chunk->rejectionCount && chunk->rejections[r].line < chunk->memberLines[i]; r++) {
+                    writeImportRejection(&rejects, rejectsPath, line + chunk->rejections[r].line, chunk->rejections[r].reason, -1);
+                }
+
+                Member *member = &chunk->members[i];
+                int owner = phoneOwner(list, member->phoneNum, -1);
+                if (owner != -1) {
+                    writeImportRejection(&rejects, rejectsPath, line + chunk->memberLines[i], "phone number already registered", owner);
+                    rejected++;
+                    continue;
+                }
+                member->memberID = (*nextMemberID)++;
+                storeMember(list, list->count, member);
+                idIndexPut(&list->idIndex, member->memberID, list->count);
+                handleAttach(&list->handles, list->count);
+                indexMember(list, member);
+                list->count++;
+                imported++;
+            }
+            for (; r < chunk->rejectionCount; r++) {
+                writeImportRejection(&rejects, rejectsPath, line + chunk->rejections[r].line, chunk->rejections[r].reason, -1);
+            }
+            rejected += chunk->rejectionCount;
+            line += chunk->lines;
+        }
+        if (list->count > firstSlot) {
+            markDirtyRange(&list->dirty, firstSlot, list->count - 1);
+        }
+
+        // Keep the incomplete last line for the next batch
+        carried = filled - usable;
+        memmove(buffer, buffer + usable, carried);
+        firstLine = line;
+    }
+    close(fd);
+
+    for (int t = 0; t < threadCount; t++) {
+        free(chunks[t].members);
+        free(chunks[t].memberLines);
+        free(chunks[t].rejections);
+    }
+    free(buffer);
+    if (rejects != NULL) {
+        fclose(rejects);
+    }
+
+    // The rows are not logged one by one, the import is saved as a whole instead
+    if (imported > 0) {
+        checkpointMembers(list);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &finished);
+    double seconds = (double)(finished.tv_sec - started.tv_sec) + (double)(finished.tv_nsec - started.tv_nsec) / 1e9;
+    printf("Imported %ld members, rejected %ld rows in %.2f seconds (%.0f rows/s).\n",
+        imported, rejected, seconds, seconds > 0 ? (double)(imported + rejected) / seconds : 0.0);
+    if (rejected > 0) {
+        printf("Rejected rows are listed in %s.\n", rejectsPath);
+    }
+}
+
+void memberManagementMenu(MemberList *memberList, int *nextMemberID) {
+    int choice;
+    do {
+        printf("==========================================\n");
+        printf("        Member Management\n");
+        printf("==========================================\n");
+        printf("1. Add a New Member\n");
+        printf("2. List All Members\n");
+        printf("3. Find a Member\n");
+        printf("4. Update Member Details\n");
+        printf("5. Delete a Member\n");
+        printf("6. Bulk Import Members from CSV\n");
+        printf("7. Back to Main Menu\n");
+        printf("==========================================\n");
+        printf("Enter your choice (1-7): \n");
+        if (scanf("%d", &choice) != 1) {
+            printf("Invalid input. Please enter a number between 1-7.\n");
+            while (getchar() != '\n');
+            continue;
+        }
+        getchar();  // Consume the newline character left in the buffer
+
+    switch(choice) {
+        case 1: {
+            Member newMember;
+            newMember.memberID = (*nextMemberID)++;
+
+            // Input First Name
+            while (1) {
+                printf("Enter first name: ");
+                fgets(newMember.firstName, sizeof(newMember.firstName), stdin);
+                newMember.firstName[strcspn(newMember.firstName, "\n")] = '\0'; // remove newline
+
+                // Check if name contains only letters and spaces and is at least 2 characters
+                int validName = isValidPersonName(newMember.firstName);
+
+                if (!validName) {
+                    printf("Invalid first name. Please enter a valid name with at least 2 letters.\n");
+                } else {
+                    break;
+                }
+            }
+
+            // Input Last Name
+            while (1) {
+                printf("Enter last name: ");
+                fgets(newMember.lastName, sizeof(newMember.lastName), stdin);
+                newMember.lastName[strcspn(newMember.lastName, "\n")] = '\0'; // remove newline
+
+                // Check if name contains only letters and spaces and is at least 2 characters
+                int validName = isValidPersonName(newMember.lastName);
+
+                if (!validName) {
+                    printf("Invalid last name. Please enter a valid name with at least 2 letters.\n");
+                } else {
+                    break;
+                }
+            }
+
+            // Input Phone Number
+            while (1) {
+                printf("Enter phone number (digits only): ");
+                fgets(newMember.phoneNum, sizeof(newMember.phoneNum), stdin);
+                newMember.phoneNum[strcspn(newMember.phoneNum, "\n")] = '\0';
+
+                // Validate phone number (digits only, at least 7)
+                int owner;
+                if (!isValidPhoneNumber(newMember.phoneNum)) {
+                    printf("Invalid phone number. Please enter digits only, at least 7 digits.\n");
+                } else if ((owner = phoneOwner(memberList, newMember.phoneNum, -1)) != -1) {
+                    printf("This phone number is already registered to member ID %d.\n", owner);
+                } else {
+                    break;
+                }
+            }
+
+            // Input Gender
+            while (1) {
+                printf("Enter gender (M/F): ");
+                scanf("%c", &newMember.gender);
+                getchar(); // consume newline
+                newMember.gender = toupper(newMember.gender);
+                if (newMember.gender != 'M' && newMember.gender != 'F') {
+                    printf("Invalid gender. Please enter 'M' or 'F'.\n");
+                } else {
+                    break;
+                }
+            }
+
+            // Input Emergency Contact Name
+            while (1) {
+                printf("Enter emergency contact name: ");
+                fgets(newMember.emergencyName, sizeof(newMember.emergencyName), stdin);
+                newMember.emergencyName[strcspn(newMember.emergencyName, "\n")] = '\0';
+
+                // Check if name contains only letters and spaces and is at least 2 characters
+                int validName = isValidPersonName(newMember.emergencyName);
+
+                if (!validName) {
+                    printf("Invalid name. Please enter a valid name with at least 2 letters.\n");
+                } else {
+                    break;
+                }
+            }
+
+            // Input Emergency Contact Phone
+            while (1) {
+                printf("Enter emergency contact phone (digits only): ");
+                fgets(newMember.emergencyPhone, sizeof(newMember.emergencyPhone), stdin);
+                newMember.emergencyPhone[strcspn(newMember.emergencyPhone, "\n")] = '\0';
+
+                // Validate phone number (digits only, at least 7)
+                if (!isValidPhoneNumber(newMember.emergencyPhone)) {
+                    printf("Invalid phone number. Please enter digits only, at least 7 digits.\n");
+                } else {
+                    break;
+                }
+            }
+
+            // Input Emergency Contact Relation
+            int relationChoice;
+            while (1) {
+                printf("Select emergency contact relation:\n");
+                printf("1. Spouse\n");
+                printf("2. Partner\n");
+                printf("3. Friend\n");
+                printf("4. Relative\n");
+                printf("5. Parent\n");
+                printf("6. Other\n");
+                printf("Choose an option (1-6): ");
+                if (scanf("%d", &relationChoice) != 1) {
+                    printf("Invalid input. Please enter a number between 1-6.\n");
+                    while (getchar() != '\n');
+                    continue;
+                }
+                getchar(); // consume newline
+
+                if (relationChoice >=1 && relationChoice <=6) {
+                    break;
+                } else {
+                    printf("Invalid choice. Please select a number between 1 and 6.\n");
+                }
+            }
+
+            strcpy(newMember.emergencyRelation, relationNames[relationChoice -1]);
+
+            // Prompt for date of birth
+            while (1) {
+                printf("Enter date of birth (dd mm yyyy): ");
+                if (scanf("%d %d %d", &newMember.dob.day, &newMember.dob.month, &newMember.dob.year) != 3) {
+                    printf("Invalid date format. Please enter day month year as numbers.\n");
+                    while (getchar() != '\n');
+                    continue;
+                }
+                getchar();
+
+                // Validate date of birth
+                Date currentDate = getCurrentDate();
+
+                if (!isValidDate(newMember.dob.day, newMember.dob.month, newMember.dob.year)) {
+                    printf("Invalid date of birth. Please enter a valid date.\n");
+                    continue;
+                }
+
+                int age = calculateAge(newMember.dob, currentDate);
+                if (age < 13) {
+                    printf("Member must be at least 13 years old to register.\n");
+                    continue;
+                }
+                break;
+            }
+
+            // Now, add the member to the list
+            addMember(memberList, &newMember);
+
+            printf("Member added successfully!\n");
+            break;
+        }
+        case 2:
+            listMembers(memberList);
+            break;
+        case 3: {
+            searchMembers(memberList);
+            break;
+        }
+        case 4: {
+            printf("Enter member ID to update: ");
+            int updateID;
+            if (scanf("%d", &updateID) != 1) {
+                printf("Invalid input. Please enter a valid member ID.\n");
+                while (getchar() != '\n');
+                break;
+            }
+            getchar();
+
+            RecordHandle handle = findMemberHandle(memberList, updateID);
+            Member found;
+
+            if (resolveMember(memberList, handle, &found) != -1) {
+                // The prompts edit a copy, since the list may change while they wait for input
+                Member edited = found;
+                Member *memberToUpdate = &edited;
+                int updateChoice;
+                printf("Which field do you want to update?\n");
+                printf("1. First Name\n");
+                printf("2. Last Name\n");
+                printf("3. Phone Number\n");
+                printf("4. Gender\n");
+                printf("5. Emergency Contact Name\n");
+                printf("6. Emergency Contact Phone\n");
+                printf("7. Emergency Contact Relation\n");
+                printf("8. Date of Birth\n");
+                printf("Enter choice (1-8): ");
+                if (scanf("%d", &updateChoice) != 1) {
+                    printf("Invalid input. Please enter a number between 1-8.\n");
+                    while (getchar() != '\n');
+                    break;
+                }
+                getchar();
+
+                switch (updateChoice) {
+                    case 1:
+                        while (1) {
+                            printf("Enter new first name: ");
+                            fgets(memberToUpdate->firstName, sizeof(memberToUpdate->firstName), stdin);
+                            memberToUpdate->firstName[strcspn(memberToUpdate->firstName, "\n")] = '\0';
+
+                            int validName = isValidPersonName(memberToUpdate->firstName);
+
+                            if (!validName) {
+                                printf("Invalid first name. Please enter a valid name with at least 2 letters.\n");
+                            } else {
+                                break;
+                            }
+                        }
+                        break;
+                    case 2:
+                        while (1) {
+                            printf("Enter new last name: ");
+                            fgets(memberToUpdate->lastName, sizeof(memberToUpdate->lastName), stdin);
+                            memberToUpdate->lastName[strcspn(memberToUpdate->lastName, "\n")] = '\0';
+
+                            int validName = isValidPersonName(memberToUpdate->lastName);
+
+                            if (!validName) {
+                                printf("Invalid last name. Please enter a valid name with at least 2 letters.\n");
+                            } else {
+                                break;
+                            }
+                        }
+                        break;
+                    case 3:
+                        while (1) {
+                            printf("Enter new phone number: ");
+                            fgets(memberToUpdate->phoneNum, sizeof(memberToUpdate->phoneNum), stdin);
+                            memberToUpdate->phoneNum[strcspn(memberToUpdate->phoneNum, "\n")] = '\0';
+
+                            // Validate phone number (digits only, at least 7)
+                            int owner;
+                            if (!isValidPhoneNumber(memberToUpdate->phoneNum)) {
+                                printf("Invalid phone number. Please enter digits only, at least 7 digits.\n");
+                            } else if ((owner = phoneOwner(memberList, memberToUpdate->phoneNum, memberToUpdate->memberID)) != -1) {
+                                printf("This phone number is already registered to member ID %d.\n", owner);
+                            } else {
+                                break;
+                            }
+                        }
+                        break;
+                    case 4:
+                        while (1) {
+                            printf("Enter new gender (M/F): ");
+                            scanf("%c", &memberToUpdate->gender);
+                            getchar();
+                            memberToUpdate->gender = toupper(memberToUpdate->gender);
+                            if (memberToUpdate->gender != 'M' && memberToUpdate->gender != 'F') {
+                                printf("Invalid gender. Please enter 'M' or 'F'.\n");
+                            } else {
+                                break;
+                            }
+                        }
+                        break;
+                    case 5:
+                        while (1) {
+                            printf("Enter new emergency contact name: ");
+                            fgets(memberToUpdate->emergencyName, sizeof(memberToUpdate->emergencyName), stdin);
+                            memberToUpdate->emergencyName[strcspn(memberToUpdate->emergencyName, "\n")] = '\0';
+
+                            int validName = isValidPersonName(memberToUpdate->emergencyName);
+
+                            if (!validName) {
+                                printf("Invalid name. Please enter a valid name with at least 2 letters.\n");
+                            } else {
+                                break;
+                            }
+                        }
+                        break;
+                    case 6:
+                        while (1) {
+                            printf("Enter new emergency contact phone: ");
+                            fgets(memberToUpdate->emergencyPhone, sizeof(memberToUpdate->emergencyPhone), stdin);
+                            memberToUpdate->emergencyPhone[strcspn(memberToUpdate->emergencyPhone, "\n")] = '\0';
+
+                            // Validate phone number (digits only, at least 7)
+                            if (!isValidPhoneNumber(memberToUpdate->emergencyPhone)) {
+                                printf("Invalid phone number. Please enter digits only, at least 7 digits.\n");
+                            } else {
+                                break;
+                            }
+                        }
+                        break;
+                    case 7: {
+                        int relationChoice;
+                        while (1) {
+                            printf("Select new emergency contact relation:\n");
+                            printf("1. Spouse\n");
+                            printf("2. Partner\n");
+                            printf("3. Friend\n");
+                            printf("4. Relative\n");
+                            printf("5. Parent\n");
+                            printf("6. Other\n");
+                            printf("Choose an option (1-6): ");
+                            if (scanf("%d", &relationChoice) != 1) {
+                                printf("Invalid input. Please enter a number between 1-6.\n");
+                                while (getchar() != '\n');
+                                continue;
+                            }
+                            getchar();
+
+                            if (relationChoice >=1 && relationChoice <=6) {
+                                break;
+                            } else {
+                                printf("Invalid choice. Please select a number between 1 and 6.\n");
+                            }
+                        }
+
+                        strcpy(memberToUpdate->emergencyRelation, relationNames[relationChoice -1]);
+                        break;
+                    }
+                    case 8:
+                        while (1) {
+                            printf("Enter new date of birth (dd mm yyyy): ");
+                            if (scanf("%d %d %d", &memberToUpdate->dob.day, &memberToUpdate->dob.month, &memberToUpdate->dob.year) != 3) {
+                                printf("Invalid date format. Please enter day month year as numbers.\n");
+                                while (getchar() != '\n');
+                                continue;
+                            }
+                            getchar();
+
+                            // Validate dob
+                            Date currentDate = getCurrentDate();
+
+                            if (!isValidDate(memberToUpdate->dob.day, memberToUpdate->dob.month, memberToUpdate->dob.year)) {
+                                printf("Invalid date of birth. Please enter a valid date.\n");
+                                continue;
+                            }
+
+                            int age = calculateAge(memberToUpdate->dob, currentDate);
+                            if (age < 13) {
+                                printf("Member must be at least 13 years old to register.\n");
+                                continue;
+                            }
+                            break;
+                        }
+                        break;
+                    default:
+                        printf("Invalid choice.\n");
+                }
+
+                Member stored;
+                int slot = resolveMember(memberList, handle, &stored);
+                if (slot == -1) {
+                    printf("Member with ID %d was deleted before the update could be saved.\n", updateID);
+                    break;
+                }
+                updateMember(memberList, slot, &edited, &stored);
+
+                printf("Member details updated successfully!\n");
+            } else {
+                printf("Member with ID %d not found.\n", updateID);
+            }
+
+            break;
+        }
+        case 5: {
+            printf("Enter member ID to delete: ");
+            int deleteID;
+            if (scanf("%d", &deleteID) != 1) {
+                printf("Invalid input. Please enter a valid member ID.\n");
+                while (getchar() != '\n');
+                break;
+            }
+            getchar();
+
+            deleteMember(memberList, deleteID);
+
+            printf("Member deleted successfully!\n");
+            break;
+        }
+        case 6: {
+            char path[256];
+            printf("Enter the path of the CSV file: ");
+            fgets(path, sizeof(path), stdin);
+            path[strcspn(path, "\n")] = '\0'; // remove newline
+
+            importMembersFromCSV(memberList, path, nextMemberID);
+            break;
+        }
+        case 7:
+            printf("Returning to Main Menu...\n");
+            break;
+        default:
+            printf("Invalid choice. Please try again.\n");
+        }
+
+        commitMemberLog(memberList);
+    } while (choice != 7);
+}
+
+void equipmentManagementMenu(EquipmentList *equipmentList, int *nextEquipmentID) {
+    int choice;
+    do {
+        printf("==========================================\n");
+        printf("        Equipment Management\n");
+        printf("==========================================\n");
+        printf("1. Add New Equipment\n");
+        printf("2. List All Equipment\n");
+        printf("3. Update Equipment Status\n");
+        printf("4. Delete Equipment\n");
+        printf("5. Back to Main Menu\n");
+        printf("==========================================\n");
+        printf("Enter your choice (1-5): \n");
+        if (scanf("%d", &choice) != 1) {
+            printf("Invalid input. Please enter a number between 1-5.\n");
+            while (getchar() != '\n');
+            continue;
+        }
+        getchar();  // Consume the newline character left in the buffer
+
+        switch(choice) {
+            case 1: {
+                // Add new equipment
+                Equipment newEquipment;
+                newEquipment.id = (*nextEquipmentID)++; // Assign a unique ID
+
+                // Input Equipment Name
+                while (1) {
+                    printf("Enter equipment name: ");
+                    fgets(newEquipment.name, sizeof(newEquipment.name), stdin);
+                    newEquipment.name[strcspn(newEquipment.name, "\n")] = '\0';
+                    if (strlen(newEquipment.name) < 1) {
+                        printf("Equipment name cannot be empty.\n");
+                    } else {
+                        break;
+                    }
+                }
+
+                // Input Total Quantity
+                while (1) {
+                    printf("Enter total quantity: ");
+                    if (scanf("%d", &newEquipment.totalQuantity) != 1 || newEquipment.totalQuantity <= 0) {
+                        printf("Invalid input. Please enter a positive number.\n");
+                        while (getchar() != '\n');
+                        continue;
+                    }
+                    getchar();
+                    break;
+                }
+
+                if (newEquipment.totalQuantity == 1) {
+                    // Ask if the equipment is functional
+                    int functionalChoice;
+                    while (1) {
+                        printf("Is the equipment functional?\n");
+                        printf("1. Yes\n");
+                        printf("2. No\n");
+                        printf("Choose an option (1-2): ");
+                        if (scanf("%d", &functionalChoice) != 1 || (functionalChoice !=1 && functionalChoice !=2)) {
+                            printf("Invalid input. Please enter 1 or 2.\n");
+                            while (getchar() != '\n');
+                            continue;
+                        }
+                        getchar();
+                        if (functionalChoice == 1) {
+                            newEquipment.functional = 1;
+                            newEquipment.broken = 0;
+                            break;
+                        } else {
+                            newEquipment.functional = 0;
+                            newEquipment.broken = 1;
+                            break;
+                        }
+                    }
+                } else {
+                    // For multiple quantities
+                    int allFunctionalChoice;
+                    while (1) {
+                        printf("Are all equipments functional?\n");
+                        printf("1. Yes\n");
+                        printf("2. No\n");
+                        printf("Choose an option (1-2): ");
+                        if (scanf("%d", &allFunctionalChoice) != 1 || (allFunctionalChoice !=1 && allFunctionalChoice !=2)) {
+                            printf("Invalid input. Please enter 1 or 2.\n");
+                            while (getchar() != '\n');
+                            continue;
+                        }
+                        getchar();
+                        if (allFunctionalChoice == 1) {
+                            newEquipment.functional = newEquipment.totalQuantity;
+                            newEquipment.broken = 0;
+                            break;
+                        } else {
+                            // Ask for the number of broken equipments
+                            while (1) {
+                                printf("Enter the number of broken equipments: ");
+                                if (scanf("%d", &newEquipment.broken) !=1 || newEquipment.broken <0 || newEquipment.broken > newEquipment.totalQuantity) {
+                                    printf("Invalid input. Please enter a number between 0 and %d.\n", newEquipment.totalQuantity);
+                                    while (getchar() != '\n');
+                                    continue;
+                                }
+                                getchar();
+                                newEquipment.functional = newEquipment.totalQuantity - newEquipment.broken;
+                                break;
+                            }
+                            break;
+                        }
+                    }
+                }
+
+                // Compute status based on functional and broken
+                if (newEquipment.broken > 0) {
+                    newEquipment.status = EQUIPMENT_UNDER_MAINTENANCE;
+
+                    // Prompt for repair ETA
+                    while (1) {
+                        printf("Enter repair ETA (dd mm yyyy): ");
+                        if (scanf("%d %d %d", &newEquipment.repairETA.day, &newEquipment.repairETA.month, &newEquipment.repairETA.year) != 3) {
+                            printf("Invalid date format. Please enter day month year as numbers.\n");
+                            while (getchar() != '\n');
+                            continue;
+                        }
+                        getchar();
+
+                        // Validate the date
+                        Date currentDate = getCurrentDate();
+
+                        if (!isValidDate(newEquipment.repairETA.day, newEquipment.repairETA.month, newEquipment.repairETA.year)) {
+                            printf("Invalid date entered. Please enter a valid date.\n");
+                            continue;
+                        }
+
+                        Date repairETA = newEquipment.repairETA;
+
+                        int cmpResult = compareDates(repairETA, currentDate);
+                        if (cmpResult < 0) {
+                            printf("Error: Repair ETA cannot be in the past.\n");
+                        } else {
+                            break;
+                        }
+                    }
+                } else {
+                    newEquipment.status = EQUIPMENT_OPERATIONAL;
+                    // Set repairETA to 0
+                    newEquipment.repairETA.day = 0;
+                    newEquipment.repairETA.month = 0;
+                    newEquipment.repairETA.year = 0;
+                }
+
+                // Add equipment to list
+                addEquipment(equipmentList, &newEquipment);
+
+                printf("Equipment added successfully!\n");
+                break;
+            }
+            case 2:
+                // List All Equipment
+                if (equipmentList->count == equipmentList->deletedCount) {
+                    printf("No equipment found.\n");
+                } else {
+                    for (int i = 0; i < equipmentList->count; i++) {
+                        Equipment *e = equipmentAt(equipmentList, i);
+                        if (e->id == 0) {
+                            continue;
+                        }
+                        printf("Equipment ID: %d\n", e->id);
+                        printf("Name: %s\n", e->name);
+                        printf("Total Quantity: %d\n", e->totalQuantity);
+                        printf("Functional: %d\n", e->functional);
+                        printf("Broken: %d\n", e->broken);
+                        printf("Status: %s\n", equipmentStatusNames[e->status]);
+                        if (e->status == EQUIPMENT_UNDER_MAINTENANCE) {
+                            printf("Repair ETA: %02d/%02d/%04d\n", e->repairETA.day, e->repairETA.month, e->repairETA.year);
+                        }
+                        printf("--------------------------------\n");
+                    }
+                }
+                break;
+            case 3: {
+                // Update Equipment Status
+                printf("Enter equipment ID to update: ");
+                int equipmentID;
+                if (scanf("%d", &equipmentID) != 1) {
+                    printf("Invalid input. Please enter a valid equipment ID.\n");
+                    while (getchar() != '\n');
+                    break;
+                }
+                getchar();
+
+                // Find equipment
+                RecordHandle equipmentToUpdate = findEquipmentHandle(equipmentList, equipmentID);
+
+                if (resolveEquipment(equipmentList, equipmentToUpdate) != NULL) {
+                    updateEquipmentStatus(equipmentList, equipmentToUpdate);
+                } else {
+                    printf("Equipment with ID %d not found.\n", equipmentID);
+                }
+                break;
+            }
+            case 4: {
+                // Delete Equipment
+                printf("Enter equipment ID to delete: ");
+                int deleteID;
+                if (scanf("%d", &deleteID) != 1) {
+                    printf("Invalid input. Please enter a valid equipment ID.\n");
+                    while (getchar() != '\n');
+                    break;
+                }
+                getchar();
+
+                deleteEquipment(equipmentList, deleteID);
+
+                printf("Equipment deleted successfully!\n");
+                break;
+            }
+            case 5:
+                printf("Returning to Main Menu...\n");
+                break;
+            default:
+                printf("Invalid choice. Please try again.\n");
+        }
+
+        commitEquipmentLog(equipmentList);
+    } while (choice != 5);
+}
+
+// Prints aggregates of status changes: of one equipment, or summed over all of it. 'down' is how
+// many of them are under maintenance now.
+void printStatusStats(const StatusStats *stats, int down, time_t now) {
+    int observedDays = stats->firstSeen != 0 && now > (time_t)stats->firstSeen ? (int)((now - (time_t)stats->firstSeen) / 86400) : 0;
+    printf("Failures: %d", stats->failures);
+    if (observedDays > 0) {
+        printf(" (%.2f per 30 days over %d days)", stats->failures * 30.0 / observedDays, observedDays);
+    }
+    printf("\nRepairs finished: %d\n", stats->repairs);
+    if (stats->repairs > 0) {
+        printf("Mean time to repair: %.1f hours\n", (double)stats->downSeconds / stats->repairs / 3600.0);
+    }
+    if (stats->estimatedRepairs > 0) {
+        double meanLate = (double)stats->daysLate / stats->estimatedRepairs;
+        printf("Repair ETA met: %d of %d repairs (%.0f%%), finished %.1f days %s the ETA on average\n",
+            stats->onTimeRepairs, stats->estimatedRepairs, 100.0 * stats->onTimeRepairs / stats->estimatedRepairs,
+            meanLate < 0 ? -meanLate : meanLate, meanLate <= 0 ? "before" : "after");
+    }
+    if (down > 0) {
+        printf("Under maintenance now: %d\n", down);
+    }
+}
+
+// Shows the status history and aggregates of one equipment, or with ID 0 the totals over all
+// equipment and the equipment that breaks most often. Only the per-equipment aggregates are read,
+// never the history itself, apart from the one equipment's own changes.
+void printEquipmentReliability(EquipmentList *list, int equipmentID) {
+    StatusHistory *history = &list->statusHistory;
+    time_t now = time(NULL);
+    if (equipmentID != 0) {
+        StatusStats *stats = statusStatsFor(history, equipmentID, 0);
+        if (stats == NULL) {
+            printf("No status changes recorded for equipment %d.\n", equipmentID);
+            return;
+        }
+        int slot = findEquipmentIndex(list, equipmentID);
+        printf("Equipment %d: %s\n", equipmentID, slot != -1 ? equipmentAt(list, slot)->name : "(deleted)");
+        const int *positions;
+        int count = multimapGet(&history->byEquipment, (uint64_t)(uint32_t)equipmentID, &positions);
+        for (int i = 0; i < count; i++) {
+            const StatusChange *change = statusChangeAt(history, positions[i]);
+            time_t changedAt = (time_t)change->changedAt;
+            struct tm t;
+            localtime_r(&changedAt, &t);
+            printf("  %02d/%02d/%04d %02d:%02d  %s", t.tm_mday, t.tm_mon + 1, t.tm_year + 1900, t.tm_hour, t.tm_min,
+                equipmentStatusNames[change->status]);
+            if (change->repairETADay >= 0) {
+                Date eta = dateFromDayNumber(change->repairETADay);
+                printf(", ETA %02d/%02d/%04d", eta.day, eta.month, eta.year);
+            }
+            printf("\n");
+        }
+        printStatusStats(stats, stats->downSince != 0, now);
+        return;
+    }
+
+    StatusStats total;
+    memset(&total, 0, sizeof(total));
+    int down = 0;
+    int most[5]; // Positions in 'stats' of the equipment with the most failures, most first
+    int mostCount = 0;
+    for (int i = 0; i < history->statsCount; i++) {
+        const StatusStats *stats = &history->stats[i];
+        if (total.firstSeen == 0 || (stats->firstSeen != 0 && stats->firstSeen < total.firstSeen)) {
+            total.firstSeen = stats->firstSeen;
+        }
+        total.failures += stats->failures;
+        total.repairs += stats->repairs;
+        total.downSeconds += stats->downSeconds;
+        total.estimatedRepairs += stats->estimatedRepairs;
+        total.onTimeRepairs += stats->onTimeRepairs;
+        total.daysLate += stats->daysLate;
+        down += stats->downSince != 0;
+
+        if (stats->failures == 0) {
+            continue;
+        }
+        int place = mostCount < 5 ? mostCount++ : 5;
+        while (place > 0 && history->stats[most[place - 1]].failures < stats->failures) {
+            if (place < 5) {
+                most[place] = most[place - 1];
+            }
+            place--;
+        }
+        if (place < 5) {
+            most[place] = i;
+        }
+    }
+    if (history->statsCount == 0) {
+        printf("No equipment status changes have been recorded yet.\n");
+        return;
+    }
+    printf("All equipment, %d status changes recorded:\n", history->count);
+    printStatusStats(&total, down, now);
+    if (mostCount > 0) {
+        printf("Breaks most often:\n");
+    }
+    for (int i = 0; i < mostCount; i++) {
+        const StatusStats *stats = &history->stats[most[i]];
+        int slot = findEquipmentIndex(list, stats->equipmentID);
+        printf("  %d. ID %d %s: %d failures", i + 1, stats->equipmentID, slot != -1 ? equipmentAt(list, slot)->name : "(deleted)",
+            stats->failures);
+        if (stats->repairs > 0) {
+            printf(", mean time to repair %.1f hours", (double)stats->downSeconds / stats->repairs / 3600.0);
+        }
+        printf("\n");
+    }
+}
+
+void reportsMenu(MemberList *memberList, EquipmentList *equipmentList, ReportHistory *reportHistory) {
+    int choice;
+    do {
+        printf("==========================================\n");
+        printf("            Reports\n");
+        printf("==========================================\n");
+        printf("1. Generate Equipment Report\n");
+        printf("2. Export Members\n");
+        printf("3. Export Equipment\n");
+        printf("4. Members by Age Range\n");
+        printf("5. Upcoming Member Birthdays\n");
+        printf("6. Member Demographics\n");
+        printf("7. Find a Past Report by ID\n");
+        printf("8. Past Reports by Date\n");
+        printf("9. Equipment Reliability\n");
+        printf("10. Back to Main Menu\n");
+        printf("==========================================\n");
+        printf("Enter your choice (1-10): \n");
+        if (scanf("%d", &choice) != 1) {
+            printf("Invalid input. Please enter a number between 1-10.\n");
+            while (getchar() != '\n');
+            continue;
+        }
+        getchar(); 
+
+        switch(choice) {
+            case 1: {
+                Report report;
+                generateReport(equipmentList, reportHistory, &report);
+                break;
+            }
+            case 2:
+            case 3: {
+                ExportFormat format;
+                char path[256];
+                if (!promptExport(&format, path, sizeof(path))) {
+                    break;
+                }
+                int exported = choice == 2 ? exportMembers(memberList, path, format)
+                                           : exportEquipment(equipmentList, path, format);
+                if (exported) {
+                    printf("Exported %d records to %s.\n", choice == 2 ? memberList->count - memberList->deletedCount
+                                                                          : equipmentList->count - equipmentList->deletedCount, path);
+                }
+                break;
+            }
+            case 4: {
+                int minAge, maxAge;
+                printf("Enter the minimum and maximum age (e.g. 18 25): ");
+                if (scanf("%d %d", &minAge, &maxAge) != 2 || minAge < 0 || maxAge < minAge) {
+                    printf("Invalid input. Please enter two ages, the smaller one first.\n");
+                    while (getchar() != '\n');
+                    break;
+                }
+                getchar();
+
+                if (printMembersByAge(memberList, minAge, maxAge, getCurrentDate()) == 0) {
+                    printf("No members aged %d to %d.\n", minAge, maxAge);
+                }
+                break;
+            }
+            case 5: {
+                int days;
+                printf("Show birthdays in the next how many days (1-366, e.g. 7 for this week): ");
+                if (scanf("%d", &days) != 1 || days < 1 || days > 366) {
+                    printf("Invalid input. Please enter a number between 1-366.\n");
+                    while (getchar() != '\n');
+                    break;
+                }
+                getchar();
+
+                if (printUpcomingBirthdays(memberList, getCurrentDate(), days) == 0) {
+                    printf("No member birthdays in the next %d days.\n", days);
+                }
+                break;
+            }
+            case 6:
+                printMemberDemographics(memberList, getCurrentDate());
+                break;
+            case 7: {
+                int reportID;
+                printf("Enter the report ID: ");
+                if (scanf("%d", &reportID) != 1) {
+                    printf("Invalid input. Please enter a number.\n");
+                    while (getchar() != '\n');
+                    break;
+                }
+                getchar();
+
+                Report report;
+                if (findReport(reportHistory, reportID, &report)) {
+                    printReport(&report);
+                } else {
+                    printf("Report with ID %d not found.\n", reportID);
+                }
+                break;
+            }
+            case 8: {
+                Date from, to;
+                printf("Enter the first and last date (dd mm yyyy dd mm yyyy): ");
+                if (scanf("%d %d %d %d %d %d", &from.day, &from.month, &from.year, &to.day, &to.month, &to.year) != 6 ||
+                    !isValidDate(from.day, from.month, from.year) || !isValidDate(to.day, to.month, to.year) ||
+                    compareDates(from, to) > 0) {
+                    printf("Invalid input. Please enter two valid dates, the earlier one first.\n");
+                    while (getchar() != '\n');
+                    break;
+                }
+                getchar();
+
+                if (printReportsBetween(reportHistory, from, to) == 0) {
+                    printf("No reports from %02d/%02d/%04d to %02d/%02d/%04d.\n", from.day, from.month, from.year, to.day, to.month, to.year);
+                }
+                break;
+            }
+            case 9: {
+                int equipmentID;
+                printf("Enter the equipment ID, or 0 for all equipment: ");
+                if (scanf("%d", &equipmentID) != 1 || equipmentID < 0) {
+                    printf("Invalid input. Please enter an equipment ID or 0.\n");
+                    while (getchar() != '\n');
+                    break;
+                }
+                getchar();
+
+                printEquipmentReliability(equipmentList, equipmentID);
+                break;
+            }
+            case 10:
+                printf("Returning to Main Menu...\n");
+                break;
+            default:
+                printf("Invalid choice. Please try again.\n");
+        }
+    } while (choice != 10);
+}
+
+// Copies the next space-separated word of a batch command into 'word'. Returns the rest of the
+// line, or NULL if there is no word or it does not fit.
+const char *readBatchWord(const char *cursor, const char *end, char *word, size_t size) {
+    while (cursor < end && *cursor == ' ') {
+        cursor++;
+    }
+    size_t length = 0;
+    while (cursor < end && *cursor != ' ') {
+        if (length + 1 == size) {
+            return NULL;
+        }
+        word[length++] = *cursor++;
+    }
+    word[length] = '\0';
+    return length > 0 ? cursor : NULL;
+}
+
+// Reads a non-negative number written only with digits, e.g. an ID or a quantity
+int parseBatchNumber(const char *text, int *value) {
+    long number = 0;
+    if (*text == '\0') {
+        return 0;
+    }
+    for (const char *c = text; *c != '\0'; c++) {
+        if (*c < '0' || *c > '9' || number > 100000000) {
+            return 0;
+        }
+        number = number * 10 + (*c - '0');
+    }
+    *value = (int)number;
+    return 1;
+}
+
+// Checks a repair ETA with the same rules as the status prompts. Returns NULL if it is valid.
+const char *parseRepairETA(const char *text, Date today, Date *eta) {
+    if (!parseDate(text, eta) || !isValidDate(eta->day, eta->month, eta->year))
+        return "invalid repair ETA";
+    if (compareDates(*eta, today) < 0)
+        return "repair ETA cannot be in the past";
+    return NULL;
+}
+
+// ADD_EQ name,totalQuantity,broken[,repairETA]: the ETA is required when some are broken
+const char *batchAddEquipment(BatchSession *session, const char *cursor, const char *end, int *addedID) {
+    Equipment equipment;
+    char total[16], broken[16], eta[24];
+    memset(&equipment, 0, sizeof(equipment));
+    eta[0] = '\0';
+
+    int lastField = 0;
+    cursor = readCsvField(cursor, end, equipment.name, sizeof(equipment.name), &lastField);
+    if (cursor == NULL)
+        return "equipment name too long";
+    if (equipment.name[0] == '\0')
+        return "equipment name cannot be empty";
+    if (lastField || (cursor = readCsvField(cursor, end, total, sizeof(total), &lastField)) == NULL ||
+        !parseBatchNumber(total, &equipment.totalQuantity) || equipment.totalQuantity <= 0)
+        return "invalid total quantity";
+    if (lastField || (cursor = readCsvField(cursor, end, broken, sizeof(broken), &lastField)) == NULL ||
+        !parseBatchNumber(broken, &equipment.broken) || equipment.broken > equipment.totalQuantity)
+        return "invalid number of broken equipment";
+    if (!lastField && ((cursor = readCsvField(cursor, end, eta, sizeof(eta), &lastField)) == NULL || !lastField))
+        return "too many fields";
+
+    equipment.functional = equipment.totalQuantity - equipment.broken;
+    if (equipment.broken > 0) {
+        equipment.status = EQUIPMENT_UNDER_MAINTENANCE;
+        const char *reason = parseRepairETA(eta, session->today, &equipment.repairETA);
+        if (reason != NULL)
+            return reason;
+    } else {
+        equipment.status = EQUIPMENT_OPERATIONAL;
+        if (eta[0] != '\0')
+            return "repair ETA given for working equipment";
+    }
+
+    equipment.id = (*session->nextEquipmentID)++;
+    addEquipment(session->equipment, &equipment);
+    session->equipmentChanges++;
+    *addedID = equipment.id;
+    return NULL;
+}
+
+// SET_EQ_STATUS id OPERATIONAL, or SET_EQ_STATUS id MAINTENANCE repairETA
+const char *batchSetEquipmentStatus(BatchSession *session, const char *cursor, const char *end) {
+    char word[24];
+    int equipmentID;
+    if ((cursor = readBatchWord(cursor, end, word, sizeof(word))) == NULL || !parseBatchNumber(word, &equipmentID))
+        return "invalid equipment ID";
+    int index = findEquipmentIndex(session->equipment, equipmentID);
+    if (index == -1)
+        return "equipment not found";
+    if ((cursor = readBatchWord(cursor, end, word, sizeof(word))) == NULL)
+        return "missing status";
+
+    Equipment edited = *equipmentAt(session->equipment, index);
+    if (strcasecmp(word, "OPERATIONAL") == 0) {
+        edited.status = EQUIPMENT_OPERATIONAL;
+        edited.repairETA.day = 0;
+        edited.repairETA.month = 0;
+        edited.repairETA.year = 0;
+    } else if (strcasecmp(word, "MAINTENANCE") == 0) {
+        if ((cursor = readBatchWord(cursor, end, word, sizeof(word))) == NULL)
+            return "missing repair ETA";
+        const char *reason = parseRepairETA(word, session->today, &edited.repairETA);
+        if (reason != NULL)
+            return reason;
+        edited.status = EQUIPMENT_UNDER_MAINTENANCE;
+    } else {
+        return "status must be OPERATIONAL or MAINTENANCE";
+    }
+    if (readBatchWord(cursor, end, word, sizeof(word)) != NULL)
+        return "too many fields";
+
+    updateEquipment(session->equipment, index, &edited);
+    session->equipmentChanges++;
+    return NULL;
+}
+
+// Runs one batch command (a line without its newline). Returns NULL on success, setting '*addedID'
+// to the ID of an added record, or the reason the command was rejected.
+const char *runBatchCommand(BatchSession *session, const char *line, const char *end, int *addedID) {
+    char command[16];
+    const char *cursor = readBatchWord(line, end, command, sizeof(command));
+    if (cursor == NULL)
+        return "unknown command";
+    if (cursor < end)
+        cursor++; // The space after the command
+
+    if (strcmp(command, "ADD_MEMBER") == 0) {
+        // ADD_MEMBER takes a row in the CSV import format
+        Member member;
+        memset(&member, 0, sizeof(member));
+        const char *reason = parseMemberRow(cursor, end, &member, session->today);
+        if (reason != NULL)
+            return reason;
+        if (phoneOwner(session->members, member.phoneNum, -1) != -1)
+            return "phone number already registered";
+        member.memberID = (*session->nextMemberID)++;
+        addMember(session->members, &member);
+        session->memberChanges++;
+        *addedID = member.memberID;
+        return NULL;
+    }
+    if (strcmp(command, "DEL_MEMBER") == 0 || strcmp(command, "DEL_EQ") == 0) {
+        char word[24];
+        int id;
+        if ((cursor = readBatchWord(cursor, end, word, sizeof(word))) == NULL || !parseBatchNumber(word, &id) ||
+            readBatchWord(cursor, end, word, sizeof(word)) != NULL)
+            return "invalid ID";
+        if (strcmp(command, "DEL_MEMBER") == 0) {
+            if (findMemberIndex(session->members, id) == -1)
+                return "member not found";
+            deleteMember(session->members, id);
+            session->memberChanges++;
+        } else {
+            if (findEquipmentIndex(session->equipment, id) == -1)
+                return "equipment not found";
+            deleteEquipment(session->equipment, id);
+            session->equipmentChanges++;
+        }
+        return NULL;
+    }
+    if (strcmp(command, "ADD_EQ") == 0)
+        return batchAddEquipment(session, cursor, end, addedID);
+    if (strcmp(command, "SET_EQ_STATUS") == 0)
+        return batchSetEquipmentStatus(session, cursor, end);
+    if (strcmp(command, "REPORT") == 0) {
+        // The report is only recorded: the output holds nothing but the OK and ERR lines
+        while (cursor < end && *cursor == ' ')
+            cursor++;
+        if (cursor < end)
+            return "too many fields";
+        if (autoRestoreEquipment) {
+            // Restored without a message, and committed with the other changes of the batch
+            session->equipmentChanges += restoreOverdueEquipment(session->equipment, session->today, 0);
+        }
+        Report report;
+        buildReport(session->equipment, session->reports, &report);
+        *addedID = report.report_ID;
+        return NULL;
+    }
+    return "unknown command";
+}
+
+// Commits the batch's equipment changes, if there are any. With --auto-restore, overdue equipment
+// is restored first without a message, which would break the OK/ERR output, and counted as changes.
+void commitBatchEquipment(BatchSession *session) {
+    if (autoRestoreEquipment) {
+        session->equipmentChanges += restoreOverdueEquipment(session->equipment, session->today, 0);
+    }
+    if (session->equipmentChanges > 0) {
+        syncEquipmentLog(session->equipment);
+        session->equipmentChanges = 0;
+    }
+}
+
+// Runs the commands in 'path' ("-" for standard input) without the menus, one per line:
+//   ADD_MEMBER firstName,lastName,phone,gender,emergencyName,emergencyPhone,emergencyRelation,dob
+//   DEL_MEMBER id
+//   ADD_EQ name,totalQuantity,broken[,repairETA]
+//   DEL_EQ id
+//   SET_EQ_STATUS id OPERATIONAL | SET_EQ_STATUS id MAINTENANCE repairETA
+//   REPORT
+// Blank lines and lines starting with '#' are skipped. Each command prints "OK", "OK <id>" for an
+// added record or report, or "ERR <line>: <reason>". Changes are logged like menu changes, but the logs are
+// committed once per BATCH_COMMIT_OPS changes instead of after every one. Returns 1 if every
+// command succeeded.
+int runBatch(MemberList *members, EquipmentList *equipment, ReportHistory *reports, int *nextMemberID, int *nextEquipmentID,
+             const char *path) {
+    int fd = strcmp(path, "-") == 0 ? STDIN_FILENO : open(path, O_RDONLY);
+    if (fd < 0) {
+        printf("Error: could not open %s.\n", path);
+        return 0;
+    }
+    char *buffer = malloc(BATCH_BUFFER_BYTES);
+    if (buffer == NULL) {
+        printf("Memory allocation failed!\n");
+        exit(1);
+    }
+
+    BatchSession session = { members, equipment, nextMemberID, nextEquipmentID, getCurrentDate(), 0, 0, reports };
+    struct timespec started, finished;
+    clock_gettime(CLOCK_MONOTONIC, &started);
+
+    size_t carried = 0; // Bytes of an incomplete last line kept for the next read
+    long lineNumber = 0;
+    long commands = 0, failed = 0;
+    int readFailed = 0;
+    int atEnd = 0;
+    while (!atEnd) {
+        ssize_t got = read(fd, buffer + carried, BATCH_BUFFER_BYTES - carried);
+        if (got < 0) {
+            printf("Error reading %s.\n", path);
+            readFailed = 1;
+            break;
+        }
+        atEnd = got == 0;
+        size_t filled = carried + (size_t)got;
+        if (!atEnd && filled == BATCH_BUFFER_BYTES && memchr(buffer, '\n', filled) == NULL) {
+            printf("Error: line %ld of %s is too long.\n", lineNumber + 1, path);
+            readFailed = 1;
+            break;
+        }
+
+        // Run the whole lines, and the last one too at the end of the input
+        const char *line = buffer;
+        const char *bufferEnd = buffer + filled;
+        while (line < bufferEnd) {
+            const char *lineEnd = memchr(line, '\n', (size_t)(bufferEnd - line));
+            if (lineEnd == NULL && !atEnd) {
+                break;
+            }
+            const char *next = lineEnd != NULL ? lineEnd + 1 : bufferEnd;
+            if (lineEnd == NULL) {
+                lineEnd = bufferEnd;
+            }
+            if (lineEnd > line && lineEnd[-1] == '\r') {
+                lineEnd--;
+            }
+            lineNumber++;
+
+            if (lineEnd > line && *line != '#') {
+                int addedID = 0;
+                const char *reason = runBatchCommand(&session, line, lineEnd, &addedID);
+                commands++;
+                if (reason != NULL) {
+                    printf("ERR %ld: %s\n", lineNumber, reason);
+                    failed++;
+                } else if (addedID != 0) {
+                    printf("OK %d\n", addedID);
+                } else {
+                    printf("OK\n");
+                }
+                if (session.memberChanges >= BATCH_COMMIT_OPS) {
+                    commitMemberLog(members);
+                    session.memberChanges = 0;
+                }
+                if (session.equipmentChanges >= BATCH_COMMIT_OPS) {
+                    commitBatchEquipment(&session);
+                }
+            }
+            line = next;
+        }
+
+        carried = (size_t)(bufferEnd - line);
+        memmove(buffer, line, carried);
+    }
+    if (fd != STDIN_FILENO) {
+        close(fd);
+    }
+    free(buffer);
+    if (session.memberChanges > 0) {
+        commitMemberLog(members);
+    }
+    commitBatchEquipment(&session);
+
+    clock_gettime(CLOCK_MONOTONIC, &finished);
+    double seconds = (double)(finished.tv_sec - started.tv_sec) + (double)(finished.tv_nsec - started.tv_nsec) / 1e9;
+    printf("Batch finished: %ld commands, %ld failed in %.2f seconds (%.0f commands/s).\n",
+        commands, failed, seconds, seconds > 0 ? (double)commands / seconds : 0.0);
+    return !readFailed && failed == 0;
+}
+
+// Microseconds since the epoch, the time stamp of a scan
+int64_t scanTime(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    return (int64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+// The local calendar day a scan belongs to, as a dayNumber
+int visitDay(int64_t scannedAt) {
+    return localDayNumber((time_t)(scannedAt / 1000000));
+}
+
+void visitLogPath(const char *prefix, int day, char *path, size_t size) {
+    Date date = dateFromDayNumber(day);
+    snprintf(path, size, "%s%04d-%02d-%02d%s", prefix, date.year, date.month, date.day, VISIT_LOG_SUFFIX);
+}
+
+// Queues a scan of 'memberID', stamped with the current time. Safe to call from any number of
+// threads at once without locking. Returns 0 if the queue is full.
+int checkInPush(CheckInQueue *queue, int memberID) {
+    uint64_t position = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+    CheckInSlot *slot;
+    while (1) {
+        slot = &queue->slots[position & queue->mask];
+        uint64_t sequence = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+        int64_t difference = (int64_t)(sequence - position);
+        if (difference == 0) {
+            // The slot is free: claim its position, unless another producer got there first
+            if (atomic_compare_exchange_weak_explicit(&queue->tail, &position, position + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                break;
+            }
+        } else if (difference < 0) {
+            return 0; // The consumer has not taken the visit a whole lap ago yet
+        } else {
+            position = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+        }
+    }
+    slot->visit.scannedAt = scanTime();
+    slot->visit.memberID = memberID;
+    atomic_store_explicit(&slot->sequence, position + 1, memory_order_release);
+
+    // Pairs with the fence in checkInConsumerMain: either the consumer sees this visit before it
+    // sleeps, or this sees it sleeping and wakes it
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(&queue->consumerSleeping, memory_order_relaxed) &&
+        atomic_exchange(&queue->consumerSleeping, 0)) {
+        uint64_t one = 1;
+        if (write(queue->wakeFd, &one, sizeof(one)) != sizeof(one)) {
+            // The counter is already non-zero, so the consumer wakes anyway
+        }
+    }
+    return 1;
+}
+
+// Takes up to 'limit' queued visits in order. Only the consumer thread calls this.
+int checkInTake(CheckInQueue *queue, Visit *visits, int limit) {
+    int count = 0;
+    while (count < limit) {
+        CheckInSlot *slot = &queue->slots[queue->head & queue->mask];
+        if (atomic_load_explicit(&slot->sequence, memory_order_acquire) != queue->head + 1) {
+            break; // Empty, or a producer has claimed the slot but not filled it yet
+        }
+        visits[count++] = slot->visit;
+        atomic_store_explicit(&slot->sequence, queue->head + queue->mask + 1, memory_order_release);
+        queue->head++;
+    }
+    return count;
+}
+
+// Appends a batch of visits to the visit logs of their days and syncs them. A new log is started
+// when the day changes, so each file holds one day.
+void appendVisits(CheckInQueue *queue, const Visit *visits, int count) {
+    for (int i = 0; i < count; i++) {
+        int day = visitDay(visits[i].scannedAt);
+        if (queue->log.buffer == NULL || day != queue->logDay) {
+            if (queue->log.buffer != NULL) {
+                walClose(&queue->log);
+            }
+            char path[256];
+            visitLogPath(queue->prefix, day, path, sizeof(path));
+            walOpen(&queue->log, path, NULL);
+            queue->logDay = day;
+        }
+        if (queue->log.fd < 0) {
+            queue->lost++;
+            continue;
+        }
+        walAppendRecord(&queue->log, WAL_VISIT, &visitSchema, &visits[i]);
+        queue->logged++;
+    }
+    walCommit(&queue->log);
+    queue->batches++;
+}
+
+// Check-in consumer thread: drains the queue into the visit logs, sleeping while it is empty
+void *checkInConsumerMain(void *argument) {
+    CheckInQueue *queue = argument;
+    Visit *visits = malloc(CHECKIN_BATCH * sizeof(Visit));
+    if (visits == NULL) {
+        printf("Memory allocation failed!\n");
+        exit(1);
+    }
+    while (1) {
+        int count = checkInTake(queue, visits, CHECKIN_BATCH);
+        if (count > 0) {
+            appendVisits(queue, visits, count);
+            continue;
+        }
+        if (atomic_load(&queue->stopping)) {
+            // The producers are done, but a visit may have been queued after the take above
+            if ((count = checkInTake(queue, visits, CHECKIN_BATCH)) == 0) {
                 break;
             }
-            case 2:
-                // List All Equipment
-                if (equipmentList->count == 0) {
-                    printf("No equipment found.\n");
-                } else {
-                    for (int i = 0; i < equipmentList->count; i++) {
-                        Equipment *e = &equipmentList->equipments[i];
-                        printf("Equipment ID: %d\n", e->id);
-                        printf("Name: %s\n", e->name);
-                        printf("Total Quantity: %d\n", e->totalQuantity);
-                        printf("Functional: %d\n", e->functional);
-                        printf("Broken: %d\n", e->broken);
-                        printf("Status: %s\n", e->status);
-                        if (strcmp(e->status, "Under Maintenance") == 0) {
-                            printf("Repair ETA: %02d/%02d/%04d\n", e->repairETA.day, e->repairETA.month, e->repairETA.year);
-                        }
-                        printf("--------------------------------\n");
+            appendVisits(queue, visits, count);
+            continue;
+        }
+
+        atomic_store(&queue->consumerSleeping, 1);
+        atomic_thread_fence(memory_order_seq_cst);
+        CheckInSlot *next = &queue->slots[queue->head & queue->mask];
+        if (atomic_load_explicit(&next->sequence, memory_order_acquire) == queue->head + 1 ||
+            atomic_load(&queue->stopping)) {
+            atomic_store(&queue->consumerSleeping, 0);
+            continue;
+        }
+        // A wakeup left over from an earlier round only costs one extra pass
+        uint64_t wakeups;
+        if (read(queue->wakeFd, &wakeups, sizeof(wakeups)) < 0 && errno != EINTR) {
+            break;
+        }
+    }
+    free(visits);
+    return NULL;
+}
+
+// Starts the check-in queue and its consumer thread, writing visit logs named from 'prefix'.
+// Returns 0 if it could not be started.
+int startCheckIns(CheckInQueue *queue, const char *prefix) {
+    memset(queue, 0, sizeof(*queue));
+    initRecordSchema(&visitSchema);
+    queue->prefix = prefix;
+    queue->mask = CHECKIN_QUEUE_SLOTS - 1;
+    queue->log.fd = -1;
+    queue->slots = malloc(CHECKIN_QUEUE_SLOTS * sizeof(CheckInSlot));
+    if (queue->slots == NULL) {
+        printf("Memory allocation failed!\n");
+        exit(1);
+    }
+    for (uint64_t i = 0; i < CHECKIN_QUEUE_SLOTS; i++) {
+        atomic_init(&queue->slots[i].sequence, i);
+    }
+    queue->wakeFd = eventfd(0, EFD_CLOEXEC);
+    if (queue->wakeFd < 0 || pthread_create(&queue->consumer, NULL, checkInConsumerMain, queue) != 0) {
+        printf("Error: could not start recording check-ins.\n");
+        if (queue->wakeFd >= 0) {
+            close(queue->wakeFd);
+        }
+        free(queue->slots);
+        return 0;
+    }
+    return 1;
+}
+
+// Waits for the consumer to log every queued visit, then stops it. No thread may push meanwhile.
+void stopCheckIns(CheckInQueue *queue) {
+    atomic_store(&queue->stopping, 1);
+    uint64_t one = 1;
+    if (write(queue->wakeFd, &one, sizeof(one)) != sizeof(one)) {
+        // The counter is already non-zero, so the consumer wakes anyway
+    }
+    pthread_join(queue->consumer, NULL);
+    if (queue->log.buffer != NULL) {
+        walClose(&queue->log);
+    }
+    if (queue->lost > 0) {
+        printf("Warning: %ld check-ins could not be written to the visit log.\n", queue->lost);
+    }
+    close(queue->wakeFd);
+    free(queue->slots);
+}
+
+// Switches the server lock a thread holds: 0 for none, 1 shared for queries, 2 exclusive for writes
+void serverHold(Server *server, int *held, int wanted) {
+    if (*held == wanted) {
+        return;
+    }
+    if (*held != 0) {
+        pthread_rwlock_unlock(&server->lock);
+    }
+    if (wanted == 1) {
+        pthread_rwlock_rdlock(&server->lock);
+    } else if (wanted == 2) {
+        pthread_rwlock_wrlock(&server->lock);
+        server->session.today = getCurrentDate();
+    }
+    *held = wanted;
+}
+
+// Returns 1 for the commands that change the lists; they run as batch commands
+int isServerWrite(const char *line, const char *end) {
+    const char *writes[] = {"ADD_MEMBER", "DEL_MEMBER", "ADD_EQ", "DEL_EQ", "SET_EQ_STATUS"};
+    char command[16];
+    if (readBatchWord(line, end, command, sizeof(command)) == NULL) {
+        return 0;
+    }
+    for (int i = 0; i < (int)(sizeof(writes) / sizeof(writes[0])); i++) {
+        if (strcmp(command, writes[i]) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Answers a read-only command into 'reply' under the shared lock:
+//   GET_MEMBER id   OK followed by the member as an export CSV record
+//   FIND_PHONE phone   OK memberID
+//   GET_EQ id   OK followed by the equipment as an export CSV record
+//   REPORT   OK totalEquipment,functional,broken
+//   STATS   OK members,equipment,nextMemberID,nextEquipmentID
+//   CHECKIN memberID   OK once the scan is queued for the visit log
+// Returns NULL on success, or the reason the command failed.
+const char *runServerQuery(Server *server, const char *line, const char *end, OutputBuffer *reply) {
+    char command[16], word[24];
+    const char *cursor = readBatchWord(line, end, command, sizeof(command));
+    if (cursor == NULL)
+        return "unknown command";
+
+    int id;
+    if (strcmp(command, "GET_MEMBER") == 0) {
+        if ((cursor = readBatchWord(cursor, end, word, sizeof(word))) == NULL || !parseBatchNumber(word, &id))
+            return "invalid ID";
+        int slot = findMemberIndex(server->members, id);
+        if (slot == -1)
+            return "member not found";
+        Member member;
+        readMember(server->members, slot, &member);
+        outputText(reply, "OK ");
+        outputMemberCsv(reply, &member);
+    } else if (strcmp(command, "FIND_PHONE") == 0) {
+        if ((cursor = readBatchWord(cursor, end, word, sizeof(word))) == NULL || !isValidPhoneNumber(word))
+            return "invalid phone number";
+        int owner = phoneOwner(server->members, word, -1);
+        if (owner == -1)
+            return "phone number not registered";
+        outputText(reply, "OK ");
+        outputInt(reply, owner);
+    } else if (strcmp(command, "GET_EQ") == 0) {
+        if ((cursor = readBatchWord(cursor, end, word, sizeof(word))) == NULL || !parseBatchNumber(word, &id))
+            return "invalid ID";
+        int slot = findEquipmentIndex(server->equipment, id);
+        if (slot == -1)
+            return "equipment not found";
+        outputText(reply, "OK ");
+        outputEquipmentCsv(reply, equipmentAt(server->equipment, slot));
+    } else if (strcmp(command, "REPORT") == 0) {
+        Report report;
+        computeReport(server->equipment, &report);
+        outputText(reply, "OK ");
+        outputInt(reply, report.total_equipment_count);
+        outputChar(reply, ',');
+        outputInt(reply, report.total_functional_equipment);
+        outputChar(reply, ',');
+        outputInt(reply, report.total_broken_equipment);
+    } else if (strcmp(command, "CHECKIN") == 0) {
+        if ((cursor = readBatchWord(cursor, end, word, sizeof(word))) == NULL || !parseBatchNumber(word, &id))
+            return "invalid ID";
+        if (readBatchWord(cursor, end, word, sizeof(word)) != NULL)
+            return "too many fields";
+        if (findMemberIndex(server->members, id) == -1)
+            return "member not found";
+        if (server->checkIns == NULL)
+            return "check-ins are not being recorded";
+        if (!checkInPush(server->checkIns, id))
+            return "check-in queue full";
+        outputText(reply, "OK");
+    } else if (strcmp(command, "STATS") == 0) {
+        outputText(reply, "OK ");
+        outputInt(reply, server->members->count - server->members->deletedCount);
+        outputChar(reply, ',');
+        outputInt(reply, server->equipment->count - server->equipment->deletedCount);
+        outputChar(reply, ',');
+        outputInt(reply, *server->session.nextMemberID);
+        outputChar(reply, ',');
+        outputInt(reply, *server->session.nextEquipmentID);
+    } else {
+        return "unknown command";
+    }
+    if (readBatchWord(cursor, end, word, sizeof(word)) != NULL) {
+        reply->used = 0; // Drop the partial answer
+        return "too many fields";
+    }
+    outputChar(reply, '\n');
+    return NULL;
+}
+
+// Makes room for one more answer in a client's reply buffer
+void serverReserveReply(ServerClient *client) {
+    if (client->replyCapacity - client->reply.used >= EXPORT_RECORD_MAX) {
+        return;
+    }
+    size_t capacity = client->replyCapacity > 0 ? client->replyCapacity * 2 : 16384;
+    client->reply.data = realloc(client->reply.data, capacity);
+    if (client->reply.data == NULL) {
+        printf("Memory allocation failed!\n");
+        exit(1);
+    }
+    client->replyCapacity = capacity;
+}
+
+// Answers the complete request lines a client has sent. Queries share the lock; a run of write
+// commands takes it exclusively and stages their log records, setting '*membersChanged' or
+// '*equipmentChanged'. Answers to writes must wait for serverSync. A line too long for the input
+// buffer ends the connection once the answers are sent.
+void serverAnswer(Server *server, ServerClient *client, int *membersChanged, int *equipmentChanged) {
+    char *line = client->input;
+    char *inputEnd = client->input + client->inputUsed;
+    int held = 0;
+    char *lineEnd;
+    while ((lineEnd = memchr(line, '\n', (size_t)(inputEnd - line))) != NULL) {
+        const char *contentEnd = lineEnd > line && lineEnd[-1] == '\r' ? lineEnd - 1 : lineEnd;
+        if (contentEnd > line && *line != '#') {
+            serverReserveReply(client);
+            const char *reason;
+            if (isServerWrite(line, contentEnd)) {
+                serverHold(server, &held, 2);
+                int addedID = 0;
+                server->session.memberChanges = 0;
+                server->session.equipmentChanges = 0;
+                reason = runBatchCommand(&server->session, line, contentEnd, &addedID);
+                *membersChanged |= server->session.memberChanges > 0;
+                *equipmentChanged |= server->session.equipmentChanges > 0;
+                if (reason == NULL) {
+                    outputText(&client->reply, "OK");
+                    if (addedID != 0) {
+                        outputChar(&client->reply, ' ');
+                        outputInt(&client->reply, addedID);
                     }
+                    outputChar(&client->reply, '\n');
                 }
-                break;
-            case 3: {
-                // Update Equipment Status
-                printf("Enter equipment ID to update: ");
-                int equipmentID;
-                if (scanf("%d", &equipmentID) != 1) {
-                    printf("Invalid input. Please enter a valid equipment ID.\n");
-                    while (getchar() != '\n');
-                    break;
+            } else {
+                if (held == 0) {
+                    serverHold(server, &held, 1);
                 }
-                getchar();
+                size_t start = client->reply.used;
+                OutputBuffer answer = { -1, client->reply.data + start, 0, 0 };
+                reason = runServerQuery(server, line, contentEnd, &answer);
+                client->reply.used = start + answer.used;
+            }
+            if (reason != NULL) {
+                outputText(&client->reply, "ERR ");
+                outputText(&client->reply, reason);
+                outputChar(&client->reply, '\n');
+            }
+        }
+        line = lineEnd + 1;
+    }
+    serverHold(server, &held, 0);
+
+    client->inputUsed = (size_t)(inputEnd - line);
+    memmove(client->input, line, client->inputUsed);
+    if (client->inputUsed == sizeof(client->input)) {
+        // The rest of the line cannot be told apart from the next request
+        serverReserveReply(client);
+        outputText(&client->reply, "ERR request line too long\n");
+        client->inputUsed = 0;
+        client->finished = 1;
+    }
+}
 
-                // Find equipment
-                Equipment *equipmentToUpdate = NULL;
-                for (int i = 0; i < equipmentList->count; i++) {
-                    if (equipmentList->equipments[i].id == equipmentID) {
-                        equipmentToUpdate = &equipmentList->equipments[i];
-                        break;
-                    }
-                }
+// Group commit for the write commands a worker answered in one pass over its ready connections:
+// writes out the staged log records and does the log maintenance under the lock, then syncs the
+// logs after releasing it, so other threads keep serving while the disk catches up. Another thread
+// may already have written the records out, but only a sync of our own tells when they are on disk.
+void serverSync(Server *server, int membersChanged, int equipmentChanged) {
+    int held = 0;
+    int memberSync = -1, equipmentSync = -1, statusSync = -1;
+    serverHold(server, &held, 2);
+    if (autoRestoreEquipment && restoreOverdueEquipment(server->equipment, server->session.today, 1) > 0) {
+        equipmentChanged = 1; // Synced with this commit like the changes of the commands
+    }
+    if (membersChanged) {
+        memberSync = walFlushForSync(&server->members->log);
+        maintainMembers(server->members);
+    }
+    if (equipmentChanged) {
+        equipmentSync = walFlushForSync(&server->equipment->log);
+        if (server->equipment->statusHistory.unsynced > 0) {
+            statusSync = walFlushForSync(&server->equipment->statusHistory.log);
+            server->equipment->statusHistory.unsynced = 0;
+        }
+        maintainEquipment(server->equipment);
+    }
+    serverHold(server, &held, 0);
+
+    if (memberSync >= 0) {
+        if (fdatasync(memberSync) != 0) {
+            printf("Error syncing log file %s!\n", server->members->log.path);
+        }
+        close(memberSync);
+    }
+    if (equipmentSync >= 0) {
+        if (fdatasync(equipmentSync) != 0) {
+            printf("Error syncing log file %s!\n", server->equipment->log.path);
+        }
+        close(equipmentSync);
+    }
+    if (statusSync >= 0) {
+        if (fdatasync(statusSync) != 0) {
+            printf("Error syncing log file %s!\n", server->equipment->statusHistory.log.path);
+        }
+        close(statusSync);
+    }
+}
+
+// Sends as much of the pending reply as the socket takes. Returns 0 if the connection failed.
+int serverSend(ServerClient *client) {
+    while (client->replySent < client->reply.used) {
+        ssize_t sent = send(client->fd, client->reply.data + client->replySent,
+                            client->reply.used - client->replySent, MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        }
+        client->replySent += (size_t)sent;
+    }
+    client->reply.used = 0;
+    client->replySent = 0;
+    return 1;
+}
+
+// Waits for input unless the client finished or too much of the reply is unsent, and for the
+// socket to drain if any is
+void serverWatch(ServerWorker *worker, ServerClient *client) {
+    size_t pending = client->reply.used - client->replySent;
+    uint32_t events = (!client->finished && pending < SERVER_REPLY_LIMIT ? EPOLLIN : 0) | (pending > 0 ? EPOLLOUT : 0);
+    if (events != client->events) {
+        struct epoll_event event;
+        event.events = events;
+        event.data.ptr = client;
+        epoll_ctl(worker->epollFd, EPOLL_CTL_MOD, client->fd, &event);
+        client->events = events;
+    }
+}
+
+void serverDisconnect(ServerWorker *worker, ServerClient *client) {
+    pthread_mutex_lock(&worker->clientsLock);
+    if (client->previous != NULL) {
+        client->previous->next = client->next;
+    } else {
+        worker->clients = client->next;
+    }
+    if (client->next != NULL) {
+        client->next->previous = client->previous;
+    }
+    pthread_mutex_unlock(&worker->clientsLock);
+    close(client->fd);
+    free(client->reply.data);
+    free(client);
+}
+
+// Closes a connection that failed or that the client finished and that has no answers left to
+// send; otherwise waits for what it needs next
+void serverSettle(ServerWorker *worker, ServerClient *client, int open) {
+    if (open && client->finished && client->reply.used == client->replySent) {
+        open = 0;
+    }
+    if (open) {
+        serverWatch(worker, client);
+    } else {
+        serverDisconnect(worker, client);
+    }
+}
 
-                if (equipmentToUpdate != NULL) {
-                    updateEquipmentStatus(equipmentToUpdate);
+// Worker thread: serves the connections the accepting thread gave it until the server stops. The
+// answers to write commands are held back until one serverSync per pass has made them durable.
+void *serverWorkerMain(void *argument) {
+    ServerWorker *worker = argument;
+    struct epoll_event events[SERVER_EPOLL_EVENTS];
+    ServerClient *waiting[SERVER_EPOLL_EVENTS]; // Connections whose answers wait for the sync
+    int running = 1;
+    while (running) {
+        int ready = epoll_wait(worker->epollFd, events, SERVER_EPOLL_EVENTS, -1);
+        if (ready < 0 && errno != EINTR) {
+            break;
+        }
+        int waitingCount = 0;
+        int membersChanged = 0, equipmentChanged = 0;
+        for (int i = 0; i < ready; i++) {
+            ServerClient *client = events[i].data.ptr;
+            if (client == NULL) {
+                running = 0; // The stop pipe
+                continue;
+            }
+            int open = !(events[i].events & (EPOLLERR | EPOLLHUP)); // HUP: nobody is left to read answers
+            if (open && (events[i].events & EPOLLOUT)) {
+                open = serverSend(client);
+            }
+            if (open && (events[i].events & EPOLLIN) && !client->finished) {
+                ssize_t got = read(client->fd, client->input + client->inputUsed, sizeof(client->input) - client->inputUsed);
+                if (got < 0) {
+                    open = errno == EAGAIN || errno == EINTR;
+                } else if (got == 0) {
+                    client->finished = 1;
+                    if (client->inputUsed > 0) {
+                        client->input[client->inputUsed++] = '\n'; // Answer a last line without a line break
+                    }
                 } else {
-                    printf("Equipment with ID %d not found.\n", equipmentID);
+                    client->inputUsed += (size_t)got;
                 }
-                break;
-            }
-            case 4: {
-                // Delete Equipment
-                printf("Enter equipment ID to delete: ");
-                int deleteID;
-                if (scanf("%d", &deleteID) != 1) {
-                    printf("Invalid input. Please enter a valid equipment ID.\n");
-                    while (getchar() != '\n');
-                    break;
+                if (open && got >= 0 && client->inputUsed > 0) {
+                    int wroteMembers = 0, wroteEquipment = 0;
+                    serverAnswer(worker->server, client, &wroteMembers, &wroteEquipment);
+                    if (wroteMembers || wroteEquipment) {
+                        waiting[waitingCount++] = client;
+                        membersChanged |= wroteMembers;
+                        equipmentChanged |= wroteEquipment;
+                        continue;
+                    }
+                    open = serverSend(client);
                 }
-                getchar();
+            }
+            serverSettle(worker, client, open);
+        }
 
-                deleteEquipment(equipmentList, deleteID);
+        if (waitingCount > 0) {
+            serverSync(worker->server, membersChanged, equipmentChanged);
+            for (int i = 0; i < waitingCount; i++) {
+                serverSettle(worker, waiting[i], serverSend(waiting[i]));
+            }
+        }
+    }
+
+    while (worker->clients != NULL) {
+        serverDisconnect(worker, worker->clients);
+    }
+    return NULL;
+}
+
+// Signal handler for --server: wakes every thread through the stop pipe
+void stopServer(int signalNumber) {
+    (void)signalNumber;
+    if (serverStopFd >= 0) {
+        ssize_t ignored = write(serverStopFd, "x", 1);
+        (void)ignored;
+    }
+}
+
+// Serves the lists to clients on the Unix domain socket 'path' until SIGINT or SIGTERM. Requests
+// are lines: the --batch commands, which answer OK, OK <id> or ERR <reason>, and the queries of
+// runServerQuery. The accepting thread hands each connection to one of the worker threads, which
+// each run their own epoll loop. Returns 0 if the server could not start.
+int runServer(MemberList *members, EquipmentList *equipment, int *nextMemberID, int *nextEquipmentID, const char *path) {
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(address.sun_path)) {
+        printf("Error: socket path %s is too long.\n", path);
+        return 0;
+    }
+    strcpy(address.sun_path, path);
+
+    Server *server = calloc(1, sizeof(Server));
+    int stopPipe[2];
+    if (server == NULL || pipe(stopPipe) != 0) {
+        printf("Memory allocation failed!\n");
+        exit(1);
+    }
+    server->members = members;
+    server->equipment = equipment;
+    server->session = (BatchSession){ members, equipment, nextMemberID, nextEquipmentID, getCurrentDate(), 0, 0, NULL };
+    server->stopFd = stopPipe[0];
+    CheckInQueue checkIns;
+    if (startCheckIns(&checkIns, VISIT_LOG_PREFIX)) {
+        server->checkIns = &checkIns;
+    }
+
+    unlink(path);
+    server->listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (server->listenFd < 0 || bind(server->listenFd, (struct sockaddr *)&address, sizeof(address)) != 0 ||
+        listen(server->listenFd, SOMAXCONN) != 0) {
+        printf("Error: could not listen on %s.\n", path);
+        if (server->listenFd >= 0) {
+            close(server->listenFd);
+        }
+        close(stopPipe[0]);
+        close(stopPipe[1]);
+        if (server->checkIns != NULL) {
+            stopCheckIns(server->checkIns);
+        }
+        free(server);
+        return 0;
+    }
+
+    // Writers go first, so a steady stream of queries cannot hold off the write commands
+    pthread_rwlockattr_t lockAttributes;
+    pthread_rwlockattr_init(&lockAttributes);
+    pthread_rwlockattr_setkind_np(&lockAttributes, PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+    pthread_rwlock_init(&server->lock, &lockAttributes);
+    pthread_rwlockattr_destroy(&lockAttributes);
+
+    serverStopFd = stopPipe[1];
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = stopServer;
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    int threads = serverThreadCount > 0 ? serverThreadCount : (cores < SERVER_MIN_THREADS ? SERVER_MIN_THREADS : (int)cores);
+    if (threads > SERVER_MAX_THREADS) {
+        threads = SERVER_MAX_THREADS;
+    }
+    struct epoll_event event;
+    for (int t = 0; t < threads; t++) {
+        ServerWorker *worker = &server->workers[t];
+        worker->server = server;
+        worker->epollFd = epoll_create1(EPOLL_CLOEXEC);
+        pthread_mutex_init(&worker->clientsLock, NULL);
+        event.events = EPOLLIN;
+        event.data.ptr = NULL;
+        if (worker->epollFd < 0 || epoll_ctl(worker->epollFd, EPOLL_CTL_ADD, server->stopFd, &event) != 0 ||
+            pthread_create(&worker->thread, NULL, serverWorkerMain, worker) != 0) {
+            if (worker->epollFd >= 0) {
+                close(worker->epollFd);
+            }
+            pthread_mutex_destroy(&worker->clientsLock);
+            break;
+        }
+        server->workerCount++;
+    }
+
+    int acceptFd = epoll_create1(EPOLL_CLOEXEC);
+    event.events = EPOLLIN;
+    event.data.fd = server->listenFd;
+    epoll_ctl(acceptFd, EPOLL_CTL_ADD, server->listenFd, &event);
+    event.data.fd = server->stopFd;
+    epoll_ctl(acceptFd, EPOLL_CTL_ADD, server->stopFd, &event);
+    printf("Serving on %s with %d threads, stop with Ctrl+C.\n", path, server->workerCount);
+    fflush(stdout);
+
+    int running = server->workerCount > 0;
+    int nextWorker = 0;
+    while (running) {
+        struct epoll_event ready;
+        int count = epoll_wait(acceptFd, &ready, 1, -1);
+        if (count < 0 && errno != EINTR) {
+            break;
+        }
+        if (count <= 0) {
+            continue;
+        }
+        if (ready.data.fd == server->stopFd) {
+            running = 0;
+            continue;
+        }
+        int fd;
+        while ((fd = accept4(server->listenFd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0) {
+            ServerClient *client = calloc(1, sizeof(ServerClient));
+            if (client == NULL) {
+                printf("Memory allocation failed!\n");
+                exit(1);
+            }
+            client->fd = fd;
+            client->events = EPOLLIN;
+            client->reply.fd = -1;
+
+            // Round robin spreads the connections evenly over the workers
+            ServerWorker *worker = &server->workers[nextWorker];
+            nextWorker = (nextWorker + 1) % server->workerCount;
+            pthread_mutex_lock(&worker->clientsLock);
+            client->next = worker->clients;
+            if (worker->clients != NULL) {
+                worker->clients->previous = client;
+            }
+            worker->clients = client;
+            pthread_mutex_unlock(&worker->clientsLock);
+            event.events = EPOLLIN;
+            event.data.ptr = client;
+            epoll_ctl(worker->epollFd, EPOLL_CTL_ADD, fd, &event);
+        }
+    }
+
+    stopServer(0); // Also stops the workers if the accepting thread failed
+    for (int t = 0; t < server->workerCount; t++) {
+        pthread_join(server->workers[t].thread, NULL);
+        close(server->workers[t].epollFd);
+        pthread_mutex_destroy(&server->workers[t].clientsLock);
+    }
+    if (server->checkIns != NULL) {
+        stopCheckIns(server->checkIns);
+    }
+    printf("Server stopped.\n");
+
+    signal(SIGINT, SIG_DFL);
+    signal(SIGTERM, SIG_DFL);
+    serverStopFd = -1;
+    close(acceptFd);
+    close(server->listenFd);
+    close(stopPipe[0]);
+    close(stopPipe[1]);
+    unlink(path);
+    pthread_rwlock_destroy(&server->lock);
+    int started = server->workerCount > 0;
+    free(server);
+    return started;
+}
+
+// Connects to a --server socket, or returns -1
+int connectServer(const char *path) {
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    snprintf(address.sun_path, sizeof(address.sun_path), "%s", path);
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd >= 0 && connect(fd, (struct sockaddr *)&address, sizeof(address)) != 0) {
+        close(fd);
+        fd = -1;
+    }
+    return fd;
+}
+
+// Sends one request line and reads the one-line answer into 'reply'. Returns 0 if the connection failed.
+int serverRequest(int fd, const char *request, size_t length, char *reply, size_t size) {
+    if (!writeFully(fd, request, length)) {
+        return 0;
+    }
+    size_t used = 0;
+    while (used == 0 || reply[used - 1] != '\n') {
+        if (used + 1 == size) {
+            return 0;
+        }
+        ssize_t got = read(fd, reply + used, size - 1 - used);
+        if (got <= 0) {
+            if (got < 0 && errno == EINTR) {
+                continue;
+            }
+            return 0;
+        }
+        used += (size_t)got;
+    }
+    reply[used] = '\0';
+    return 1;
+}
+
+// Load generator thread: one connection sending requests one at a time and timing each answer
+void *loadClientMain(void *argument) {
+    LoadClient *client = argument;
+    int fd = connectServer(client->path);
+    if (fd < 0) {
+        client->failed = 1;
+        return NULL;
+    }
+    char request[160], reply[4096];
+    for (int i = 0; i < client->requests; i++) {
+        int length;
+        if ((int)(rand_r(&client->seed) % 100) < client->writePercent) {
+            // Random numbers rarely clash with a registered phone; a clash is answered with ERR
+            length = snprintf(request, sizeof(request),
+                "ADD_MEMBER Load,Generator,7%09u,M,Contact Person,5550001111,Other,01/01/1980\n",
+                (unsigned int)rand_r(&client->seed) % 1000000000u);
+        } else {
+            length = snprintf(request, sizeof(request), "GET_MEMBER %d\n",
+                1 + (int)(rand_r(&client->seed) % (unsigned int)client->maxMemberID));
+        }
+
+        struct timespec sent, answered;
+        clock_gettime(CLOCK_MONOTONIC, &sent);
+        if (!serverRequest(fd, request, (size_t)length, reply, sizeof(reply))) {
+            client->failed = 1;
+            client->requests = i;
+            break;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &answered);
+        client->latencies[i] = (answered.tv_sec - sent.tv_sec) * 1000000000L + (answered.tv_nsec - sent.tv_nsec);
+        if (strncmp(reply, "ERR", 3) == 0) {
+            client->errors++;
+        }
+    }
+    close(fd);
+    return NULL;
+}
+
+int compareLongs(const void *a, const void *b) {
+    long x = *(const long *)a, y = *(const long *)b;
+    return (x > y) - (x < y);
+}
+
+// Benchmarks a running --server: 'clients' connections each send 'requests' requests, one at a
+// time, mixing GET_MEMBER lookups with 'writePercent' percent ADD_MEMBER writes. Prints the
+// throughput and latency percentiles. Returns 0 if the server could not be reached.
+int runLoadGenerator(const char *path, int clients, int requests, int writePercent) {
+    char reply[256];
+    int fd = connectServer(path);
+    if (fd < 0 || !serverRequest(fd, "STATS\n", 6, reply, sizeof(reply))) {
+        printf("Error: could not reach a server on %s.\n", path);
+        if (fd >= 0) {
+            close(fd);
+        }
+        return 0;
+    }
+    close(fd);
+    int members = 0, equipment = 0, nextMemberID = 1;
+    sscanf(reply, "OK %d,%d,%d", &members, &equipment, &nextMemberID);
+
+    LoadClient *loadClients = calloc((size_t)clients, sizeof(LoadClient));
+    pthread_t *threads = calloc((size_t)clients, sizeof(pthread_t));
+    int *running = calloc((size_t)clients, sizeof(int));
+    long *latencies = malloc((size_t)clients * (size_t)requests * sizeof(long));
+    if (loadClients == NULL || threads == NULL || running == NULL || latencies == NULL) {
+        printf("Memory allocation failed!\n");
+        exit(1);
+    }
+
+    struct timespec started, finished;
+    clock_gettime(CLOCK_MONOTONIC, &started);
+    for (int c = 0; c < clients; c++) {
+        loadClients[c].path = path;
+        loadClients[c].requests = requests;
+        loadClients[c].writePercent = writePercent;
+        loadClients[c].maxMemberID = nextMemberID > 1 ? nextMemberID - 1 : 1;
+        loadClients[c].seed = (unsigned int)(started.tv_nsec + c * 7919);
+        loadClients[c].latencies = latencies + (size_t)c * (size_t)requests;
+        running[c] = pthread_create(&threads[c], NULL, loadClientMain, &loadClients[c]) == 0;
+        if (!running[c]) {
+            loadClients[c].failed = 1;
+            loadClients[c].requests = 0;
+        }
+    }
+    long total = 0, errors = 0;
+    int failed = 0;
+    for (int c = 0; c < clients; c++) {
+        if (running[c]) {
+            pthread_join(threads[c], NULL);
+        }
+        // Pack the answered requests together for sorting
+        memmove(latencies + total, loadClients[c].latencies, (size_t)loadClients[c].requests * sizeof(long));
+        total += loadClients[c].requests;
+        errors += loadClients[c].errors;
+        failed += loadClients[c].failed;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &finished);
+    double seconds = (double)(finished.tv_sec - started.tv_sec) + (double)(finished.tv_nsec - started.tv_nsec) / 1e9;
+
+    printf("%d clients, %ld requests (%d%% writes) against %d members in %.2f seconds: %.0f requests/s\n",
+        clients, total, writePercent, members, seconds, seconds > 0 ? (double)total / seconds : 0.0);
+    if (total > 0) {
+        qsort(latencies, (size_t)total, sizeof(long), compareLongs);
+        printf("Latency: p50 %.1f us, p99 %.1f us, p99.9 %.1f us, max %.1f us\n",
+            latencies[total / 2] / 1000.0, latencies[total * 99 / 100] / 1000.0,
+            latencies[total * 999 / 1000] / 1000.0, latencies[total - 1] / 1000.0);
+    }
+    if (errors > 0) {
+        printf("%ld requests were answered with ERR.\n", errors);
+    }
+    if (failed > 0) {
+        printf("%d connections failed.\n", failed);
+    }
+    free(latencies);
+    free(running);
+    free(threads);
+    free(loadClients);
+    return 1;
+}
 
-                printf("Equipment deleted successfully!\n");
-                break;
+// --checkin-bench producer: scans random member IDs as fast as it can, timing each one from the
+// lookup until it is queued. A full queue is retried, so the wait counts towards the latency.
+void *checkInProducerMain(void *argument) {
+    CheckInProducer *producer = argument;
+    for (int i = 0; i < producer->scans; i++) {
+        int memberID = 1 + (int)(rand_r(&producer->seed) % (unsigned int)producer->maxMemberID);
+        struct timespec scanned, queued;
+        clock_gettime(CLOCK_MONOTONIC, &scanned);
+        if (findMemberIndex(producer->members, memberID) == -1) {
+            producer->rejected++;
+        } else {
+            while (!checkInPush(producer->queue, memberID)) {
+                producer->fullWaits++;
+                sched_yield();
             }
-            case 5:
-                printf("Returning to Main Menu...\n");
-                break;
-            default:
-                printf("Invalid choice. Please try again.\n");
         }
-
-    } while (choice != 5);
+        clock_gettime(CLOCK_MONOTONIC, &queued);
+        producer->latencies[i] = (queued.tv_sec - scanned.tv_sec) * 1000000000L + (queued.tv_nsec - scanned.tv_nsec);
+    }
+    return NULL;
 }
 
-void reportsMenu(EquipmentList *equipmentList) {
-    int choice;
-    do {
-        printf("==========================================\n");
-        printf("            Reports\n");
-        printf("==========================================\n");
-        printf("1. Generate Equipment Report\n");
-        printf("2. Back to Main Menu\n");
-        printf("==========================================\n");
-        printf("Enter your choice (1-2): \n");
-        if (scanf("%d", &choice) != 1) {
-            printf("Invalid input. Please enter 1 or 2.\n");
-            while (getchar() != '\n');
-            continue;
-        }
-        getchar(); 
+// Benchmarks the check-in pipeline: 'producers' threads each scan 'scans' random member IDs into
+// one queue, whose consumer logs them to a throwaway visit log. Prints the ingest throughput,
+// until queued and until synced to the log, and the enqueue latency percentiles.
+int runCheckInBenchmark(MemberList *members, int nextMemberID, int producers, int scans) {
+    if (members->count - members->deletedCount == 0) {
+        printf("Error: the check-in benchmark needs at least one member.\n");
+        return 0;
+    }
+    const char *prefix = "checkin-bench-";
+    CheckInQueue queue;
+    if (!startCheckIns(&queue, prefix)) {
+        return 0;
+    }
 
-        switch(choice) {
-            case 1: {
-                Report report;
-                generateReport(equipmentList, &report);
-                break;
-            }
-            case 2:
-                printf("Returning to Main Menu...\n");
-                break;
-            default:
-                printf("Invalid choice. Please try again.\n");
+    CheckInProducer *producerStates = calloc((size_t)producers, sizeof(CheckInProducer));
+    pthread_t *threads = calloc((size_t)producers, sizeof(pthread_t));
+    int *running = calloc((size_t)producers, sizeof(int));
+    long *latencies = malloc((size_t)producers * (size_t)scans * sizeof(long));
+    if (producerStates == NULL || threads == NULL || running == NULL || latencies == NULL) {
+        printf("Memory allocation failed!\n");
+        exit(1);
+    }
+
+    struct timespec started, queued, logged;
+    clock_gettime(CLOCK_MONOTONIC, &started);
+    int firstDay = visitDay(scanTime());
+    for (int p = 0; p < producers; p++) {
+        producerStates[p].queue = &queue;
+        producerStates[p].members = members;
+        producerStates[p].scans = scans;
+        producerStates[p].maxMemberID = nextMemberID > 1 ? nextMemberID - 1 : 1;
+        producerStates[p].seed = (unsigned int)(started.tv_nsec + p * 7919);
+        producerStates[p].latencies = latencies + (size_t)p * (size_t)scans;
+        running[p] = pthread_create(&threads[p], NULL, checkInProducerMain, &producerStates[p]) == 0;
+        if (!running[p]) {
+            producerStates[p].scans = 0;
+        }
+    }
+    long total = 0, rejected = 0, fullWaits = 0;
+    for (int p = 0; p < producers; p++) {
+        if (running[p]) {
+            pthread_join(threads[p], NULL);
         }
-    } while (choice != 2);
+        memmove(latencies + total, producerStates[p].latencies, (size_t)producerStates[p].scans * sizeof(long));
+        total += producerStates[p].scans;
+        rejected += producerStates[p].rejected;
+        fullWaits += producerStates[p].fullWaits;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &queued);
+    stopCheckIns(&queue);
+    clock_gettime(CLOCK_MONOTONIC, &logged);
+    int lastDay = visitDay(scanTime());
+
+    double queueSeconds = (double)(queued.tv_sec - started.tv_sec) + (double)(queued.tv_nsec - started.tv_nsec) / 1e9;
+    double logSeconds = (double)(logged.tv_sec - started.tv_sec) + (double)(logged.tv_nsec - started.tv_nsec) / 1e9;
+    printf("%d producers, %ld scans (%ld not members) in %.2f seconds: %.0f scans/s queued\n",
+        producers, total, rejected, queueSeconds, queueSeconds > 0 ? (double)total / queueSeconds : 0.0);
+    printf("%ld visits synced to the log in %ld batches after %.2f seconds: %.0f visits/s\n",
+        queue.logged, queue.batches, logSeconds, logSeconds > 0 ? (double)queue.logged / logSeconds : 0.0);
+    if (total > 0) {
+        qsort(latencies, (size_t)total, sizeof(long), compareLongs);
+        printf("Enqueue latency: p50 %.2f us, p99 %.2f us, p99.9 %.2f us, max %.1f us\n",
+            latencies[total / 2] / 1000.0, latencies[total * 99 / 100] / 1000.0,
+            latencies[total * 999 / 1000] / 1000.0, latencies[total - 1] / 1000.0);
+    }
+    if (fullWaits > 0) {
+        printf("The queue was full %ld times.\n", fullWaits);
+    }
+
+    // The benchmark's visits are not real ones
+    char path[256];
+    for (int day = firstDay; day <= lastDay; day++) {
+        visitLogPath(prefix, day, path, sizeof(path));
+        remove(path);
+    }
+    free(latencies);
+    free(running);
+    free(threads);
+    free(producerStates);
+    return 1;
 }
 
-void saveMembersToFile(MemberList *list, const char *filename) {
-    FILE *file = fopen(filename, "wb");
-    if (file == NULL) {
-        printf("Error opening file for writing!\n");
-        return;
+// Returns 1 once the snapshot is on disk, 0 on failure
+int saveMembersToFile(MemberList *list, const char *filename) {
+    // The log is truncated after a save, so the snapshot must reach the disk first.
+    // Write only the changed records unless most of the file changed anyway.
+    int result = -1;
+    if (list->persistedCount >= 0 && list->dirty.count <= list->count / 2) {
+        result = saveDataFileIncremental(filename, &packedMemberSchema, &list->store, list->count, list->names.bytes, list->names.used,
+                                         &list->dirty, list->persistedCount);
+    }
+    if (result == -1) {
+        result = saveDataFile(filename, &packedMemberSchema, &list->store, list->count, list->names.bytes, list->names.used);
+    }
+    if (!result) {
+        printf("Error writing members file!\n");
+        return 0;
     }
 
-    // Write the count
-    fwrite(&list->count, sizeof(int), 1, file);
+    clearDirty(&list->dirty);
+    list->persistedCount = list->count;
+    return 1;
+}
 
-    // Write the members
-    fwrite(list->members, sizeof(Member), list->count, file);
+// Applies one replayed log record to the member list
+void applyMemberLogRecord(void *context, WalRecordType type, const void *payload, uint32_t length) {
+    MemberList *list = context;
 
-    fclose(file);
+    if (type == WAL_MEMBER_PUT && length == memberSchema.recordSize) {
+        Member member;
+        decodeRecord(&memberSchema, payload, &member);
+        int index = findMemberIndex(list, member.memberID);
+        if (index == -1) {
+            addMember(list, &member);
+        } else {
+            Member previous;
+            readMember(list, index, &previous);
+            updateMember(list, index, &member, &previous);
+        }
+    } else if (type == WAL_MEMBER_DELETE && length == sizeof(int)) {
+        int memberID;
+        memcpy(&memberID, payload, sizeof(int));
+        int index = findMemberIndex(list, memberID);
+        if (index != -1) {
+            removeMemberAt(list, index);
+        }
+    }
 }
 
 void loadMembersFromFile(MemberList *list, const char *filename, int *nextMemberID) {
-    FILE *file = fopen(filename, "rb");
-    if (file == NULL) {
+    // Logging stays off until the snapshot and the log have been replayed
+    list->log.fd = -1;
+    list->log.buffer = NULL;
+    list->dirty.bits = NULL;
+    list->dirty.capacity = 0;
+    list->dirty.count = 0;
+    list->snapshot.worker = NULL;
+    list->snapshot.state = SNAPSHOT_IDLE;
+    segmentStoreInit(&list->snapshot.records, sizeof(PackedMember));
+    list->snapshot.strings = NULL;
+    list->snapshot.startedAt = time(NULL);
+
+    recoverIncrementalSave(filename, &packedMemberSchema);
+
+    void *records = NULL;
+    void *mapping = NULL;
+    size_t mappingLength = 0;
+    char *strings = NULL;
+    size_t stringBytes = 0;
+    DataFileStatus status = loadDataFile(filename, &packedMemberSchema, useMappedFiles, &records, &list->count,
+                                         &mapping, &mappingLength, &strings, &stringBytes);
+    if (status == DATA_FILE_MISSING) {
         // File doesn't exist, initialize empty list
         list->count = 0;
-        list->capacity = 10;
-        list->members = malloc(list->capacity * sizeof(Member));
-        if (list->members == NULL) {
-            printf("Memory allocation failed!\n");
-            exit(1);
+    }
+    segmentStoreInit(&list->store, sizeof(PackedMember));
+    columnsInit(&list->columns);
+    columnsReserve(&list->columns, list->count);
+    if (status == DATA_FILE_LEGACY) {
+        // The file holds Member records, which are packed now
+        nameArenaInit(&list->names);
+        reserveMembers(list, list->count);
+        for (int i = 0; i < list->count; i++) {
+            storeMember(list, i, (const Member *)records + i);
+        }
+        free(records);
+    } else {
+        if (status == DATA_FILE_MISSING) {
+            nameArenaInit(&list->names);
+        } else if (!nameArenaAdopt(&list->names, strings, stringBytes)) {
+            reportDamagedFile(filename, "invalid string section");
+        }
+        segmentStoreAdopt(&list->store, records, list->count, mapping != NULL ? mapping : records, mappingLength);
+        int relationCount = (int)(sizeof(relationNames) / sizeof(relationNames[0]));
+        for (int i = 0; i < list->count; i++) {
+            const PackedMember *packed = packedMemberAt(list, i);
+            if (packed->firstName >= list->names.used || packed->lastName >= list->names.used ||
+                packed->emergencyName >= list->names.used || packed->gender > GENDER_UNKNOWN ||
+                packed->emergencyRelation >= relationCount || packed->birthDay >= DOB_DAYS) {
+                reportDamagedFile(filename, "member record out of range");
+            }
+            columnsSet(&list->columns, i, packed);
         }
-        *nextMemberID = 1;
-        return;
+    }
+    list->persistedCount = status == DATA_FILE_LOADED ? list->count : -1;
+
+    idIndexInit(&list->idIndex, list->count);
+    multimapInit(&list->firstNameIndex, list->count);
+    multimapInit(&list->lastNameIndex, list->count);
+    multimapInit(&list->fullNameIndex, list->count);
+    multimapInit(&list->trigramIndex, 4096);
+    multimapInit(&list->phoneIndex, list->count);
+    multimapInit(&list->emergencyPhoneIndex, list->count);
+    dobIndexInit(&list->dobIndex, list->count);
+    handleTableInit(&list->handles);
+    list->deletedCount = 0;
+    for (int i = 0; i < list->count; i++) {
+        if (packedMemberAt(list, i)->memberID == 0) {
+            list->deletedCount++; // Saved before it was compacted away
+            continue;
+        }
+        Member member;
+        readMember(list, i, &member);
+        idIndexPut(&list->idIndex, member.memberID, i);
+        handleAttach(&list->handles, i);
+        indexMember(list, &member);
     }
 
-    // Read the count
-    fread(&list->count, sizeof(int), 1, file);
-
-    // Ensure the capacity is sufficient
-    list->capacity = list->count > 10 ? list->count : 10;
-    list->members = malloc(list->capacity * sizeof(Member));
-    if (list->members == NULL) {
-        printf("Memory allocation failed!\n");
-        fclose(file);
-        exit(1);
+    if (status == DATA_FILE_LEGACY) {
+        // Rewrite files in an older format in the current one
+        if (saveMembersToFile(list, filename)) {
+            printf("Upgraded %s to format version %d.\n", filename, packedMemberSchema.version);
+        }
     }
 
-    // Read the members
-    fread(list->members, sizeof(Member), list->count, file);
+    // Replay the mutations made since the last checkpoint
+    char logPath[256];
+    snprintf(logPath, sizeof(logPath), "%s%s", filename, WAL_SUFFIX);
+    int replayed = walReplay(logPath, applyMemberLogRecord, list);
+    if (shouldCompact(list->deletedCount, list->count)) {
+        compactMembers(list);
+    }
 
     // Update nextMemberID
     *nextMemberID = 1;
     for (int i = 0; i < list->count; i++) {
-        if (list->members[i].memberID >= *nextMemberID) {
-            *nextMemberID = list->members[i].memberID + 1;
+        if (packedMemberAt(list, i)->memberID >= *nextMemberID) {
+            *nextMemberID = packedMemberAt(list, i)->memberID + 1;
         }
     }
 
-    fclose(file);
+    walOpen(&list->log, logPath, filename);
+    list->log.loggedRecords = replayed;
 }
 
-void saveEquipmentToFile(EquipmentList *list, const char *filename) {
-    FILE *file = fopen(filename, "wb");
-    if (file == NULL) {
-        printf("Error opening equipment file for writing!\n");
-        return;
+// Returns 1 once the snapshot is on disk, 0 on failure
+int saveEquipmentToFile(EquipmentList *list, const char *filename) {
+    // The log is truncated after a save, so the snapshot must reach the disk first.
+    // Write only the changed records unless most of the file changed anyway.
+    int result = -1;
+    if (list->persistedCount >= 0 && list->dirty.count <= list->count / 2) {
+        result = saveDataFileIncremental(filename, &equipmentSchema, &list->store, list->count, NULL, 0,
+                                         &list->dirty, list->persistedCount);
+    }
+    if (result == -1) {
+        result = saveDataFile(filename, &equipmentSchema, &list->store, list->count, NULL, 0);
+    }
+    if (!result) {
+        printf("Error writing equipment file!\n");
+        return 0;
+    }
+
+    clearDirty(&list->dirty);
+    list->persistedCount = list->count;
+    return 1;
+}
+
+// Converts equipment written before the status was stored as a code
+void upgradeEquipment(const EquipmentV1 *old, Equipment *equipment) {
+    memset(equipment, 0, sizeof(*equipment));
+    memcpy(equipment->name, old->name, sizeof(equipment->name));
+    equipment->totalQuantity = old->totalQuantity;
+    equipment->functional = old->functional;
+    equipment->broken = old->broken;
+    equipment->status = strncmp(old->status, "Under Maintenance", sizeof(old->status)) == 0 ?
+                        EQUIPMENT_UNDER_MAINTENANCE : EQUIPMENT_OPERATIONAL;
+    equipment->repairETA = old->repairETA;
+    equipment->id = old->id;
+}
+
+// Applies one replayed log record to the equipment list
+void applyEquipmentLogRecord(void *context, WalRecordType type, const void *payload, uint32_t length) {
+    EquipmentList *list = context;
+
+    if (type == WAL_EQUIPMENT_PUT && (length == equipmentSchema.recordSize || length == equipmentV1Schema.recordSize)) {
+        Equipment equipment;
+        if (length == equipmentSchema.recordSize) {
+            decodeRecord(&equipmentSchema, payload, &equipment);
+        } else {
+            EquipmentV1 old; // Logged before the upgrade
+            decodeRecord(&equipmentV1Schema, payload, &old);
+            upgradeEquipment(&old, &equipment);
+        }
+        int index = findEquipmentIndex(list, equipment.id);
+        if (index == -1) {
+            addEquipment(list, &equipment);
+        } else {
+            updateEquipment(list, index, &equipment);
+        }
+    } else if (type == WAL_EQUIPMENT_DELETE && length == sizeof(int)) {
+        int equipmentID;
+        memcpy(&equipmentID, payload, sizeof(int));
+        int index = findEquipmentIndex(list, equipmentID);
+        if (index != -1) {
+            removeEquipmentAt(list, index);
+        }
     }
+}
 
-    // Write the count
-    fwrite(&list->count, sizeof(int), 1, file);
+// Adds one change from the status time series file
+void applyStatusLogRecord(void *context, WalRecordType type, const void *payload, uint32_t length) {
+    if (type == WAL_STATUS_CHANGE && length == statusChangeSchema.recordSize) {
+        StatusChange change;
+        decodeRecord(&statusChangeSchema, payload, &change);
+        if (change.status == EQUIPMENT_OPERATIONAL || change.status == EQUIPMENT_UNDER_MAINTENANCE) {
+            addStatusChange(context, &change);
+        }
+    }
+}
 
-    // Write the equipments
-    fwrite(list->equipments, sizeof(Equipment), list->count, file);
+// Reads the status time series, rebuilding the per-equipment aggregates, and starts recording.
+// Like the report history, the file is only appended to.
+void loadStatusHistory(StatusHistory *history, const char *path) {
+    initRecordSchema(&statusChangeSchema);
+    history->count = 0;
+    segmentStoreInit(&history->store, sizeof(StatusChange));
+    multimapInit(&history->byEquipment, 0);
+    idIndexInit(&history->statsIndex, 0);
+    history->stats = NULL;
+    history->statsCount = 0;
+    history->statsCapacity = 0;
+    history->unsynced = 0;
+    walReplay(path, applyStatusLogRecord, history);
+    walOpen(&history->log, path, NULL);
+    history->recording = 1;
+}
 
-    fclose(file);
+void freeStatusHistory(StatusHistory *history) {
+    walClose(&history->log);
+    segmentStoreFree(&history->store);
+    multimapFree(&history->byEquipment);
+    idIndexFree(&history->statsIndex);
+    free(history->stats);
 }
 
 void loadEquipmentFromFile(EquipmentList *list, const char *filename, int *nextEquipmentID) {
-    FILE *file = fopen(filename, "rb");
-    if (file == NULL) {
+    // Logging stays off until the snapshot and the log have been replayed
+    list->log.fd = -1;
+    list->statusHistory.recording = 0;
+    list->log.buffer = NULL;
+    list->dirty.bits = NULL;
+    list->dirty.capacity = 0;
+    list->dirty.count = 0;
+    list->snapshot.worker = NULL;
+    list->snapshot.state = SNAPSHOT_IDLE;
+    segmentStoreInit(&list->snapshot.records, sizeof(Equipment));
+    list->snapshot.startedAt = time(NULL);
+
+    recoverIncrementalSave(filename, &equipmentSchema);
+
+    void *records = NULL;
+    void *mapping = NULL;
+    size_t mappingLength = 0;
+    char *strings = NULL;
+    size_t stringBytes = 0;
+    DataFileStatus status = loadDataFile(filename, &equipmentSchema, useMappedFiles, &records, &list->count,
+                                         &mapping, &mappingLength, &strings, &stringBytes);
+    free(strings); // Equipment has no string section
+    if (status == DATA_FILE_MISSING) {
         // File doesn't exist, initialize empty list
         list->count = 0;
-        list->capacity = 10;
-        list->equipments = malloc(list->capacity * sizeof(Equipment));
-        if (list->equipments == NULL) {
-            printf("Memory allocation failed!\n");
+    }
+    if (status == DATA_FILE_LEGACY) {
+        // The file holds EquipmentV1 records with the status as text
+        Equipment *upgraded = malloc((list->count > 0 ? list->count : 1) * sizeof(Equipment));
+        if (upgraded == NULL) {
+            printf("Memory allocation failed\n");
             exit(1);
         }
-        *nextEquipmentID = 1;
-        return;
+        for (int i = 0; i < list->count; i++) {
+            upgradeEquipment((const EquipmentV1 *)records + i, &upgraded[i]);
+        }
+        free(records);
+        records = upgraded;
+    }
+    segmentStoreInit(&list->store, sizeof(Equipment));
+    segmentStoreAdopt(&list->store, records, list->count, mapping != NULL ? mapping : records, mappingLength);
+    list->persistedCount = status == DATA_FILE_LOADED ? list->count : -1;
+
+    idIndexInit(&list->idIndex, list->count);
+    handleTableInit(&list->handles);
+    list->deletedCount = 0;
+    memset(&list->totals, 0, sizeof(list->totals));
+    repairScheduleInit(&list->schedule);
+    for (int i = 0; i < list->count; i++) {
+        if (equipmentAt(list, i)->id == 0) {
+            list->deletedCount++; // Saved before it was compacted away
+            continue;
+        }
+        idIndexPut(&list->idIndex, equipmentAt(list, i)->id, i);
+        handleAttach(&list->handles, i);
+        countEquipment(&list->totals, equipmentAt(list, i), 1);
+        scheduleRepair(&list->schedule, equipmentAt(list, i));
     }
 
-    // Read the count
-    fread(&list->count, sizeof(int), 1, file);
-
-    // Ensure the capacity is sufficient
-    list->capacity = list->count > 10 ? list->count : 10;
-    list->equipments = malloc(list->capacity * sizeof(Equipment));
-    if (list->equipments == NULL) {
-        printf("Memory allocation failed!\n");
-        fclose(file);
-        exit(1);
+    if (status == DATA_FILE_LEGACY) {
+        // Rewrite files in an older format in the current one
+        if (saveEquipmentToFile(list, filename)) {
+            printf("Upgraded %s to format version %d.\n", filename, equipmentSchema.version);
+        }
     }
 
-    // Read the equipments
-    fread(list->equipments, sizeof(Equipment), list->count, file);
+    // Replay the mutations made since the last checkpoint
+    char logPath[256];
+    snprintf(logPath, sizeof(logPath), "%s%s", filename, WAL_SUFFIX);
+    int replayed = walReplay(logPath, applyEquipmentLogRecord, list);
+    if (shouldCompact(list->deletedCount, list->count)) {
+        compactEquipment(list);
+    }
 
     // Update nextEquipmentID
     *nextEquipmentID = 1;
     for (int i = 0; i < list->count; i++) {
-        if (list->equipments[i].id >= *nextEquipmentID) {
-            *nextEquipmentID = list->equipments[i].id + 1;
+        if (equipmentAt(list, i)->id >= *nextEquipmentID) {
+            *nextEquipmentID = equipmentAt(list, i)->id + 1;
         }
     }
 
-    fclose(file);
+    walOpen(&list->log, logPath, filename);
+    list->log.loggedRecords = replayed;
+
+    char statusPath[256];
+    snprintf(statusPath, sizeof(statusPath), "%s%s", filename, STATUS_LOG_SUFFIX);
+    loadStatusHistory(&list->statusHistory, statusPath);
 }
 
-int main() {
-    int intChoice;
+// Adds one report from reports.log to the history
+void applyReportLogRecord(void *context, WalRecordType type, const void *payload, uint32_t length) {
+    ReportHistory *history = context;
+    if (type == WAL_REPORT && length == reportSchema.recordSize) {
+        StoredReport stored;
+        decodeRecord(&reportSchema, payload, &stored);
+        if (stored.reportDay >= 0 && stored.reportDay < DOB_DAYS && idIndexGet(&history->idIndex, stored.reportID) == -1) {
+            addReport(history, &stored);
+        }
+    }
+}
 
-    // Initialize MemberList
-    MemberList memberList;
-    memberList.count = 0;
-    memberList.capacity = 10; // initial capacity
-    memberList.members = malloc(memberList.capacity * sizeof(Member));
-    if (memberList.members == NULL) {
+// Reads the report history and opens it for appending. Reports are only ever added, so the log is
+// the store itself and is never checkpointed into another file.
+void loadReportHistory(ReportHistory *history, const char *filename) {
+    initRecordSchema(&reportSchema);
+    history->count = 0;
+    history->byDate = NULL;
+    history->byDateCapacity = 0;
+    history->nextReportID = 1;
+    segmentStoreInit(&history->store, sizeof(StoredReport));
+    idIndexInit(&history->idIndex, 0);
+    history->log.fd = -1;
+    history->log.buffer = NULL;
+    walReplay(filename, applyReportLogRecord, history);
+    walOpen(&history->log, filename, NULL);
+}
+
+void freeReportHistory(ReportHistory *history) {
+    walClose(&history->log);
+    segmentStoreFree(&history->store);
+    idIndexFree(&history->idIndex);
+    free(history->byDate);
+}
+
+// Releases the member array, whether it is mapped or on the heap
+void freeMemberList(MemberList *list) {
+    free(list->dirty.bits);
+    idIndexFree(&list->idIndex);
+    handleTableFree(&list->handles);
+    columnsFree(&list->columns);
+    multimapFree(&list->firstNameIndex);
+    multimapFree(&list->lastNameIndex);
+    multimapFree(&list->fullNameIndex);
+    multimapFree(&list->trigramIndex);
+    multimapFree(&list->phoneIndex);
+    multimapFree(&list->emergencyPhoneIndex);
+    dobIndexFree(&list->dobIndex);
+    nameArenaFree(&list->names);
+    segmentStoreFree(&list->store);
+}
+
+void freeEquipmentList(EquipmentList *list) {
+    freeStatusHistory(&list->statusHistory);
+    repairScheduleFree(&list->schedule);
+    free(list->dirty.bits);
+    idIndexFree(&list->idIndex);
+    handleTableFree(&list->handles);
+    segmentStoreFree(&list->store);
+}
+
+// Saves both lists, empties the logs and frees everything, as the program exits
+void closeLists(MemberList *memberList, EquipmentList *equipmentList, ReportHistory *reportHistory, SnapshotWorker *snapshotWorker) {
+    checkpointMembers(memberList);
+    checkpointEquipment(equipmentList);
+    walClose(&memberList->log);
+    walClose(&equipmentList->log);
+    if (memberList->snapshot.worker != NULL) {
+        stopSnapshotWorker(snapshotWorker);
+    }
+    freeMemberList(memberList);
+    freeEquipmentList(equipmentList);
+    freeReportHistory(reportHistory);
+    free(exportBuffer);
+}
+
+// Seconds from 'started' until now
+double secondsSince(const struct timespec *started) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)(now.tv_sec - started->tv_sec) + (double)(now.tv_nsec - started->tv_nsec) / 1e9;
+}
+
+// --search-bench: random lookups of existing IDs through an IdIndex and through a linear scan, for
+// tables of 1K IDs up to 'maxSize' in steps of ten. IDs are consecutive, like the ones the lists hand out.
+void benchIdLookups(int maxSize, int lookups) {
+    printf("ID lookups (%d random IDs per size):\n", lookups);
+    printf("%12s %12s %12s\n", "IDs", "Index", "Scan");
+    int *queries = malloc((size_t)lookups * sizeof(int));
+    if (queries == NULL) {
         printf("Memory allocation failed!\n");
-        return 1;
+        exit(1);
+    }
+    for (long size = 1000; size <= maxSize; size *= 10) {
+        int *ids = malloc((size_t)size * sizeof(int));
+        if (ids == NULL) {
+            printf("Memory allocation failed!\n");
+            exit(1);
+        }
+        IdIndex index;
+        idIndexInit(&index, (int)size);
+        for (int i = 0; i < size; i++) {
+            ids[i] = i + 1;
+            idIndexPut(&index, ids[i], i);
+        }
+        unsigned int seed = 12345;
+        long expected = 0;
+        for (int q = 0; q < lookups; q++) {
+            queries[q] = 1 + (int)(rand_r(&seed) % (unsigned int)size);
+            expected += queries[q] - 1; // The slot of each ID
+        }
+
+        struct timespec started;
+        clock_gettime(CLOCK_MONOTONIC, &started);
+        long found = 0;
+        for (int q = 0; q < lookups; q++) {
+            found += idIndexGet(&index, queries[q]);
+        }
+        double indexSeconds = secondsSince(&started);
+
+        // A scan reads the whole table per lookup, so fewer lookups keep the large sizes short
+        int scans = (int)(200000000L / size);
+        scans = scans < 1 ? 1 : (scans > lookups ? lookups : scans);
+        int mismatches = found != expected;
+        clock_gettime(CLOCK_MONOTONIC, &started);
+        for (int q = 0; q < scans; q++) {
+            int slot = 0;
+            while (slot < size && ids[slot] != queries[q]) {
+                slot++;
+            }
+            mismatches += slot != queries[q] - 1;
+        }
+        double scanSeconds = secondsSince(&started);
+
+        printf("%12ld %9.1f ns %9.1f us%s\n", size, indexSeconds * 1e9 / lookups, scanSeconds * 1e6 / scans,
+            mismatches > 0 ? "  (results differ!)" : "");
+        idIndexFree(&index);
+        free(ids);
+    }
+    free(queries);
+}
+
+// Writes a made-up name of two to four syllables into 'name'
+void makeBenchName(char *name, size_t size, unsigned int *seed) {
+    static const char *syllables[] = {"an", "bel", "cor", "da", "el", "fin", "gar", "hal",
+                                      "is", "jo", "ka", "lin", "mar", "no", "ra", "son"};
+    int count = 2 + (int)(rand_r(seed) % 3);
+    size_t length = 0;
+    name[0] = '\0';
+    for (int i = 0; i < count; i++) {
+        length += (size_t)snprintf(name + length, size - length, "%s", syllables[rand_r(seed) % 16]);
     }
+    name[0] = (char)toupper((unsigned char)name[0]);
+}
 
-    // Initialize EquipmentList
-    EquipmentList equipmentList;
-    equipmentList.count = 0;
-    equipmentList.capacity = 10; // initial capacity
-    equipmentList.equipments = malloc(equipmentList.capacity * sizeof(Equipment));
-    if (equipmentList.equipments == NULL) {
+// Fills 'list' with 'count' made-up members for --search-bench. The list is loaded from an empty
+// scratch directory that is removed right away, and logging is off, so nothing reaches the disk.
+int makeBenchMembers(MemberList *list, int count) {
+    char directory[] = "search-bench-XXXXXX";
+    if (mkdtemp(directory) == NULL) {
+        printf("Error: could not create a scratch directory for the benchmark.\n");
+        return 0;
+    }
+    char path[64];
+    snprintf(path, sizeof(path), "%s/%s", directory, MEMBER_FILENAME);
+    int nextMemberID;
+    loadMembersFromFile(list, path, &nextMemberID);
+    walClose(&list->log);
+    remove(list->log.path);
+    rmdir(directory);
+
+    struct timespec started;
+    clock_gettime(CLOCK_MONOTONIC, &started);
+    unsigned int seed = 2024;
+    int firstDay = dayNumber((Date){1, 1, 1940});
+    reserveMembers(list, count);
+    for (int i = 0; i < count; i++) {
+        Member member;
+        memset(&member, 0, sizeof(member));
+        member.memberID = i + 1;
+        makeBenchName(member.firstName, sizeof(member.firstName), &seed);
+        makeBenchName(member.lastName, sizeof(member.lastName), &seed);
+        snprintf(member.phoneNum, sizeof(member.phoneNum), "07%09d", i);
+        member.gender = rand_r(&seed) % 2 ? 'M' : 'F';
+        char contactFirst[16], contactLast[16]; // makeBenchName writes at most 12 letters
+        makeBenchName(contactFirst, sizeof(contactFirst), &seed);
+        makeBenchName(contactLast, sizeof(contactLast), &seed);
+        snprintf(member.emergencyName, sizeof(member.emergencyName), "%s %s", contactFirst, contactLast);
+        snprintf(member.emergencyPhone, sizeof(member.emergencyPhone), "08%09d", i);
+        snprintf(member.emergencyRelation, sizeof(member.emergencyRelation), "%s", relationNames[rand_r(&seed) % 6]);
+        member.dob = dateFromDayNumber(firstDay + (int)(rand_r(&seed) % (70 * 365)));
+        addMember(list, &member);
+    }
+    printf("Made up %d members in %.2f seconds.\n\n", count, secondsSince(&started));
+    return 1;
+}
+
+typedef int (*FieldMatcher)(const char *field, size_t fieldSize, const ScanPattern *pattern);
+
+// fieldMatches done with the C library, as the searches did before the vectorized matchers
+int fieldMatchesLibc(const char *field, size_t fieldSize, const ScanPattern *pattern) {
+    (void)fieldSize;
+    if (pattern->substring) {
+        return strcasestr(field, pattern->folded) != NULL;
+    }
+    return strcasecmp(field, pattern->folded) == 0;
+}
+
+// Counts the members whose first, last or emergency contact name matches 'pattern' with 'matcher'
+int countNameMatches(MemberList *list, FieldMatcher matcher, const ScanPattern *pattern) {
+    const char *names = list->names.bytes;
+    int found = 0;
+    for (int i = 0; i < list->count; i++) {
+        const PackedMember *packed = packedMemberAt(list, i);
+        if (packed->memberID != 0 && (matcher(names + packed->firstName, NAME_LENGTH, pattern) ||
+                                      matcher(names + packed->lastName, NAME_LENGTH, pattern) ||
+                                      matcher(names + packed->emergencyName, NAME_LENGTH, pattern))) {
+            found++;
+        }
+    }
+    return found;
+}
+
+// --search-bench: a scan of the three name fields of every member with each fieldMatches kernel
+// the CPU has, against the C library. Prints the best of three runs of each.
+void benchFieldMatchers(MemberList *list) {
+    const char *matcherNames[] = {"C library", "Scalar", "SSE2", "AVX2"};
+    FieldMatcher matchers[4] = {fieldMatchesLibc, fieldMatchesScalar, NULL, NULL};
+#if defined(__x86_64__)
+    matchers[2] = fieldMatchesSse2;
+    if (hasAvx2()) {
+        matchers[3] = fieldMatchesAvx2;
+    }
+#endif
+    ScanPattern patterns[2];
+    initScanPattern(&patterns[0], "Marson", 0);
+    initScanPattern(&patterns[1], "arso", 1);
+
+    printf("Name scans (first, last and emergency contact name, best of 3):\n");
+    printf("%-12s %14s %14s\n", "Kernel", "Whole \"Marson\"", "Text \"arso\"");
+    int expected[2];
+    for (int m = 0; m < 4; m++) {
+        if (matchers[m] == NULL) {
+            continue;
+        }
+        double best[2];
+        int mismatches = 0;
+        for (int p = 0; p < 2; p++) {
+            best[p] = 0;
+            for (int run = 0; run < 3; run++) {
+                struct timespec started;
+                clock_gettime(CLOCK_MONOTONIC, &started);
+                int found = countNameMatches(list, matchers[m], &patterns[p]);
+                double seconds = secondsSince(&started);
+                best[p] = run == 0 || seconds < best[p] ? seconds : best[p];
+                if (m == 0) {
+                    expected[p] = found;
+                }
+                mismatches += found != expected[p];
+            }
+        }
+        printf("%-12s %11.1f ms %11.1f ms%s\n", matcherNames[m], best[0] * 1e3, best[1] * 1e3,
+            mismatches > 0 ? "  (results differ!)" : "");
+    }
+    printf("Matches: %d whole, %d text.\n\n", expected[0], expected[1]);
+}
+
+// Adds up the visited member IDs, so the index and the scans can be checked against each other
+void sumVisitedMember(void *context, int memberID) {
+    *(long *)context += memberID;
+}
+
+void sumBirthdayMember(void *context, int memberID, Date birthday) {
+    (void)birthday;
+    *(long *)context += memberID;
+}
+
+// Counts the members aged minAge to maxAge on 'today' with calculateAge, one member at a time,
+// adding up their IDs in '*idSum'
+int scanMembersByAge(MemberList *list, int minAge, int maxAge, Date today, long *idSum) {
+    int found = 0;
+    for (int i = 0; i < list->count; i++) {
+        const PackedMember *packed = packedMemberAt(list, i);
+        if (packed->memberID == 0) {
+            continue;
+        }
+        int age = calculateAge(dateFromDayNumber(packed->birthDay), today);
+        if (age >= minAge && age <= maxAge) {
+            *idSum += packed->memberID;
+            found++;
+        }
+    }
+    return found;
+}
+
+// Counts the members with a birthday in the 'days' days from 'today' by checking every member's
+// birthday against the days of the window, adding up their IDs in '*idSum'
+int scanUpcomingBirthdays(MemberList *list, Date today, int days, long *idSum) {
+    char inWindow[13 * 32] = {0}; // By month * 32 + day
+    int start = dayNumber(today);
+    for (int offset = 0; offset < days && offset < 366 && start + offset < DOB_DAYS; offset++) {
+        Date date = dateFromDayNumber(start + offset);
+        inWindow[date.month * 32 + date.day] = 1;
+        if (date.month == 2 && date.day == 28 && !isValidDate(29, 2, date.year)) {
+            inWindow[2 * 32 + 29] = 1;
+        }
+    }
+    int found = 0;
+    for (int i = 0; i < list->count; i++) {
+        const PackedMember *packed = packedMemberAt(list, i);
+        if (packed->memberID == 0) {
+            continue;
+        }
+        Date dob = dateFromDayNumber(packed->birthDay);
+        if (inWindow[dob.month * 32 + dob.day]) {
+            *idSum += packed->memberID;
+            found++;
+        }
+    }
+    return found;
+}
+
+// --search-bench: the age-range and birthday queries through the DobIndex against a scan of every
+// member, on today's date
+void benchDobQueries(MemberList *list, int counts) {
+    Date today = getCurrentDate();
+    struct {
+        const char *name;
+        int minAge, maxAge, birthdayDays; // birthdayDays 0 for an age range
+        int listed; // 0 to only count the members
+    } queries[] = {
+        {"count aged 18-25", 18, 25, 0, 0},
+        {"list aged 30", 30, 30, 0, 1},
+        {"list aged 18-25", 18, 25, 0, 1},
+        {"birthdays next 7 days", 0, 0, 7, 1},
+    };
+
+    printf("Date of birth queries (index, then a scan of every member):\n");
+    for (int q = 0; q < (int)(sizeof(queries) / sizeof(queries[0])); q++) {
+        long indexSum = 0, scanSum = 0;
+        int indexFound = 0, scanFound = 0;
+        // A count is a few tree lookups, so it is repeated to be measurable
+        int repeats = queries[q].listed ? 1 : counts;
+        struct timespec started;
+        clock_gettime(CLOCK_MONOTONIC, &started);
+        for (int r = 0; r < repeats; r++) {
+            if (queries[q].birthdayDays > 0) {
+                indexFound = visitUpcomingBirthdays(list, today, queries[q].birthdayDays, sumBirthdayMember, &indexSum);
+            } else {
+                indexFound = visitMembersByAge(list, queries[q].minAge, queries[q].maxAge, today,
+                                               queries[q].listed ? sumVisitedMember : NULL, &indexSum);
+            }
+        }
+        double indexSeconds = secondsSince(&started) / repeats;
+
+        clock_gettime(CLOCK_MONOTONIC, &started);
+        if (queries[q].birthdayDays > 0) {
+            scanFound = scanUpcomingBirthdays(list, today, queries[q].birthdayDays, &scanSum);
+        } else {
+            scanFound = scanMembersByAge(list, queries[q].minAge, queries[q].maxAge, today, &scanSum);
+        }
+        double scanSeconds = secondsSince(&started);
+
+        int differ = indexFound != scanFound || (queries[q].listed && indexSum != scanSum);
+        printf("  %-22s %8d members %10.2f us %10.1f ms%s\n", queries[q].name, indexFound, indexSeconds * 1e6,
+            scanSeconds * 1e3, differ ? "  (results differ!)" : "");
+    }
+    printf("\n");
+}
+
+// Counts the members in 'records' whose first or last name matches 'pattern', for comparison
+// with visitMembersWithName
+int countRecordNameMatches(const Member *records, int count, const ScanPattern *pattern) {
+    int found = 0;
+    for (int i = 0; i < count; i++) {
+        if (records[i].memberID != 0 && (fieldMatches(records[i].firstName, NAME_LENGTH, pattern) ||
+                                         fieldMatches(records[i].lastName, NAME_LENGTH, pattern))) {
+            found++;
+        }
+    }
+    return found;
+}
+
+// countMemberDemographics over whole Member records instead of the columns
+void countRecordDemographics(const Member *records, int count, Date today, int counts[AGE_BANDS][3]) {
+    int bornBy[AGE_BANDS];
+    for (int b = 0; b < AGE_BANDS; b++) {
+        bornBy[b] = dayOnOrBefore(today.day, today.month, today.year - ageBandStarts[b]);
+    }
+    memset(counts, 0, AGE_BANDS * sizeof(counts[0]));
+    for (int i = 0; i < count; i++) {
+        if (records[i].memberID == 0) {
+            continue;
+        }
+        int birthDay = dayNumber(records[i].dob);
+        int band = 0;
+        for (int b = 1; b < AGE_BANDS; b++) {
+            band += birthDay <= bornBy[b];
+        }
+        int gender = records[i].gender == 'M' ? 0 : (records[i].gender == 'F' ? 1 : 2);
+        counts[band][gender]++;
+    }
+}
+
+// --search-bench: the scans that read only the member columns, against the same scans over an
+// array of whole Member records (the layout before the columns). Prints the best of three runs.
+void benchColumnScans(MemberList *list) {
+    Member *records = malloc((size_t)list->count * sizeof(Member));
+    if (records == NULL) {
         printf("Memory allocation failed!\n");
-        return 1;
+        exit(1);
+    }
+    for (int i = 0; i < list->count; i++) {
+        readMember(list, i, &records[i]);
+    }
+    Date today = getCurrentDate();
+    ScanPattern patterns[2];
+    initScanPattern(&patterns[0], "Marson", 0);
+    initScanPattern(&patterns[1], "arso", 1);
+    const char *scanNames[] = {"Whole name \"Marson\"", "Text \"arso\" in a name", "Demographics"};
+
+    printf("Column scans (columns %.1f MB plus %.1f MB of names, records %.1f MB, best of 3):\n",
+        (double)list->count * (2 * sizeof(int) + sizeof(char) + 2 * sizeof(uint32_t)) / 1e6,
+        (double)list->names.used / 1e6, (double)list->count * sizeof(Member) / 1e6);
+    for (int scan = 0; scan < 3; scan++) {
+        double best[2] = {0, 0};
+        int found[2] = {0, 0};
+        int columnCounts[AGE_BANDS][3], recordCounts[AGE_BANDS][3];
+        for (int layout = 0; layout < 2; layout++) {
+            for (int run = 0; run < 3; run++) {
+                struct timespec started;
+                clock_gettime(CLOCK_MONOTONIC, &started);
+                if (scan == 2 && layout == 0) {
+                    countMemberDemographics(list, today, columnCounts);
+                } else if (scan == 2) {
+                    countRecordDemographics(records, list->count, today, recordCounts);
+                } else if (layout == 0) {
+                    found[0] = visitMembersWithName(list, &patterns[scan], NULL, NULL);
+                } else {
+                    found[1] = countRecordNameMatches(records, list->count, &patterns[scan]);
+                }
+                double seconds = secondsSince(&started);
+                best[layout] = run == 0 || seconds < best[layout] ? seconds : best[layout];
+            }
+        }
+        int differ = scan == 2 ? memcmp(columnCounts, recordCounts, sizeof(columnCounts)) != 0 : found[0] != found[1];
+        printf("  %-24s records %7.1f ms, columns %7.1f ms%s\n", scanNames[scan], best[1] * 1e3, best[0] * 1e3,
+            differ ? "  (results differ!)" : "");
+    }
+    free(records);
+}
+
+// Benchmarks the member indexes and scans on made-up data, without loading or changing the data
+// files. 'members' is the largest table size, 'lookups' the number of queries timed per test.
+int runSearchBenchmark(int members, int lookups) {
+    if (members < 1000) {
+        printf("Error: the search benchmark needs at least 1000 members.\n");
+        return 0;
+    }
+    benchIdLookups(members, lookups);
+    printf("\n");
+
+    MemberList list;
+    if (!makeBenchMembers(&list, members)) {
+        return 0;
+    }
+    benchFieldMatchers(&list);
+    benchDobQueries(&list, lookups);
+    benchColumnScans(&list);
+    freeMemberList(&list);
+    return 1;
+}
+
+int main(int argc, char *argv[]) {
+    int intChoice;
+    const char *batchPath = NULL;
+    const char *serverPath = NULL;
+    const char *loadgenPath = NULL;
+    int checkInBenchmark = 0;
+    int searchBenchmark = 0, benchMembers = 1000000;
+    int loadClients = 8, loadRequests = 100000, loadWritePercent = 10;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--mmap") == 0) {
+            useMappedFiles = 1;
+        } else if (strcmp(argv[i], "--snapshot-interval") == 0 && i + 1 < argc) {
+            snapshotIntervalSeconds = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--snapshot-dirty") == 0 && i + 1 < argc) {
+            snapshotDirtyRecords = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--auto-restore") == 0) {
+            autoRestoreEquipment = 1;
+        } else if (strcmp(argv[i], "--check-totals") == 0) {
+            checkEquipmentTotals = 1;
+        } else if (strcmp(argv[i], "--batch") == 0 && i + 1 < argc) {
+            batchPath = argv[++i];
+        } else if (strcmp(argv[i], "--server") == 0 && i + 1 < argc) {
+            serverPath = argv[++i];
+        } else if (strcmp(argv[i], "--server-threads") == 0 && i + 1 < argc) {
+            serverThreadCount = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--loadgen") == 0 && i + 1 < argc) {
+            loadgenPath = argv[++i];
+        } else if (strcmp(argv[i], "--checkin-bench") == 0) {
+            checkInBenchmark = 1;
+        } else if (strcmp(argv[i], "--search-bench") == 0) {
+            searchBenchmark = 1;
+        } else if (strcmp(argv[i], "--members") == 0 && i + 1 < argc && atoi(argv[i + 1]) > 0) {
+            benchMembers = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--clients") == 0 && i + 1 < argc && atoi(argv[i + 1]) > 0) {
+            loadClients = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--requests") == 0 && i + 1 < argc && atoi(argv[i + 1]) > 0) {
+            loadRequests = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--write-percent") == 0 && i + 1 < argc) {
+            loadWritePercent = atoi(argv[++i]);
+        } else {
+            printf("Unknown option: %s\n", argv[i]);
+            printf("Usage: %s [--mmap] [--snapshot-interval SECONDS] [--snapshot-dirty RECORDS]\n"
+                   "          [--auto-restore] [--check-totals]\n"
+                   "          [--batch FILE | --server SOCKET [--server-threads N]]\n"
+                   "       %s --loadgen SOCKET [--clients N] [--requests N] [--write-percent P]\n"
+                   "       %s --checkin-bench [--clients N] [--requests N]\n"
+                   "       %s --search-bench [--members N] [--requests N]\n", argv[0], argv[0], argv[0], argv[0]);
+            return 1;
+        }
+    }
+
+    if (loadgenPath != NULL) {
+        // Benchmark a running server; the data files belong to it
+        return runLoadGenerator(loadgenPath, loadClients, loadRequests, loadWritePercent) ? 0 : 1;
+    }
+    if (searchBenchmark) {
+        // The benchmark makes up its own members; the data files are not loaded
+        return runSearchBenchmark(benchMembers, loadRequests) ? 0 : 1;
     }
 
+    // The lists are initialized by the load functions, either from the data files or empty
+    MemberList memberList;
+    EquipmentList equipmentList;
+
     // Variables to keep track of next IDs
     int nextMemberID = 1;
     int nextEquipmentID = 1;
@@ -1388,6 +8487,34 @@ int main() {
     // Load data from files
     loadMembersFromFile(&memberList, MEMBER_FILENAME, &nextMemberID);
     loadEquipmentFromFile(&equipmentList, EQUIPMENT_FILENAME, &nextEquipmentID);
+    ReportHistory reportHistory;
+    loadReportHistory(&reportHistory, REPORT_FILENAME);
+
+    // Changes are saved in the background while the menus keep running
+    SnapshotWorker snapshotWorker;
+    if (startSnapshotWorker(&snapshotWorker)) {
+        memberList.snapshot.worker = &snapshotWorker;
+        equipmentList.snapshot.worker = &snapshotWorker;
+    }
+
+    if (batchPath != NULL) {
+        // Run the script instead of the menus
+        int succeeded = runBatch(&memberList, &equipmentList, &reportHistory, &nextMemberID, &nextEquipmentID, batchPath);
+        closeLists(&memberList, &equipmentList, &reportHistory, &snapshotWorker);
+        return succeeded ? 0 : 1;
+    }
+    if (checkInBenchmark) {
+        // Time the check-in pipeline against the loaded members; --clients are the turnstiles
+        int measured = runCheckInBenchmark(&memberList, nextMemberID, loadClients, loadRequests);
+        closeLists(&memberList, &equipmentList, &reportHistory, &snapshotWorker);
+        return measured ? 0 : 1;
+    }
+    if (serverPath != NULL) {
+        // Serve the lists to local clients instead of the menus
+        int served = runServer(&memberList, &equipmentList, &nextMemberID, &nextEquipmentID, serverPath);
+        closeLists(&memberList, &equipmentList, &reportHistory, &snapshotWorker);
+        return served ? 0 : 1;
+    }
 
     while(1){
         // main menu
@@ -1424,16 +8551,12 @@ int main() {
                 equipmentManagementMenu(&equipmentList, &nextEquipmentID);
                 break;
             case 3:
-                reportsMenu(&equipmentList);
+                reportsMenu(&memberList, &equipmentList, &reportHistory);
                 break;
             case 4:
                 printf("Exiting program...\n");
-                // Save data to files
-                saveMembersToFile(&memberList, MEMBER_FILENAME);
-                saveEquipmentToFile(&equipmentList, EQUIPMENT_FILENAME);
-                // Free allocated memory
-                free(memberList.members);
-                free(equipmentList.equipments);
+                // Save data to files, empty the logs and free allocated memory
+                closeLists(&memberList, &equipmentList, &reportHistory, &snapshotWorker);
                 return 0;
         }
     }